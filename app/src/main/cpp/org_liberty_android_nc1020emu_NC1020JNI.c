@@ -2,7 +2,10 @@
 #include <string.h>
 #include <jni.h>
 
-JNIEXPORT void JNICALL
+// the app runs a single machine.
+static nc1020_t *_nc1020;
+
+JNIEXPORT jboolean JNICALL
 Java_org_liberty_android_nc1020emu_NC1020JNI_initialize(JNIEnv *env, jclass type,
                                                         jstring romFilePath_, jstring norFilePath_,
                                                         jstring stateFilePath_) {
@@ -10,36 +13,61 @@ Java_org_liberty_android_nc1020emu_NC1020JNI_initialize(JNIEnv *env, jclass type
     const char *norFilePath = (*env)->GetStringUTFChars(env, norFilePath_, 0);
     const char *stateFilePath = (*env)->GetStringUTFChars(env, stateFilePath_, 0);
 
-    initialize(romFilePath, norFilePath, stateFilePath);
+    if (_nc1020 == NULL) {
+        _nc1020 = create_nc1020();
+    }
+    bool initialized = initialize(_nc1020, romFilePath, norFilePath, stateFilePath);
 
     (*env)->ReleaseStringUTFChars(env, romFilePath_, romFilePath);
     (*env)->ReleaseStringUTFChars(env, norFilePath_, norFilePath);
     (*env)->ReleaseStringUTFChars(env, stateFilePath_, stateFilePath);
+    return (jboolean) initialized;
 }
 
 JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_reset
         (JNIEnv *env, jclass type) {
-    reset();
+    reset(_nc1020);
 }
 
 JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_load
         (JNIEnv *env, jclass type) {
-    load_nc1020();
+    load_nc1020(_nc1020);
 }
 
 JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_save
         (JNIEnv *env, jclass type) {
-    save_nc1020();
+    save_nc1020(_nc1020);
+}
+
+// off until a control turns it on, a snapshot every 100ms in 4M keeps minutes of history.
+JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_setRewind
+        (JNIEnv *env, jclass type, jint intervalMs, jint budget) {
+    set_rewind(_nc1020, intervalMs > 0 ? (uint32_t) intervalMs : 0, budget > 0 ? (uint32_t) budget : 0);
+}
+
+JNIEXPORT jint JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_getRewindPoints
+        (JNIEnv *env, jclass type) {
+    return (jint) get_rewind_points(_nc1020);
+}
+
+JNIEXPORT jboolean JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_rewind
+        (JNIEnv *env, jclass type, jint point) {
+    return point >= 0 && rewind_nc1020(_nc1020, (uint32_t) point);
+}
+
+JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_setRunAhead
+        (JNIEnv *env, jclass type, jint runAheadMs) {
+    set_run_ahead(_nc1020, runAheadMs > 0 ? (uint32_t) runAheadMs : 0);
 }
 
 JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_setKey
         (JNIEnv *env, jclass type, jint keyId, jboolean downOrUp) {
-    set_key((uint8_t) (keyId & 0x3F), downOrUp);
+    set_key(_nc1020, (uint8_t) (keyId & 0x3F), downOrUp);
 }
 
 JNIEXPORT void JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_runTimeSlice
         (JNIEnv *env, jclass type, jint timeSlice, jboolean speedUp) {
-    run_time_slice((size_t) timeSlice, speedUp);
+    run_time_slice(_nc1020, (size_t) timeSlice, speedUp);
 }
 
 /**
@@ -54,30 +82,18 @@ JNIEXPORT jboolean JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_copyLcdB
         (JNIEnv *env, jclass type, jbyteArray buffer) {
     jbyte* buffer_ex= (*env)->GetByteArrayElements(env, buffer, NULL);
 
-    uint8_t* lcd_buffer = get_lcd_buffer();
-
-    if (lcd_buffer == NULL)
-        return false;
-
-    for (int y = 0; y < 80; y++) {
-        for (int j = 0; j < 20; j++) {
-            uint8_t p = lcd_buffer[20 * y + j];
-            for (int k = 0; k < 8; k++) {
-                buffer_ex[y * 160 + j * 8 + k] = ((p & (1u << (7u - k))) != 0 ? 0xFFu : 0x00);
-            }
-        }
-    }
-
-    for (int y = 0; y < 80; y++) {
-        buffer_ex[y * 160] = 0;
-    }
+    bool copied = copy_lcd_buffer_ex(_nc1020, (uint8_t*) buffer_ex);
 
+    (*env)->ReleaseByteArrayElements(env, buffer, buffer_ex, copied ? 0 : JNI_ABORT);
+    return copied;
+}
 
-    (*env)->ReleaseByteArrayElements(env, buffer, buffer_ex, 0);
-    return true;
+JNIEXPORT jboolean JNICALL Java_org_liberty_android_nc1020emu_NC1020JNI_isSleeping
+        (JNIEnv *env, jclass type) {
+    return is_sleeping(_nc1020);
 }
 
 JNIEXPORT jlong JNICALL
 Java_org_liberty_android_nc1020emu_NC1020JNI_getCycles(JNIEnv *env, jclass type) {
-    return get_cycles();
+    return get_cycles(_nc1020);
 }
@@ -0,0 +1,178 @@
+//
+// Skipping idle loops: a run to a budget stops at the same pc and cycles, with the same
+// registers and memory, as single stepping to it. The loops are random and their head is
+// also jumped to from another instruction than the one closing them. Under the profiler
+// nothing is skipped, it sees every instruction single stepping does.
+//
+
+#include "test_support.h"
+#include "../wqx/cpu6502.h"
+#include <string.h>
+
+#define TRIALS 20000u
+#define MEMORY_SIZE 0x10000u
+#define LOOP_HEAD 0x2200u
+
+typedef struct {
+    uint8_t memory[MEMORY_SIZE];
+    uint8_t *memmap[8];
+    uint8_t page_flags[8];
+    cpu6502_t *cpu;
+#ifdef CPU6502_PROFILE
+    // the instructions profiled, and their cycles weighted by pc.
+    uint64_t profiled;
+    uint64_t profiled_sum;
+#endif
+} machine_t;
+
+static const uint8_t BRANCHES[] = {0x10, 0x30, 0x50, 0x70, 0x90, 0xB0, 0xD0, 0xF0};
+static const uint8_t JMP = 0x4C;
+
+// the length of every opcode, undefined ones are a byte.
+static const uint8_t LENGTHS[0x100] = {
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 1, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        3, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 1, 3, 1, 1,
+        2, 2, 2, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+};
+
+// the code page is rom, stores to it are dropped.
+static uint8_t load(void *context, uint16_t addr) {
+    return ((machine_t*) context) -> memory[addr];
+}
+
+static void store(void *context, uint16_t addr, uint8_t value) {
+    (void) context;
+    (void) addr;
+    (void) value;
+}
+
+#ifdef CPU6502_PROFILE
+static void profile(void *context, uint16_t pc, uint32_t cycles) {
+    machine_t *machine = (machine_t*) context;
+    machine -> profiled++;
+    machine -> profiled_sum += (uint64_t) pc * cycles;
+}
+#endif
+
+static void open_machine(machine_t *machine, const uint8_t *memory) {
+    memcpy(machine -> memory, memory, MEMORY_SIZE);
+    for (uint32_t i = 0; i < 8; i++) {
+        machine -> memmap[i] = machine -> memory + i * 0x2000u;
+        machine -> page_flags[i] = PAGE_DIRECT_READ | PAGE_DIRECT_WRITE;
+    }
+    machine -> page_flags[LOOP_HEAD >> 13u] = PAGE_DIRECT_READ | PAGE_CODE_CACHE;
+    machine -> cpu = create_6502(load, store, machine, machine -> memmap, machine -> page_flags);
+    CHECK(machine -> cpu != NULL);
+#ifdef CPU6502_PROFILE
+    machine -> profiled = 0;
+    machine -> profiled_sum = 0;
+    set_6502_profiler(machine -> cpu, profile, machine);
+#endif
+}
+
+// anything but control flow, so the loop runs through to its end.
+static uint8_t random_opcode(uint32_t *seed) {
+    for (;;) {
+        uint8_t opcode = (uint8_t) next_random(seed);
+        switch (opcode) {
+            case 0x00: case 0x20: case 0x40: case 0x4C: case 0x60: case 0x6C:
+            case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xB0: case 0xD0: case 0xF0:
+                continue;
+            default:
+                return opcode;
+        }
+    }
+}
+
+// up to 3 random instructions, then a branch or jump back to the loop head.
+static uint16_t put_loop_part(uint8_t *memory, uint16_t pc, uint32_t *seed) {
+    uint32_t count = next_random(seed) % 4u;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t opcode = random_opcode(seed);
+        memory[pc] = opcode;
+        pc = (uint16_t) (pc + LENGTHS[opcode]);
+    }
+    if (next_random(seed) % 4u == 0) {
+        memory[pc] = JMP;
+        memory[pc + 1] = (uint8_t) LOOP_HEAD;
+        memory[pc + 2] = (uint8_t) (LOOP_HEAD >> 8u);
+        return (uint16_t) (pc + 3);
+    }
+    memory[pc] = BRANCHES[next_random(seed) % sizeof(BRANCHES)];
+    memory[pc + 1] = (uint8_t) (LOOP_HEAD - (pc + 2));
+    return (uint16_t) (pc + 2);
+}
+
+// new random zero page, stack and code around the loop, the rest stays from the trials before.
+static void run_trial(uint32_t trial, uint8_t *memory, machine_t *skipping, machine_t *stepping) {
+    uint32_t seed = trial;
+    for (uint32_t i = 0; i < 0x200u; i++) {
+        memory[i] = (uint8_t) next_random(&seed);
+        memory[LOOP_HEAD - 0x100u + i] = (uint8_t) next_random(&seed);
+    }
+    // the loop, and after it the other way back to its head, where the run starts.
+    uint16_t entry = put_loop_part(memory, LOOP_HEAD, &seed);
+    put_loop_part(memory, entry, &seed);
+    cpu_states_t states = {
+            entry, (uint8_t) next_random(&seed), (uint8_t) next_random(&seed), (uint8_t) next_random(&seed),
+            (uint8_t) next_random(&seed), (uint8_t) next_random(&seed)
+    };
+    uint64_t budget = 1000u + next_random(&seed) % 4000u;
+
+    open_machine(skipping, memory);
+    cpu_states_t skipped = states;
+    uint64_t skipped_cycles = execute_6502_until(skipping -> cpu, &skipped, budget);
+
+    open_machine(stepping, memory);
+    cpu_states_t stepped = states;
+    uint64_t stepped_cycles = 0;
+    while (stepped_cycles < budget) {
+        stepped_cycles += execute_6502_until(stepping -> cpu, &stepped, 0);
+    }
+
+    if (skipped_cycles != stepped_cycles || memcmp(&skipped, &stepped, sizeof(cpu_states_t)) != 0) {
+        fprintf(stderr, "trial %u: pc %04x after %llu cycles, stepping gets to %04x after %llu\n",
+                trial, skipped.reg_pc, (unsigned long long) skipped_cycles,
+                stepped.reg_pc, (unsigned long long) stepped_cycles);
+    }
+    CHECK(skipped_cycles == stepped_cycles);
+    CHECK(memcmp(&skipped, &stepped, sizeof(cpu_states_t)) == 0);
+    CHECK(memcmp(skipping -> memory, stepping -> memory, MEMORY_SIZE) == 0);
+#ifdef CPU6502_PROFILE
+    CHECK(skipping -> profiled == stepping -> profiled);
+    CHECK(skipping -> profiled_sum == stepping -> profiled_sum);
+#endif
+    destroy_6502(skipping -> cpu);
+    destroy_6502(stepping -> cpu);
+}
+
+int main() {
+    uint8_t *memory = (uint8_t*) malloc(MEMORY_SIZE);
+    machine_t *skipping = (machine_t*) malloc(sizeof(machine_t));
+    machine_t *stepping = (machine_t*) malloc(sizeof(machine_t));
+    CHECK(memory != NULL && skipping != NULL && stepping != NULL);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < MEMORY_SIZE; i++) {
+        memory[i] = (uint8_t) next_random(&seed);
+    }
+    for (uint32_t i = 1; i <= TRIALS; i++) {
+        run_trial(i, memory, skipping, stepping);
+    }
+    free(memory);
+    free(skipping);
+    free(stepping);
+    return 0;
+}
@@ -0,0 +1,231 @@
+//
+// Movies: a recorded session replays in sync on another machine, whatever that machine
+// was doing, and ends in the same states and nor, every time it is played. A movie of
+// another nor doesn't play, and one with a key moved goes out of sync.
+// Seeking from the keyframes of the index gets to the same machine as playing up to
+// there, also from an index cut short or one kept for another movie.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include "../wqx/nc1020_state_file.h"
+#include <string.h>
+#include <unistd.h>
+
+#define SLICES 2000u
+// the slices the nor is hashed after too, and seeked to.
+#define SEEK_STEP 40u
+// the seeks in a play, each plays on for up to a keyframe interval.
+#define SEEKS 12u
+// the kinds of records in a movie, in the low bits of their tag.
+#define RECORD_SLICE 1u
+#define RECORD_KEY 2u
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t hash;
+    uint64_t nor_hash;
+} point_t;
+
+// the states without their padding.
+static uint64_t hash_states(nc1020_t *nc) {
+    static uint8_t encoded[STATE_FILE_BOUND];
+    size_t size = encode_states(&nc -> states, encoded);
+    return hash_memory(encoded, size);
+}
+
+static bool is_seek_point(uint32_t slice) {
+    return slice % SEEK_STEP == SEEK_STEP - 1u || slice == SLICES - 1u;
+}
+
+static void check_point(nc1020_t *nc, const point_t *points, uint32_t slice) {
+    CHECK(get_cycles(nc) == points[slice].cycles);
+    CHECK(hash_states(nc) == points[slice].hash);
+    if (is_seek_point(slice)) {
+        CHECK(hash_memory(nc -> nor_buff, NOR_SIZE) == points[slice].nor_hash);
+    }
+}
+
+static void record(const test_files_t *files, const char *movie_file_path, point_t *points, uint32_t seed) {
+    static const uint8_t keys[] = {0x08, 0x0F, 0x10, 0x1A, 0x20, 0x3B};
+    nc1020_t *nc = open_test_machine(files);
+    run_time_slice(nc, 10, false);
+    CHECK(start_movie(nc, movie_file_path));
+    for (uint32_t i = 0; i < SLICES; i++) {
+        if (next_random(&seed) % 6u == 0) {
+            set_key(nc, keys[next_random(&seed) % sizeof(keys)], next_random(&seed) % 2u == 0);
+        }
+        // runs of equal slices, of a few lengths, some sped up.
+        uint32_t slice_ms = i / 50u % 2u == 0 ? 10u : 16u;
+        run_time_slice(nc, slice_ms, i % 97u < 5u);
+        points[i].cycles = get_cycles(nc);
+        points[i].hash = hash_states(nc);
+        points[i].nor_hash = is_seek_point(i) ? hash_memory(nc -> nor_buff, NOR_SIZE) : 0;
+    }
+    CHECK(stop_movie(nc));
+    destroy_nc1020(nc);
+}
+
+static void play(const test_files_t *files, const char *movie_file_path, const point_t *points) {
+    nc1020_t *nc = open_test_machine(files);
+    // where the machine is and the keys set before don't matter.
+    for (uint32_t i = 0; i < 30; i++) {
+        run_time_slice(nc, 10, false);
+    }
+    set_key(nc, 0x10, true);
+    CHECK(play_movie(nc, movie_file_path));
+    uint32_t slice = 0;
+    while (run_movie_slice(nc)) {
+        CHECK(slice < SLICES);
+        check_point(nc, points, slice);
+        slice++;
+    }
+    CHECK(slice == SLICES);
+    CHECK(stop_movie(nc));
+    destroy_nc1020(nc);
+}
+
+static uint8_t *read_movie(const char *movie_file_path, size_t *size) {
+    FILE *file = fopen(movie_file_path, "rbe");
+    CHECK(file != NULL);
+    CHECK(fseek(file, 0, SEEK_END) == 0);
+    long length = ftell(file);
+    CHECK(length > 0 && fseek(file, 0, SEEK_SET) == 0);
+    uint8_t *data = (uint8_t*) malloc((size_t) length);
+    CHECK(data != NULL && fread(data, 1, (size_t) length, file) == (size_t) length);
+    fclose(file);
+    *size = (size_t) length;
+    return data;
+}
+
+static void write_movie(const char *movie_file_path, const uint8_t *data, size_t size) {
+    FILE *file = fopen(movie_file_path, "wbe");
+    CHECK(file != NULL);
+    CHECK(fwrite(data, 1, size, file) == size);
+    CHECK(fclose(file) == 0);
+}
+
+static size_t skip_varint(const uint8_t *data, size_t offset) {
+    while (data[offset] & 0x80u) {
+        offset++;
+    }
+    return offset + 1;
+}
+
+// the cycles the first key comes at, one off, the records before it are slices.
+static void move_first_key(uint8_t *data, size_t size) {
+    uint64_t state_size;
+    memcpy(&state_size, data + 24, sizeof(state_size));
+    size_t offset = 32 + (size_t) state_size;
+    while (offset < size && (data[offset] & 0x7Fu) == RECORD_SLICE) {
+        offset = skip_varint(data, skip_varint(data, offset + 1));
+    }
+    CHECK(offset + 2 < size && (data[offset] & 0x7Fu) == RECORD_KEY);
+    data[offset + 2] ^= 1u;
+}
+
+static void test_damaged(const test_files_t *files, const char *movie_file_path) {
+    size_t size;
+    uint8_t *data = read_movie(movie_file_path, &size);
+    char damaged_file_path[TEST_PATH_LENGTH + 16];
+    snprintf(damaged_file_path, sizeof(damaged_file_path), "%s/damaged.mov", files -> dir);
+
+    nc1020_t *nc = open_test_machine(files);
+    move_first_key(data, size);
+    write_movie(damaged_file_path, data, size);
+    CHECK(play_movie(nc, damaged_file_path));
+    while (run_movie_slice(nc)) {
+    }
+    CHECK(!stop_movie(nc));
+
+    // the hash of the nor it was recorded on.
+    data[16] ^= 1u;
+    write_movie(damaged_file_path, data, size);
+    CHECK(!play_movie(nc, damaged_file_path));
+    destroy_nc1020(nc);
+    free(data);
+}
+
+// the seek points in a random order, back and forth across the keyframes, then past the end.
+static void seek(const test_files_t *files, const char *movie_file_path, const point_t *points, uint32_t seed) {
+    nc1020_t *nc = open_test_machine(files);
+    CHECK(play_movie(nc, movie_file_path));
+    for (uint32_t i = 0; i < SEEKS; i++) {
+        uint32_t slice = next_random(&seed) % (SLICES / SEEK_STEP) * SEEK_STEP + SEEK_STEP - 1u;
+        CHECK(seek_movie(nc, points[slice].cycles));
+        check_point(nc, points, slice);
+    }
+    CHECK(seek_movie(nc, points[SLICES - 1].cycles));
+    check_point(nc, points, SLICES - 1);
+    // what was written to the nor after a keyframe is undone going back to it.
+    uint8_t *ptr = nc -> nor_buff + next_random(&seed) % NOR_SIZE;
+    *ptr = (uint8_t) ~*ptr;
+    mark_nor_dirty(nc, ptr, 1);
+    CHECK(seek_movie(nc, points[SEEK_STEP - 1].cycles));
+    check_point(nc, points, SEEK_STEP - 1);
+    CHECK(!seek_movie(nc, points[SLICES - 1].cycles + 1));
+    CHECK(stop_movie(nc));
+    destroy_nc1020(nc);
+}
+
+// the keyframes in an index, and its size.
+static uint32_t count_keyframes(const char *index_file_path, size_t *size) {
+    uint8_t *data = read_movie(index_file_path, size);
+    uint32_t count = 0;
+    size_t offset = 32;
+    while (offset + 64 <= *size) {
+        uint64_t payload_size;
+        memcpy(&payload_size, data + offset + 48, sizeof(payload_size));
+        offset += 64u + (size_t) payload_size;
+        count++;
+    }
+    CHECK(offset == *size);
+    free(data);
+    return count;
+}
+
+static void test_seek(const test_files_t *files, const char *movie_file_path, const point_t *points) {
+    char index_file_path[TEST_PATH_LENGTH + 32];
+    snprintf(index_file_path, sizeof(index_file_path), "%s.idx", movie_file_path);
+    // the plays so far kept one at the start and one every 10 s.
+    size_t size;
+    uint32_t count = count_keyframes(index_file_path, &size);
+    CHECK(count >= 3);
+    seek(files, movie_file_path, points, 1);
+
+    // a torn last keyframe is cut off and written again.
+    CHECK(truncate(index_file_path, (off_t) size - 100) == 0);
+    seek(files, movie_file_path, points, 2);
+    size_t rewritten_size;
+    CHECK(count_keyframes(index_file_path, &rewritten_size) == count && rewritten_size == size);
+
+    // the keyframes of another movie from the same machine are thrown away.
+    char other_file_path[TEST_PATH_LENGTH + 16];
+    snprintf(other_file_path, sizeof(other_file_path), "%s/other.mov", files -> dir);
+    point_t *other_points = (point_t*) malloc(SLICES * sizeof(point_t));
+    CHECK(other_points != NULL);
+    record(files, other_file_path, other_points, 2);
+    seek(files, other_file_path, other_points, 3);
+    free(other_points);
+    char other_index_file_path[TEST_PATH_LENGTH + 32];
+    snprintf(other_index_file_path, sizeof(other_index_file_path), "%s.idx", other_file_path);
+    CHECK(rename(other_index_file_path, index_file_path) == 0);
+    seek(files, movie_file_path, points, 4);
+}
+
+int main() {
+    test_files_t files;
+    make_test_files(&files, 5);
+    char movie_file_path[TEST_PATH_LENGTH + 16];
+    snprintf(movie_file_path, sizeof(movie_file_path), "%s/test.mov", files.dir);
+    point_t *points = (point_t*) malloc(SLICES * sizeof(point_t));
+    CHECK(points != NULL);
+    record(&files, movie_file_path, points, 1);
+    play(&files, movie_file_path, points);
+    play(&files, movie_file_path, points);
+    test_damaged(&files, movie_file_path);
+    test_seek(&files, movie_file_path, points);
+    free(points);
+    remove_test_files(&files);
+    return 0;
+}
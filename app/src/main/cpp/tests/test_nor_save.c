@@ -0,0 +1,130 @@
+//
+// Saving the nor: bytes programmed and sectors erased through the flash commands of the
+// cpu land in the file, and a save writes only the sectors changed since the last one.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+
+#define PROGRAMS 200u
+#define ERASES 4u
+// a sector the commands never touch, changed in the file behind the machine's back.
+#define UNTOUCHED_SECTOR 300u
+
+static uint8_t *read_nor(const char *nor_file_path) {
+    uint8_t *data = (uint8_t*) malloc(NOR_SIZE);
+    CHECK(data != NULL);
+    FILE *file = fopen(nor_file_path, "rbe");
+    CHECK(file != NULL);
+    CHECK(fread(data, 1, NOR_SIZE, file) == NOR_SIZE);
+    fclose(file);
+    return data;
+}
+
+static void write_untouched_sector(const char *nor_file_path, uint8_t value) {
+    uint8_t sector[NOR_SECTOR_SIZE];
+    memset(sector, value, sizeof(sector));
+    FILE *file = fopen(nor_file_path, "r+be");
+    CHECK(file != NULL);
+    CHECK(fseek(file, UNTOUCHED_SECTOR * NOR_SECTOR_SIZE, SEEK_SET) == 0);
+    CHECK(fwrite(sector, 1, sizeof(sector), file) == sizeof(sector));
+    CHECK(fclose(file) == 0);
+}
+
+static void send_command(nc1020_t *nc, uint8_t bank_idx, uint8_t command) {
+    store_memory(nc, 0x00, bank_idx);
+    store_memory(nc, 0x5555, 0xAA);
+    store_memory(nc, 0xAAAA, 0x55);
+    store_memory(nc, 0x5555, command);
+}
+
+// the offset in the nor of what the cpu sees at addr in a bank.
+static uint32_t get_nor_offset(uint8_t bank_idx, uint16_t addr) {
+    return bank_idx * 0x8000u + get_bank_offset(addr - 0x4000u);
+}
+
+static bool is_untouched(uint32_t offset) {
+    return offset / NOR_SECTOR_SIZE == UNTOUCHED_SECTOR;
+}
+
+static void program(nc1020_t *nc, uint8_t *expected, uint32_t *seed) {
+    uint8_t bank_idx = (uint8_t) (next_random(seed) % 0x20u);
+    uint16_t addr = (uint16_t) (0x4000u + next_random(seed) % 0x8000u);
+    uint8_t value = (uint8_t) next_random(seed);
+    if (is_untouched(get_nor_offset(bank_idx, addr))) {
+        return;
+    }
+    send_command(nc, bank_idx, 0xA0);
+    store_memory(nc, addr, value);
+    // the status read ends the command.
+    CHECK(load_memory(nc, 0x4000) == 0x88);
+    expected[get_nor_offset(bank_idx, addr)] &= value;
+}
+
+static void erase_sector(nc1020_t *nc, uint8_t *expected, uint32_t *seed) {
+    uint8_t bank_idx = (uint8_t) (next_random(seed) % 0x20u);
+    uint16_t addr = (uint16_t) (0x4000u + next_random(seed) % 0x8000u);
+    uint16_t sector_addr = (uint16_t) (addr - addr % NOR_SECTOR_SIZE);
+    if (is_untouched(get_nor_offset(bank_idx, sector_addr))) {
+        return;
+    }
+    send_command(nc, bank_idx, 0x80);
+    store_memory(nc, 0x5555, 0xAA);
+    store_memory(nc, 0xAAAA, 0x55);
+    store_memory(nc, addr, 0x30);
+    CHECK(load_memory(nc, 0x4000) == 0x88);
+    memset(expected + get_nor_offset(bank_idx, sector_addr), 0xFF, NOR_SECTOR_SIZE);
+}
+
+static void run_commands(nc1020_t *nc, uint8_t *expected, uint32_t *seed) {
+    for (uint32_t i = 0; i < PROGRAMS; i++) {
+        if (i % (PROGRAMS / ERASES) == 0) {
+            erase_sector(nc, expected, seed);
+        }
+        program(nc, expected, seed);
+    }
+    CHECK(memcmp(nc -> nor_buff, expected, NOR_SIZE) == 0);
+}
+
+static void save(nc1020_t *nc) {
+    save_nc1020(nc);
+    CHECK(flush_nc1020(nc));
+}
+
+int main() {
+    test_files_t files;
+    make_test_files(&files, 2);
+    uint8_t *expected = read_nor(files.nor);
+    uint32_t seed = 1;
+    nc1020_t *nc = open_test_machine(&files);
+    run_commands(nc, expected, &seed);
+    save(nc);
+    uint8_t *saved = read_nor(files.nor);
+    CHECK(memcmp(saved, expected, NOR_SIZE) == 0);
+    free(saved);
+
+    // the saves from here on would overwrite this sector if they wrote more than changed.
+    write_untouched_sector(files.nor, 0x5A);
+    save(nc);
+    run_commands(nc, expected, &seed);
+    save(nc);
+    saved = read_nor(files.nor);
+    for (uint32_t i = 0; i < NOR_SECTOR_SIZE; i++) {
+        CHECK(saved[UNTOUCHED_SECTOR * NOR_SECTOR_SIZE + i] == 0x5A);
+    }
+    memset(expected + UNTOUCHED_SECTOR * NOR_SECTOR_SIZE, 0x5A, NOR_SECTOR_SIZE);
+    CHECK(memcmp(saved, expected, NOR_SIZE) == 0);
+    free(saved);
+    destroy_nc1020(nc);
+
+    nc = create_nc1020();
+    CHECK(nc != NULL);
+    CHECK(initialize(nc, files.rom, files.nor, files.state));
+    load_nc1020(nc);
+    CHECK(memcmp(nc -> nor_buff, expected, NOR_SIZE) == 0);
+    destroy_nc1020(nc);
+    free(expected);
+    remove_test_files(&files);
+    return 0;
+}
@@ -0,0 +1,68 @@
+//
+// The nor overlay: saves to an overlay with a bad or old header start it over, they
+// aren't appended where no load would find them. A path too long is refused whole.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+
+#define MARKED_SECTOR 200u
+
+static nc1020_t *open_machine(const test_files_t *files) {
+    nc1020_t *nc = create_nc1020();
+    CHECK(nc != NULL);
+    CHECK(set_nor_overlay(nc, files -> overlay));
+    CHECK(initialize(nc, files -> rom, files -> nor, files -> state));
+    reset(nc);
+    return nc;
+}
+
+static void test_bad_header(const char *header, size_t size) {
+    test_files_t files;
+    make_test_files(&files, 1);
+    FILE *file = fopen(files.overlay, "wbe");
+    CHECK(file != NULL);
+    CHECK(fwrite(header, 1, size, file) == size);
+    CHECK(fclose(file) == 0);
+
+    nc1020_t *nc = open_machine(&files);
+    uint8_t *sector = nc -> nor_buff + MARKED_SECTOR * NOR_SECTOR_SIZE;
+    memset(sector, 0x5A, NOR_SECTOR_SIZE);
+    mark_nor_dirty(nc, sector, NOR_SECTOR_SIZE);
+    save_nc1020(nc);
+    CHECK(flush_nc1020(nc));
+    destroy_nc1020(nc);
+
+    nc = open_machine(&files);
+    sector = nc -> nor_buff + MARKED_SECTOR * NOR_SECTOR_SIZE;
+    for (uint32_t i = 0; i < NOR_SECTOR_SIZE; i++) {
+        CHECK(sector[i] == 0x5A);
+    }
+    destroy_nc1020(nc);
+    remove_test_files(&files);
+}
+
+static void test_long_path(void) {
+    test_files_t files;
+    make_test_files(&files, 1);
+    nc1020_t *nc = open_machine(&files);
+    char long_path[MAX_FILE_NAME_LENGTH + 2];
+    memset(long_path, 'a', sizeof(long_path) - 1);
+    long_path[sizeof(long_path) - 1] = '\0';
+    CHECK(!set_nor_overlay(nc, long_path));
+    CHECK(strcmp(nc -> overlay_file_path, files.overlay) == 0);
+    destroy_nc1020(nc);
+    remove_test_files(&files);
+}
+
+int main() {
+    // another magic, a version from the future, and a header cut short.
+    static const char other_magic[16] = "NOTANOVERLAY....";
+    static const char other_version[16] = {'N', 'C', '1', '0', '2', '0', 'N', 'O', 99, 0, 0, 0, 0, 8, 0, 0};
+    test_bad_header(other_magic, sizeof(other_magic));
+    test_bad_header(other_version, sizeof(other_version));
+    test_bad_header(other_version, 5);
+    test_long_path();
+    return 0;
+}
@@ -0,0 +1,96 @@
+//
+// Rewinding: every snapshot still in the ring puts back the states and the nor a machine
+// without rewind had at the same cycles, and running on from it with the same keys ends
+// where that machine ends. Also with a ring too small to keep all of them.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+
+#define SLICES 300u
+#define SLICE_MS 10u
+#define REWIND_INTERVAL_MS 50u
+
+typedef struct {
+    nc1020_states_t states;
+    uint64_t nor_hash;
+} point_t;
+
+// the keys and the nor writes of a slice, the same whenever it runs.
+static void run_slice(nc1020_t *nc, uint32_t slice) {
+    static const uint8_t keys[] = {0x08, 0x0F, 0x10, 0x1A, 0x20, 0x3B};
+    uint32_t seed = slice * 2654435761u + 1u;
+    if (next_random(&seed) % 8u == 0) {
+        set_key(nc, keys[next_random(&seed) % sizeof(keys)], next_random(&seed) % 2u == 0);
+    }
+    if (slice % 7u == 0) {
+        uint8_t *ptr = nc -> nor_buff + next_random(&seed) % NOR_SIZE;
+        *ptr = (uint8_t) next_random(&seed);
+        mark_nor_dirty(nc, ptr, 1);
+    }
+    run_time_slice(nc, SLICE_MS, false);
+}
+
+static uint32_t find_point(const point_t *points, uint64_t cycles) {
+    for (uint32_t i = 0; i < SLICES; i++) {
+        if (points[i].states.cycles == cycles) {
+            return i;
+        }
+    }
+    CHECK(false);
+    return 0;
+}
+
+static void check_point(nc1020_t *nc, const point_t *point) {
+    CHECK(memcmp(&nc -> states, &point -> states, sizeof(nc1020_states_t)) == 0);
+    CHECK(hash_memory(nc -> nor_buff, NOR_SIZE) == point -> nor_hash);
+}
+
+static void test_rewind(const test_files_t *files, const point_t *points, uint32_t budget) {
+    nc1020_t *nc = open_test_machine(files);
+    set_rewind(nc, REWIND_INTERVAL_MS, budget);
+    for (uint32_t i = 0; i < SLICES; i++) {
+        run_slice(nc, i);
+    }
+    uint32_t count = get_rewind_points(nc);
+    CHECK(count > 1);
+    CHECK(!rewind_nc1020(nc, count));
+
+    // back to each snapshot in turn, newest first, then on to the end from the oldest.
+    uint32_t slice = SLICES;
+    for (uint32_t point = count; point > 0; point--) {
+        CHECK(rewind_nc1020(nc, point == count ? 0 : 1));
+        CHECK(get_rewind_points(nc) == point);
+        uint32_t found = find_point(points, nc -> states.cycles);
+        CHECK(found < slice);
+        slice = found;
+        check_point(nc, &points[slice]);
+    }
+    for (uint32_t i = slice + 1; i < SLICES; i++) {
+        run_slice(nc, i);
+    }
+    check_point(nc, &points[SLICES - 1]);
+    destroy_nc1020(nc);
+}
+
+int main() {
+    test_files_t files;
+    make_test_files(&files, 5);
+    point_t *points = (point_t*) malloc(SLICES * sizeof(point_t));
+    CHECK(points != NULL);
+    nc1020_t *nc = open_test_machine(&files);
+    for (uint32_t i = 0; i < SLICES; i++) {
+        run_slice(nc, i);
+        points[i].states = nc -> states;
+        points[i].nor_hash = hash_memory(nc -> nor_buff, NOR_SIZE);
+    }
+    destroy_nc1020(nc);
+
+    test_rewind(&files, points, 16u << 20u);
+    // about half of the snapshots fit.
+    test_rewind(&files, points, 4u << 10u);
+    free(points);
+    remove_test_files(&files);
+    return 0;
+}
@@ -0,0 +1,110 @@
+//
+// The mapped rom: the cpu sees every bank as the file has it with its 16K halves swapped,
+// zeros past the end of a short file, and machines on the same file share one mapping.
+// A rom that can't be loaded fails initialize and leaves the machine as it was.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+
+#define BANKS_CHECKED 64u
+
+static uint8_t *read_rom(const char *rom_file_path) {
+    uint8_t *data = (uint8_t*) calloc(1, ROM_SIZE);
+    CHECK(data != NULL);
+    FILE *file = fopen(rom_file_path, "rbe");
+    CHECK(file != NULL);
+    CHECK(fread(data, 1, ROM_SIZE, file) == ROM_SIZE);
+    fclose(file);
+    return data;
+}
+
+// what the cpu reads from 0x4000 to 0xBFFF in a bank of a volume, against the file.
+static void check_bank(nc1020_t *nc, const uint8_t *rom, uint8_t volume_idx, uint8_t bank_idx) {
+    store_memory(nc, 0x0D, volume_idx);
+    store_memory(nc, 0x00, bank_idx);
+    uint32_t volume = volume_idx & 0x01u ? 1u : volume_idx & 0x02u ? 2u : 0u;
+    const uint8_t *bank = rom + 0x8000u * (volume * 0x100u + bank_idx);
+    for (uint32_t addr = 0x4000; addr < 0xC000; addr++) {
+        CHECK(load_memory(nc, (uint16_t) addr) == bank[(addr - 0x4000u) ^ 0x4000u]);
+    }
+}
+
+static void check_banks(nc1020_t *nc, const uint8_t *rom, uint32_t seed) {
+    static const uint8_t volumes[] = {0x00, 0x01, 0x02, 0x03};
+    for (uint32_t i = 0; i < BANKS_CHECKED; i++) {
+        uint8_t volume_idx = volumes[next_random(&seed) % sizeof(volumes)];
+        check_bank(nc, rom, volume_idx, (uint8_t) (0x80u | next_random(&seed)));
+    }
+}
+
+static void test_mapping(void) {
+    test_files_t files;
+    make_test_files(&files, 2);
+    uint8_t *rom = read_rom(files.rom);
+    nc1020_t *nc = open_test_machine(&files);
+    nc1020_t *other = open_test_machine(&files);
+    CHECK(nc -> rom == other -> rom);
+    check_banks(nc, rom, 1);
+    check_banks(other, rom, 2);
+    destroy_nc1020(other);
+    destroy_nc1020(nc);
+    free(rom);
+    remove_test_files(&files);
+}
+
+static void test_short_file(void) {
+    test_files_t files;
+    make_test_files(&files, 3);
+    uint8_t *rom = read_rom(files.rom);
+    char short_rom[TEST_PATH_LENGTH + 16];
+    snprintf(short_rom, sizeof(short_rom), "%s/short.bin", files.dir);
+    FILE *file = fopen(short_rom, "wbe");
+    CHECK(file != NULL);
+    CHECK(fwrite(rom, 1, ROM_SIZE / 2, file) == ROM_SIZE / 2);
+    CHECK(fclose(file) == 0);
+    memset(rom + ROM_SIZE / 2, 0, ROM_SIZE / 2);
+
+    nc1020_t *nc = create_nc1020();
+    CHECK(nc != NULL);
+    CHECK(initialize(nc, short_rom, files.nor, files.state));
+    reset(nc);
+    check_banks(nc, rom, 3);
+    destroy_nc1020(nc);
+    free(rom);
+    remove_test_files(&files);
+}
+
+static void test_bad_rom(void) {
+    test_files_t files;
+    make_test_files(&files, 5);
+    uint8_t *rom = read_rom(files.rom);
+    nc1020_t *nc = open_test_machine(&files);
+    nc1020_rom_t *loaded = nc -> rom;
+
+    char missing[TEST_PATH_LENGTH + 16];
+    snprintf(missing, sizeof(missing), "%s/missing.bin", files.dir);
+    CHECK(!initialize(nc, missing, files.nor, files.state));
+    char long_path[MAX_FILE_NAME_LENGTH + 2];
+    memset(long_path, 'a', sizeof(long_path) - 1);
+    long_path[sizeof(long_path) - 1] = '\0';
+    CHECK(!initialize(nc, long_path, files.nor, files.state));
+    CHECK(!initialize(nc, files.rom, long_path, files.state));
+    CHECK(!initialize(nc, files.rom, files.nor, long_path));
+
+    CHECK(nc -> rom == loaded);
+    CHECK(strcmp(nc -> nor_file_path, files.nor) == 0);
+    CHECK(strcmp(nc -> state_file_path, files.state) == 0);
+    check_banks(nc, rom, 5);
+    destroy_nc1020(nc);
+    free(rom);
+    remove_test_files(&files);
+}
+
+int main() {
+    test_mapping();
+    test_short_file();
+    test_bad_rom();
+    return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Running ahead: it leaves the machine as it would be without, and keys set from another
+// thread while it runs ahead are still held afterwards.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define SLICE_MS 10u
+#define RUN_AHEAD_MS 16u
+#define HELD_KEY 0x10u
+
+typedef struct {
+    nc1020_t *nc;
+    uint32_t seed;
+} presser_t;
+
+// presses and releases the key a random number of times, ending with it pressed.
+static void *press_keys(void *context) {
+    presser_t *presser = (presser_t*) context;
+    uint32_t count = next_random(&presser -> seed) % 64u;
+    for (uint32_t i = 0; i < count; i++) {
+        set_key(presser -> nc, HELD_KEY, i % 2u == 0);
+        if (next_random(&presser -> seed) % 4u == 0) {
+            sched_yield();
+        }
+    }
+    set_key(presser -> nc, HELD_KEY, true);
+    return NULL;
+}
+
+static bool is_held(nc1020_t *nc) {
+    return (nc -> states.keypad_matrix[HELD_KEY % 8u] & (1u << (HELD_KEY / 8u))) != 0;
+}
+
+static void test_keys_held(void) {
+    test_files_t files;
+    make_test_files(&files, 2);
+    nc1020_t *nc = open_test_machine(&files);
+    set_run_ahead(nc, RUN_AHEAD_MS);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < 200; i++) {
+        set_key(nc, HELD_KEY, false);
+        run_time_slice(nc, SLICE_MS, false);
+        CHECK(!is_held(nc));
+        presser_t presser = {nc, next_random(&seed)};
+        pthread_t thread;
+        CHECK(pthread_create(&thread, NULL, press_keys, &presser) == 0);
+        for (uint32_t j = 0; j < 4; j++) {
+            run_time_slice(nc, SLICE_MS, false);
+        }
+        CHECK(pthread_join(thread, NULL) == 0);
+        run_time_slice(nc, SLICE_MS, false);
+        CHECK(is_held(nc));
+    }
+    destroy_nc1020(nc);
+    remove_test_files(&files);
+}
+
+// the same keys at the same slices, with and without running ahead.
+static void run_keys(nc1020_t *nc, uint32_t seed) {
+    static const uint8_t keys[] = {0x08, 0x0F, 0x10, 0x1A, 0x20, 0x3B};
+    for (uint32_t i = 0; i < 400; i++) {
+        if (next_random(&seed) % 8u == 0) {
+            uint8_t key_id = keys[next_random(&seed) % sizeof(keys)];
+            set_key(nc, key_id, next_random(&seed) % 2u == 0);
+        }
+        run_time_slice(nc, SLICE_MS, next_random(&seed) % 16u == 0);
+    }
+}
+
+static void test_same_end(void) {
+    test_files_t files;
+    make_test_files(&files, 5);
+    nc1020_t *plain = open_test_machine(&files);
+    nc1020_t *ahead = open_test_machine(&files);
+    set_run_ahead(ahead, RUN_AHEAD_MS);
+    run_keys(plain, 7);
+    run_keys(ahead, 7);
+    CHECK(memcmp(&plain -> states, &ahead -> states, sizeof(nc1020_states_t)) == 0);
+    CHECK(memcmp(plain -> nor_buff, ahead -> nor_buff, NOR_SIZE) == 0);
+    destroy_nc1020(plain);
+    destroy_nc1020(ahead);
+    remove_test_files(&files);
+}
+
+int main() {
+    test_keys_held();
+    test_same_end();
+    return 0;
+}
@@ -0,0 +1,119 @@
+//
+// Saves killed at random points: whatever the machine was doing, the files loaded
+// afterwards are a pair from one save, the nor and the states together.
+// Every save bumps a generation kept in the ram and in one of a few nor sectors, so
+// a loaded pair shows which save its parts are from. A read only machine loading them
+// first leaves a cut short save to the next one, and drops its own saves.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MARKED_SECTORS 8u
+#define FIRST_MARKED_SECTOR 100u
+#define RAM_MARK 0x2000u
+#define KILLS 40
+
+static uint32_t *get_mark(nc1020_t *nc, uint32_t generation) {
+    uint32_t sector = FIRST_MARKED_SECTOR + generation % MARKED_SECTORS;
+    return (uint32_t*) (nc -> nor_buff + sector * NOR_SECTOR_SIZE);
+}
+
+static nc1020_t *open_machine(const test_files_t *files, bool overlay) {
+    nc1020_t *nc = create_nc1020();
+    CHECK(nc != NULL);
+    CHECK(set_nor_overlay(nc, overlay ? files -> overlay : ""));
+    CHECK(initialize(nc, files -> rom, files -> nor, files -> state));
+    return nc;
+}
+
+// loads and saves a bumped mark without touching the files.
+static void load_read_only(const test_files_t *files, bool overlay) {
+    char journal_file_path[256];
+    snprintf(journal_file_path, sizeof(journal_file_path), "%s.journal", overlay ? files -> overlay : files -> nor);
+    bool journaled = access(journal_file_path, F_OK) == 0;
+    nc1020_t *nc = open_machine(files, overlay);
+    set_read_only(nc, true);
+    load_nc1020(nc);
+    CHECK((access(journal_file_path, F_OK) == 0) == journaled);
+    uint32_t *mark = get_mark(nc, 0);
+    (*mark)++;
+    mark_nor_dirty(nc, (uint8_t*) mark, sizeof(uint32_t));
+    get_ram_buffer(nc)[RAM_MARK]++;
+    save_nc1020(nc);
+    CHECK(flush_nc1020(nc));
+    destroy_nc1020(nc);
+}
+
+static void save_forever(const test_files_t *files, bool overlay) {
+    nc1020_t *nc = open_machine(files, overlay);
+    load_nc1020(nc);
+    uint32_t first;
+    memcpy(&first, get_ram_buffer(nc) + RAM_MARK, sizeof(first));
+    for (uint32_t generation = first + 1;; generation++) {
+        uint32_t *mark = get_mark(nc, generation);
+        *mark = generation;
+        mark_nor_dirty(nc, (uint8_t*) mark, sizeof(uint32_t));
+        memcpy(get_ram_buffer(nc) + RAM_MARK, &generation, sizeof(generation));
+        save_nc1020(nc);
+        if (generation % 3 == 0) {
+            flush_nc1020(nc);
+        }
+    }
+}
+
+static void test_kills(bool overlay, uint32_t seed) {
+    test_files_t files;
+    make_test_files(&files, seed);
+    nc1020_t *nc = open_machine(&files, overlay);
+    reset(nc);
+    uint32_t original[MARKED_SECTORS];
+    for (uint32_t i = 0; i < MARKED_SECTORS; i++) {
+        original[i] = *get_mark(nc, i);
+    }
+    destroy_nc1020(nc);
+
+    uint32_t random = seed;
+    uint32_t last = 0;
+    for (int kill_count = 0; kill_count < KILLS; kill_count++) {
+        fflush(NULL);
+        pid_t child = fork();
+        CHECK(child >= 0);
+        if (child == 0) {
+            save_forever(&files, overlay);
+        }
+        usleep(1000 + next_random(&random) % 20000);
+        kill(child, SIGKILL);
+        CHECK(waitpid(child, NULL, 0) == child);
+
+        load_read_only(&files, overlay);
+        nc = open_machine(&files, overlay);
+        load_nc1020(nc);
+        uint32_t generation;
+        memcpy(&generation, get_ram_buffer(nc) + RAM_MARK, sizeof(generation));
+        // every sector has the generation of the last save to it up to the loaded one.
+        for (uint32_t i = 0; i < MARKED_SECTORS; i++) {
+            uint32_t expected = original[i];
+            for (uint32_t g = 1; g <= generation; g++) {
+                if (g % MARKED_SECTORS == i) {
+                    expected = g;
+                }
+            }
+            CHECK(*get_mark(nc, i) == expected);
+        }
+        last = generation > last ? generation : last;
+        destroy_nc1020(nc);
+    }
+    CHECK(last > 0);
+    remove_test_files(&files);
+}
+
+int main() {
+    test_kills(false, 1);
+    test_kills(true, 2);
+    return 0;
+}
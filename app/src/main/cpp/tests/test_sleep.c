@@ -0,0 +1,55 @@
+//
+// Halting the cpu through the clock control port: the store that clears bit 3 of port
+// 05 is the last instruction that runs, whatever is left of the budget.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_context.h"
+#include <string.h>
+
+#define CODE 0x300u
+// the pc after the store that halts.
+#define HALTED_PC (CODE + 8u)
+
+static void put_code(nc1020_t *nc) {
+    static const uint8_t code[] = {
+            0xA9, 0x08, // lda #8
+            0x85, 0x05, // sta $05, running
+            0xA9, 0x00, // lda #0
+            0x85, 0x05, // sta $05, halted
+            0xE8, // inx
+            0x4C, HALTED_PC & 0xFFu, HALTED_PC >> 8u, // jmp back to the inx
+    };
+    memcpy(get_ram_buffer(nc) + CODE, code, sizeof(code));
+    nc -> states.cpu.reg_pc = CODE;
+    nc -> states.cpu.reg_x = 0;
+    // no interrupt gets in between.
+    nc -> states.cpu.reg_ps |= 0x04u;
+    nc -> states.should_irq = false;
+    nc -> states.slept = false;
+}
+
+int main() {
+    test_files_t files;
+    make_test_files(&files, 2);
+    nc1020_t *nc = open_test_machine(&files);
+
+    // with the whole budget left after the halt.
+    put_code(nc);
+    uint64_t cycles = execute_6502_until(nc -> cpu, &nc -> states.cpu, 100000);
+    CHECK(nc -> states.slept);
+    CHECK(nc -> states.cpu.reg_pc == HALTED_PC);
+    CHECK(nc -> states.cpu.reg_x == 0);
+    CHECK(cycles < 100);
+
+    // storing 8 again keeps it running, the loop goes on to the budget.
+    put_code(nc);
+    get_ram_buffer(nc)[CODE + 5] = 0x08;
+    execute_6502_until(nc -> cpu, &nc -> states.cpu, 1000);
+    CHECK(!nc -> states.slept);
+    CHECK(nc -> states.cpu.reg_x != 0);
+
+    destroy_nc1020(nc);
+    remove_test_files(&files);
+    return 0;
+}
@@ -0,0 +1,198 @@
+//
+// The state file and its compressor: random states and data come back the same, files cut
+// short are rejected, sections a file lacks keep their values, sections it doesn't know
+// are skipped, and the raw states of version 6 still load.
+//
+
+#include "test_support.h"
+#include "../wqx/nc1020_state_file.h"
+#include <string.h>
+
+#define LZ_MAX_SIZE 0x10000u
+#define LZ_TRIALS 500u
+#define CUTS 300u
+
+static void fill_random(uint8_t *data, size_t size, uint32_t *seed) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t) next_random(seed);
+    }
+}
+
+// random bytes, runs, and repeats of earlier bytes near and far, in random pieces.
+static void fill_compressible(uint8_t *data, size_t size, uint32_t *seed) {
+    size_t i = 0;
+    while (i < size) {
+        size_t length = 1u + next_random(seed) % 300u;
+        if (length > size - i) {
+            length = size - i;
+        }
+        switch (next_random(seed) % 3u) {
+            case 0:
+                fill_random(data + i, length, seed);
+                break;
+            case 1:
+                memset(data + i, (uint8_t) next_random(seed), length);
+                break;
+            default:
+                if (i == 0) {
+                    fill_random(data, length, seed);
+                } else {
+                    size_t from = next_random(seed) % i;
+                    for (size_t j = 0; j < length; j++) {
+                        data[i + j] = data[from + j];
+                    }
+                }
+                break;
+        }
+        i += length;
+    }
+}
+
+static void test_lz(void) {
+    uint8_t *data = (uint8_t*) malloc(LZ_MAX_SIZE);
+    uint8_t *compressed = (uint8_t*) malloc(LZ_BOUND(LZ_MAX_SIZE));
+    uint8_t *decompressed = (uint8_t*) malloc(LZ_MAX_SIZE);
+    CHECK(data != NULL && compressed != NULL && decompressed != NULL);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < LZ_TRIALS; i++) {
+        size_t size = i < 16 ? i : next_random(&seed) % LZ_MAX_SIZE;
+        if (i % 4u == 0) {
+            fill_random(data, size, &seed);
+        } else {
+            fill_compressible(data, size, &seed);
+        }
+        size_t compressed_size = lz_compress(data, size, compressed, LZ_BOUND(size));
+        CHECK(compressed_size > 0 || size == 0);
+        CHECK(lz_decompress(compressed, compressed_size, decompressed, size));
+        CHECK(memcmp(data, decompressed, size) == 0);
+        if (compressed_size > 1) {
+            // cut short, or expected to be longer or shorter than it is.
+            CHECK(!lz_decompress(compressed, compressed_size / 2, decompressed, size));
+            CHECK(!lz_decompress(compressed, compressed_size, decompressed, size + 1));
+            CHECK(size == 0 || !lz_decompress(compressed, compressed_size, decompressed, size - 1));
+            // too little room fails instead of writing past it.
+            compressed[compressed_size - 1] = 0xA5;
+            size_t smaller = lz_compress(data, size, compressed, compressed_size - 1);
+            CHECK(smaller < compressed_size && compressed[compressed_size - 1] == 0xA5);
+        }
+    }
+    free(data);
+    free(compressed);
+    free(decompressed);
+}
+
+// every field random, the padding stays zero so whole states compare.
+static void make_states(nc1020_states_t *states, uint32_t seed) {
+    memset(states, 0, sizeof(nc1020_states_t));
+    states -> cpu.reg_pc = (uint16_t) next_random(&seed);
+    states -> cpu.reg_a = (uint8_t) next_random(&seed);
+    states -> cpu.reg_ps = (uint8_t) next_random(&seed);
+    states -> cpu.reg_x = (uint8_t) next_random(&seed);
+    states -> cpu.reg_y = (uint8_t) next_random(&seed);
+    states -> cpu.reg_sp = (uint8_t) next_random(&seed);
+    fill_compressible(states -> ram, sizeof(states -> ram), &seed);
+    fill_random(states -> bak_40, sizeof(states -> bak_40), &seed);
+    fill_random(states -> clock_data, sizeof(states -> clock_data), &seed);
+    states -> clock_flags = (uint8_t) next_random(&seed);
+    fill_random(states -> jg_wav_data, sizeof(states -> jg_wav_data), &seed);
+    states -> jg_wav_flags = (uint8_t) next_random(&seed);
+    states -> jg_wav_idx = (uint8_t) next_random(&seed);
+    states -> jg_wav_playing = next_random(&seed) % 2u == 0;
+    states -> fp_step = (uint8_t) next_random(&seed);
+    states -> fp_type = (uint8_t) next_random(&seed);
+    states -> fp_bank_idx = (uint8_t) next_random(&seed);
+    states -> fp_bak1 = (uint8_t) next_random(&seed);
+    states -> fp_bak2 = (uint8_t) next_random(&seed);
+    fill_random(states -> fp_buff, sizeof(states -> fp_buff), &seed);
+    states -> slept = next_random(&seed) % 2u == 0;
+    states -> should_wake_up = next_random(&seed) % 2u == 0;
+    states -> pending_wake_up = next_random(&seed) % 2u == 0;
+    states -> wake_up_flags = (uint8_t) next_random(&seed);
+    states -> timer0_toggle = next_random(&seed) % 2u == 0;
+    states -> cycles = (uint64_t) next_random(&seed) << 32u | next_random(&seed);
+    states -> timer0_cycles = (uint64_t) next_random(&seed) << 32u | next_random(&seed);
+    states -> timer1_cycles = (uint64_t) next_random(&seed) << 32u | next_random(&seed);
+    states -> should_irq = next_random(&seed) % 2u == 0;
+    states -> lcd_addr = next_random(&seed);
+    fill_random(states -> keypad_matrix, sizeof(states -> keypad_matrix), &seed);
+}
+
+// the offset of the section with the tag in an encoded file, 0 if there is none.
+static size_t find_section(const uint8_t *data, size_t size, const char *tag) {
+    size_t offset = 12;
+    while (offset + 12 <= size) {
+        if (memcmp(data + offset, tag, 4) == 0) {
+            return offset;
+        }
+        uint32_t stored_size;
+        memcpy(&stored_size, data + offset + 8, sizeof(stored_size));
+        offset += 12u + stored_size;
+    }
+    return 0;
+}
+
+static void test_states(uint32_t seed) {
+    nc1020_states_t *states = (nc1020_states_t*) malloc(sizeof(nc1020_states_t));
+    nc1020_states_t *decoded = (nc1020_states_t*) malloc(sizeof(nc1020_states_t));
+    uint8_t *data = (uint8_t*) malloc(STATE_FILE_BOUND);
+    uint8_t *edited = (uint8_t*) malloc(STATE_FILE_BOUND + 64u);
+    CHECK(states != NULL && decoded != NULL && data != NULL && edited != NULL);
+    make_states(states, seed);
+    size_t size = encode_states(states, data);
+    CHECK(size <= STATE_FILE_BOUND);
+
+    memset(decoded, 0, sizeof(nc1020_states_t));
+    CHECK(decode_states(data, size, decoded));
+    CHECK(memcmp(states, decoded, sizeof(nc1020_states_t)) == 0);
+
+    for (uint32_t i = 0; i < CUTS; i++) {
+        size_t cut = i < 64 ? i : next_random(&seed) % size;
+        CHECK(!decode_states(data, cut, decoded));
+    }
+
+    // an unknown section in front of the end.
+    size_t end = find_section(data, size, "END ");
+    CHECK(end != 0);
+    static const uint8_t unknown[16] = {'X', 'T', 'R', 'A', 4, 0, 0, 0, 4, 0, 0, 0, 1, 2, 3, 4};
+    memcpy(edited, data, end);
+    memcpy(edited + end, unknown, sizeof(unknown));
+    memcpy(edited + end + sizeof(unknown), data + end, size - end);
+    memset(decoded, 0, sizeof(nc1020_states_t));
+    CHECK(decode_states(edited, size + sizeof(unknown), decoded));
+    CHECK(memcmp(states, decoded, sizeof(nc1020_states_t)) == 0);
+
+    // without the flash section its fields keep what they had.
+    size_t flash = find_section(data, size, "FLSH");
+    size_t after = find_section(data, size, "TIME");
+    CHECK(flash != 0 && after > flash);
+    memcpy(edited, data, flash);
+    memcpy(edited + flash, data + after, size - after);
+    make_states(decoded, seed + 1);
+    uint8_t fp_step = decoded -> fp_step;
+    uint8_t fp_buff_start = decoded -> fp_buff[0];
+    CHECK(decode_states(edited, size - (after - flash), decoded));
+    CHECK(decoded -> fp_step == fp_step && decoded -> fp_buff[0] == fp_buff_start);
+    CHECK(decoded -> cycles == states -> cycles);
+    CHECK(memcmp(decoded -> ram, states -> ram, sizeof(states -> ram)) == 0);
+
+    // the raw states of version 6, and of another version.
+    states -> version = 6;
+    memset(decoded, 0, sizeof(nc1020_states_t));
+    CHECK(decode_states((const uint8_t*) states, sizeof(nc1020_states_t), decoded));
+    CHECK(memcmp(states, decoded, sizeof(nc1020_states_t)) == 0);
+    states -> version = 5;
+    CHECK(!decode_states((const uint8_t*) states, sizeof(nc1020_states_t), decoded));
+
+    free(states);
+    free(decoded);
+    free(data);
+    free(edited);
+}
+
+int main() {
+    test_lz();
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        test_states(seed);
+    }
+    return 0;
+}
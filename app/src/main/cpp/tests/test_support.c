@@ -0,0 +1,87 @@
+#include "test_support.h"
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#define ROM_FILE_SIZE (0x8000 * 0x300)
+#define NOR_FILE_SIZE (0x8000 * 0x20)
+
+uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *state = x;
+    return x;
+}
+
+uint64_t hash_memory(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t*) data;
+    uint64_t hash = 0xCBF29CE484222325u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3u;
+    }
+    return hash;
+}
+
+static void write_file(const char *file_path, const uint8_t *data, size_t size) {
+    FILE *file = fopen(file_path, "wbe");
+    CHECK(file != NULL);
+    CHECK(fwrite(data, 1, size, file) == size);
+    CHECK(fclose(file) == 0);
+}
+
+static void join_path(char *buffer, const char *dir, const char *name) {
+    int length = snprintf(buffer, TEST_PATH_LENGTH, "%s/%s", dir, name);
+    CHECK(length > 0 && length < TEST_PATH_LENGTH);
+}
+
+void make_test_files(test_files_t *files, uint32_t seed) {
+    join_path(files -> dir, getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp", "nc1020_test_XXXXXX");
+    CHECK(mkdtemp(files -> dir) != NULL);
+    join_path(files -> rom, files -> dir, "rom.bin");
+    join_path(files -> nor, files -> dir, "nc1020.fls");
+    join_path(files -> state, files -> dir, "nc1020.sts");
+    join_path(files -> overlay, files -> dir, "nc1020.ovl");
+
+    uint8_t *data = (uint8_t*) malloc(ROM_FILE_SIZE);
+    CHECK(data != NULL);
+    uint32_t state = seed * 2654435761u + 1u;
+    for (size_t i = 0; i < ROM_FILE_SIZE; i += 4) {
+        uint32_t value = next_random(&state);
+        memcpy(data + i, &value, 4);
+    }
+    write_file(files -> rom, data, ROM_FILE_SIZE);
+
+    FILE *file = fopen(NC1020_TEST_NOR, "rbe");
+    CHECK(file != NULL);
+    CHECK(fread(data, 1, NOR_FILE_SIZE, file) == NOR_FILE_SIZE);
+    fclose(file);
+    write_file(files -> nor, data, NOR_FILE_SIZE);
+    free(data);
+}
+
+void remove_test_files(const test_files_t *files) {
+    DIR *dir = opendir(files -> dir);
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *entry;
+    char file_path[TEST_PATH_LENGTH + 256];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry -> d_name, ".") != 0 && strcmp(entry -> d_name, "..") != 0) {
+            snprintf(file_path, sizeof(file_path), "%s/%s", files -> dir, entry -> d_name);
+            unlink(file_path);
+        }
+    }
+    closedir(dir);
+    rmdir(files -> dir);
+}
+
+nc1020_t *open_test_machine(const test_files_t *files) {
+    nc1020_t *nc = create_nc1020();
+    CHECK(nc != NULL);
+    CHECK(initialize(nc, files -> rom, files -> nor, files -> state));
+    reset(nc);
+    return nc;
+}
@@ -0,0 +1,50 @@
+//
+// Helpers shared by the host tests: scratch files for a machine, a check that fails the
+// test with where it failed, and the random numbers and hashes the tests build their
+// cases and compare runs with.
+// The rom is random bytes from a seed, the real one can't ship, the nor is the one of
+// the app. The cpu runs through whatever the random banks hold, which exercises the
+// core as well as firmware would for comparing runs with each other.
+//
+
+#ifndef NC1020_TEST_SUPPORT_H
+#define NC1020_TEST_SUPPORT_H
+
+#include "../wqx/nc1020.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define TEST_PATH_LENGTH 240
+
+typedef struct {
+    char dir[TEST_PATH_LENGTH];
+    char rom[TEST_PATH_LENGTH];
+    char nor[TEST_PATH_LENGTH];
+    char state[TEST_PATH_LENGTH];
+    char overlay[TEST_PATH_LENGTH];
+} test_files_t;
+
+// a fresh scratch directory with a random rom from seed and a copy of the nor.
+void make_test_files(test_files_t *files, uint32_t seed);
+
+void remove_test_files(const test_files_t *files);
+
+// a machine on the files, reset.
+nc1020_t *open_test_machine(const test_files_t *files);
+
+// the next number of a xorshift sequence, for the tests' own random choices.
+uint32_t next_random(uint32_t *state);
+
+uint64_t hash_memory(const void *data, size_t size);
+
+#endif //NC1020_TEST_SUPPORT_H
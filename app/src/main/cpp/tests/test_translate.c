@@ -0,0 +1,162 @@
+//
+// The block cache, and the translation tier in the build with CPU6502_TRANSLATE: a cpu
+// running random code through them keeps the registers, cycles and memory of one running
+// everything through the plain interpreter. The code is switched in by banks and written
+// to while it runs, so cached and linked blocks have to go when it changes.
+//
+
+#include "test_support.h"
+#include "../wqx/cpu6502.h"
+#include <string.h>
+
+// random memory, and seed 0 for the bank calls.
+#define SEEDS 4u
+#define SLICES 2000u
+#define SLICE_CYCLES 2000u
+#define BANKS 4u
+#define BANK_SIZE 0x8000u
+// a store here switches the bank at 0x4000 - 0xBFFF, like the bank register of the machine.
+#define BANK_REGISTER 0x00u
+// the memory is compared every so many slices, the registers after every one.
+#define MEMORY_CHECK_SLICES 16u
+
+typedef struct {
+    cpu_states_t states;
+    uint64_t cycles;
+    uint64_t memory_hash;
+} point_t;
+
+static uint8_t _ram[0x4000];
+static uint8_t _banks[BANKS][BANK_SIZE];
+static uint8_t _rom[0x4000];
+static uint8_t *_memmap[8];
+static cpu6502_t *_cpu;
+// page 0 goes through the callbacks like the io page, the banks are code written through them.
+static const uint8_t _page_flags[8] = {
+        0, PAGE_DIRECT_READ | PAGE_DIRECT_WRITE,
+        PAGE_DIRECT_READ | PAGE_CODE_CACHE, PAGE_DIRECT_READ | PAGE_CODE_CACHE,
+        PAGE_DIRECT_READ | PAGE_CODE_CACHE, PAGE_DIRECT_READ | PAGE_CODE_CACHE,
+        PAGE_DIRECT_READ | PAGE_CODE_CACHE, PAGE_DIRECT_READ | PAGE_CODE_CACHE,
+};
+
+static void map_banks() {
+    uint8_t *bank = _banks[_ram[BANK_REGISTER] % BANKS];
+    for (uint32_t i = 0; i < 4; i++) {
+        _memmap[2 + i] = bank + i * 0x2000u;
+    }
+    remap_6502(_cpu);
+}
+
+static uint8_t load(void *context, uint16_t addr) {
+    (void) context;
+    return _memmap[addr >> 13u][addr & 0x1FFFu];
+}
+
+// the rom at the top drops stores.
+static void store(void *context, uint16_t addr, uint8_t value) {
+    (void) context;
+    uint8_t *ptr = &_memmap[addr >> 13u][addr & 0x1FFFu];
+    if (addr == BANK_REGISTER) {
+        *ptr = value;
+        map_banks();
+    } else if (addr < 0x4000u) {
+        *ptr = value;
+    } else if (addr < 0xC000u && *ptr != value) {
+        *ptr = value;
+        invalidate_6502_code(_cpu, ptr, 1);
+    }
+}
+
+static bool is_same_point(const point_t *point, const point_t *other) {
+    return point -> cycles == other -> cycles && point -> memory_hash == other -> memory_hash &&
+            point -> states.reg_pc == other -> states.reg_pc && point -> states.reg_a == other -> states.reg_a &&
+            point -> states.reg_ps == other -> states.reg_ps && point -> states.reg_x == other -> states.reg_x &&
+            point -> states.reg_y == other -> states.reg_y && point -> states.reg_sp == other -> states.reg_sp;
+}
+
+static uint64_t hash_machine() {
+    return hash_memory(_ram, sizeof(_ram)) ^ hash_memory(_banks, sizeof(_banks)) ^
+            hash_memory(_rom, sizeof(_rom));
+}
+
+// a loop in the rom calling the same address in every bank in turn, bank n adds n + 1 to x.
+// Irqs are masked, their vector is zero.
+static void put_bank_calls(cpu_states_t *states) {
+    static const uint8_t loop[] = {
+            0xA9, 0x00, // lda #0
+            0x85, BANK_REGISTER, // sta bank
+            0x20, 0x00, 0x40, // jsr $4000
+            0x18, // clc
+            0x69, 0x01, // adc #1
+            0x4C, 0x02, 0xC0, // jmp $c002
+    };
+    memcpy(_rom, loop, sizeof(loop));
+    // inx as many times as the number, then rts.
+    for (uint32_t i = 0; i < BANKS; i++) {
+        memset(_banks[i], 0xE8, i + 1u);
+        _banks[i][i + 1u] = 0x60;
+    }
+    states -> reg_pc = 0xC000;
+    states -> reg_ps = 0x04;
+}
+
+// fresh random memory from seed, and the registers to start from. Seed 0 leaves it all zeros.
+static void open_machine(uint32_t seed, bool translate, cpu_states_t *states) {
+    uint8_t *areas[] = {_ram, &_banks[0][0], _rom};
+    size_t sizes[] = {sizeof(_ram), sizeof(_banks), sizeof(_rom)};
+    for (uint32_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < sizes[i]; j++) {
+            areas[i][j] = (uint8_t) next_random(&seed);
+        }
+    }
+    _memmap[0] = _ram;
+    _memmap[1] = _ram + 0x2000u;
+    _memmap[6] = _rom;
+    _memmap[7] = _rom + 0x2000u;
+    _cpu = create_6502(load, store, NULL, _memmap, _page_flags);
+    CHECK(_cpu != NULL);
+    set_6502_translation(_cpu, translate);
+    map_banks();
+    memset(states, 0, sizeof(cpu_states_t));
+    states -> reg_pc = (uint16_t) (0x4000u + next_random(&seed) % 0xC000u);
+    states -> reg_sp = 0xFF;
+    if (seed == 0) {
+        put_bank_calls(states);
+    }
+}
+
+// slices of cycles with an irq every few, the points reached are recorded or checked.
+static void run(uint32_t seed, bool translate, point_t *points) {
+    cpu_states_t states;
+    open_machine(seed, translate, &states);
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < SLICES; i++) {
+        cycles += execute_6502_until(_cpu, &states, SLICE_CYCLES);
+        if (i % 4u == 3u) {
+            cycles += do_irq(_cpu, &states);
+        }
+        point_t point = {states, cycles, i % MEMORY_CHECK_SLICES == 0 ? hash_machine() : 0};
+        if (!translate) {
+            points[i] = point;
+            continue;
+        }
+        if (!is_same_point(&point, &points[i])) {
+            fprintf(stderr, "seed %u, slice %u: pc %04x after %llu cycles, the interpreter got to %04x after %llu\n",
+                    seed, i, point.states.reg_pc, (unsigned long long) point.cycles,
+                    points[i].states.reg_pc, (unsigned long long) points[i].cycles);
+        }
+        CHECK(is_same_point(&point, &points[i]));
+    }
+    destroy_6502(_cpu);
+}
+
+int main() {
+    point_t *points = (point_t*) calloc(SLICES, sizeof(point_t));
+    CHECK(points != NULL);
+    for (uint32_t seed = 0; seed <= SEEDS; seed++) {
+        run(seed, false, points);
+        run(seed, true, points);
+    }
+    free(points);
+    return 0;
+}
@@ -0,0 +1,173 @@
+//
+// Runs a manifest of headless sessions across all cores, one machine per job.
+//
+// Each manifest line is
+//     rom nor state script cycles
+// where state and script may be "-", and '#' starts a comment. See session.h for
+// the scripts. Jobs only read their files, so they may share them.
+//
+// Prints one line per job in manifest order with the emulated MHz and the
+// hashes of the final lcd and ram.
+//
+
+#include "session.h"
+#include "work_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+#define MAX_PATH_LENGTH 255
+
+static const uint64_t LCD_SIZE = 1600;
+static const uint64_t RAM_SIZE = 0x8000;
+
+typedef struct {
+    int line;
+    char rom_file_path[MAX_PATH_LENGTH + 1];
+    char nor_file_path[MAX_PATH_LENGTH + 1];
+    char state_file_path[MAX_PATH_LENGTH + 1];
+    char script_file_path[MAX_PATH_LENGTH + 1];
+    uint64_t budget;
+
+    const char *error;
+    uint64_t cycles;
+    double seconds;
+    uint64_t lcd_hash;
+    uint64_t ram_hash;
+} job_t;
+
+static void run_job(work_pool_t *pool, void *arg) {
+    (void) pool;
+    job_t *job = (job_t*) arg;
+    bool has_state = strcmp(job -> state_file_path, "-") != 0;
+    bool has_script = strcmp(job -> script_file_path, "-") != 0;
+
+    size_t event_count = 0;
+    key_event_t *events = NULL;
+    if (has_script) {
+        events = load_key_script(job -> script_file_path, &event_count);
+        if (events == NULL) {
+            job -> error = "script not readable";
+            return;
+        }
+    }
+
+    nc1020_t *nc = open_session(job -> rom_file_path, job -> nor_file_path,
+                                has_state ? job -> state_file_path : NULL, &job -> error);
+    if (nc == NULL) {
+        free(events);
+        return;
+    }
+
+    double start_seconds = now_seconds();
+    job -> cycles = run_session(nc, events, event_count, job -> budget);
+    job -> seconds = now_seconds() - start_seconds;
+
+    uint8_t *lcd_buffer = get_lcd_buffer(nc);
+    job -> lcd_hash = lcd_buffer ? hash_bytes(lcd_buffer, LCD_SIZE) : 0;
+    job -> ram_hash = hash_bytes(get_ram_buffer(nc), RAM_SIZE);
+
+    destroy_nc1020(nc);
+    free(events);
+}
+
+static job_t *load_manifest(const char *file_path, size_t *count) {
+    *count = 0;
+    FILE *file = fopen(file_path, "re");
+    if (file == NULL) {
+        return NULL;
+    }
+    size_t capacity = 64;
+    job_t *jobs = (job_t*) malloc(capacity * sizeof(job_t));
+    char line[4 * MAX_PATH_LENGTH + 64];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            jobs = (job_t*) realloc(jobs, capacity * sizeof(job_t));
+        }
+        job_t *job = &jobs[*count];
+        memset(job, 0, sizeof(job_t));
+        unsigned long long budget;
+        int fields = sscanf(line, "%255s %255s %255s %255s %llu",
+                job -> rom_file_path, job -> nor_file_path, job -> state_file_path,
+                job -> script_file_path, &budget);
+        if (fields <= 0) {
+            continue;
+        }
+        if (fields != 5) {
+            fprintf(stderr, "%s:%d: expected rom nor state script cycles\n", file_path, line_number);
+            continue;
+        }
+        job -> line = line_number;
+        job -> budget = budget;
+        (*count)++;
+    }
+    fclose(file);
+    return jobs;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-j threads] manifest\n", name);
+}
+
+int main(int argc, char **argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+        switch (opt) {
+            case 'j': threads = strtol(optarg, NULL, 10); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t job_count;
+    job_t *jobs = load_manifest(argv[optind], &job_count);
+    if (jobs == NULL) {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 1;
+    }
+
+    work_pool_t *pool = create_work_pool((int) threads);
+    for (size_t i = 0; i < job_count; i++) {
+        submit_work(pool, run_job, &jobs[i]);
+    }
+    double start_seconds = now_seconds();
+    run_work_pool(pool);
+    double seconds = now_seconds() - start_seconds;
+
+    int failed = 0;
+    uint64_t total_cycles = 0;
+    printf("line\tcycles\tseconds\tmhz\tlcd_hash\tram_hash\n");
+    for (size_t i = 0; i < job_count; i++) {
+        job_t *job = &jobs[i];
+        if (job -> error) {
+            printf("%d\terror: %s\n", job -> line, job -> error);
+            failed++;
+            continue;
+        }
+        double mhz = job -> seconds > 0 ? (double) job -> cycles / job -> seconds / 1e6 : 0;
+        printf("%d\t%" PRIu64 "\t%.3f\t%.2f\t%016" PRIx64 "\t%016" PRIx64 "\n",
+                job -> line, job -> cycles, job -> seconds, mhz, job -> lcd_hash, job -> ram_hash);
+        total_cycles += job -> cycles;
+    }
+    fprintf(stderr, "%zu jobs, %d failed, %d threads, %.3f s, %.2f MHz aggregate\n",
+            job_count, failed, work_pool_size(pool), seconds,
+            seconds > 0 ? (double) total_cycles / seconds / 1e6 : 0);
+
+    destroy_work_pool(pool);
+    free(jobs);
+    return failed ? 1 : 0;
+}
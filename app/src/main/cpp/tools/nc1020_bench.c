@@ -0,0 +1,115 @@
+//
+// Throughput benchmark of the core:
+//     nc1020_bench [-s state] [-k script] [-r repeats] rom nor ms
+// boots a fresh machine for every repeat, from reset or from the state, and runs ms
+// emulated milliseconds through run_time_slice. Prints the fastest and the median
+// host time, the emulated MHz of the fastest run and the hashes of the final lcd and
+// ram, which have to be the same for every repeat, and on any day.
+//
+
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static const uint64_t LCD_SIZE = 1600;
+static const uint64_t RAM_SIZE = 0x8000;
+
+typedef struct {
+    uint64_t cycles;
+    double seconds;
+    uint64_t lcd_hash;
+    uint64_t ram_hash;
+} bench_run_t;
+
+static bool run_bench(const char *rom_file_path, const char *nor_file_path, const char *state_file_path,
+                      const key_event_t *events, size_t event_count, uint64_t ms, bench_run_t *run) {
+    const char *error;
+    nc1020_t *nc = open_session(rom_file_path, nor_file_path, state_file_path, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return false;
+    }
+    double start_seconds = now_seconds();
+    run -> cycles = run_session_ms(nc, events, event_count, ms);
+    run -> seconds = now_seconds() - start_seconds;
+    // no lcd before the rom sets its address.
+    uint8_t *lcd_buffer = get_lcd_buffer(nc);
+    run -> lcd_hash = lcd_buffer ? hash_bytes(lcd_buffer, LCD_SIZE) : 0;
+    run -> ram_hash = hash_bytes(get_ram_buffer(nc), RAM_SIZE);
+    destroy_nc1020(nc);
+    return true;
+}
+
+static int compare_seconds(const void *a, const void *b) {
+    double x = ((const bench_run_t*) a) -> seconds;
+    double y = ((const bench_run_t*) b) -> seconds;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-s state] [-k script] [-r repeats] rom nor ms\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *state_file_path = NULL;
+    const char *script_file_path = NULL;
+    int repeats = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:r:")) != -1) {
+        switch (opt) {
+            case 's': state_file_path = optarg; break;
+            case 'k': script_file_path = optarg; break;
+            case 'r': repeats = atoi(optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 3 || repeats < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    uint64_t ms = strtoull(argv[optind + 2], NULL, 0);
+
+    size_t event_count = 0;
+    key_event_t *events = NULL;
+    if (script_file_path) {
+        events = load_key_script(script_file_path, &event_count);
+        if (events == NULL) {
+            fprintf(stderr, "cannot read %s\n", script_file_path);
+            return 1;
+        }
+    }
+
+    bench_run_t *runs = (bench_run_t*) calloc((size_t) repeats, sizeof(bench_run_t));
+    int result = 0;
+    for (int i = 0; i < repeats; i++) {
+        if (!run_bench(argv[optind], argv[optind + 1], state_file_path, events, event_count, ms, &runs[i])) {
+            result = 1;
+            break;
+        }
+        if (runs[i].cycles != runs[0].cycles || runs[i].lcd_hash != runs[0].lcd_hash ||
+                runs[i].ram_hash != runs[0].ram_hash) {
+            fprintf(stderr, "run %d differs from the first\n", i + 1);
+            result = 1;
+            break;
+        }
+    }
+    if (result == 0) {
+        bench_run_t first = runs[0];
+        qsort(runs, (size_t) repeats, sizeof(bench_run_t), compare_seconds);
+        double best = runs[0].seconds;
+        double median = runs[repeats / 2].seconds;
+        printf("ms\t%" PRIu64 "\n", ms);
+        printf("cycles\t%" PRIu64 "\n", first.cycles);
+        printf("seconds\t%.4f\n", best);
+        printf("median\t%.4f\n", median);
+        printf("mhz\t%.2f\n", best > 0 ? (double) first.cycles / best / 1e6 : 0.0);
+        printf("speed\t%.1fx\n", best > 0 ? (double) ms / 1000 / best : 0.0);
+        printf("lcd\t%016" PRIx64 "\n", first.lcd_hash);
+        printf("ram\t%016" PRIx64 "\n", first.ram_hash);
+    }
+    free(runs);
+    free(events);
+    return result;
+}
@@ -0,0 +1,419 @@
+//
+// Microbenchmarks of the hot paths of the core:
+//     nc1020_micro [-r repeats] [-w warmup ms] [-f filter] [-i] [rom nor]
+// Every benchmark is warmed up and calibrated until one sample takes about a
+// millisecond, then sampled repeats times. Prints the ns per operation at a few
+// percentiles.
+//
+// The cpu benchmarks run one instruction over and over on a bare cpu with flat memory,
+// -i without the block cache. The memory map, bank switch, lcd, rewind and run ahead
+// benchmarks need a machine, so only run with a rom and a nor.
+//
+
+#include "session.h"
+#include "../wqx/nc1020_context.h"
+#include "../wqx/nc1020_io.h"
+#include "../wqx/nc1020_rewind.h"
+#include "../wqx/nc1020_snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const double SAMPLE_SECONDS = 0.001;
+
+// copies of the instruction in one pass of a cpu benchmark.
+#define BODY_LENGTH 256
+#define CODE_ADDR 0x8000u
+// the pass counter, bumped every pass so the loop is never skipped as idle.
+#define PASS_ADDR 0xF0u
+
+typedef struct {
+    // run before the body in every pass, to set up registers and flags.
+    uint8_t setup[4];
+    uint8_t setup_length;
+    uint8_t inst[3];
+    uint8_t inst_length;
+} cpu_bench_t;
+
+typedef struct {
+    cpu6502_t *cpu;
+    cpu_states_t states;
+    uint8_t *memory;
+    uint8_t *memmap[8];
+    uint8_t page_flags[8];
+    uint64_t pass_cycles;
+} bare_cpu_t;
+
+typedef struct {
+    bool translate;
+    bare_cpu_t *bare;
+    nc1020_t *nc;
+    uint8_t *lcd;
+    nc1020_snapshot_t *snapshot;
+} bench_env_t;
+
+typedef struct {
+    const char *name;
+    // runs iterations of the operation, returns how many operations that were.
+    uint64_t (*run)(bench_env_t *env, const void *arg, uint64_t iterations);
+    // prepares env for the run, false if it can't run.
+    bool (*prepare)(bench_env_t *env, const void *arg);
+    const void *arg;
+} micro_bench_t;
+
+static volatile uint8_t _sink;
+
+static const cpu_bench_t LDA_IMM = {{0}, 0, {0xA9, 0x01}, 2};
+static const cpu_bench_t ADC_IMM = {{0}, 0, {0x69, 0x01}, 2};
+static const cpu_bench_t ADC_IMM_BCD = {{0xF8}, 1, {0x69, 0x01}, 2};
+static const cpu_bench_t ADC_ZP = {{0}, 0, {0x65, 0x10}, 2};
+static const cpu_bench_t SBC_ABS = {{0}, 0, {0xED, 0x00, 0x03}, 3};
+static const cpu_bench_t AND_ZPX = {{0xA2, 0x01}, 2, {0x35, 0x10}, 2};
+static const cpu_bench_t CMP_IMM = {{0}, 0, {0xC9, 0x01}, 2};
+static const cpu_bench_t ASL_A = {{0}, 0, {0x0A}, 1};
+static const cpu_bench_t INC_ZP = {{0}, 0, {0xE6, 0x10}, 2};
+static const cpu_bench_t INC_ABS = {{0}, 0, {0xEE, 0x00, 0x03}, 3};
+static const cpu_bench_t ROR_ZPX = {{0xA2, 0x01}, 2, {0x76, 0x10}, 2};
+static const cpu_bench_t BNE_TAKEN = {{0xA9, 0x01}, 2, {0xD0, 0x00}, 2};
+static const cpu_bench_t BEQ_NOT_TAKEN = {{0xA9, 0x01}, 2, {0xF0, 0x00}, 2};
+static const cpu_bench_t LDA_ABSX = {{0xA2, 0x00}, 2, {0xBD, 0xF0, 0x03}, 3};
+static const cpu_bench_t LDA_ABSX_CROSS = {{0xA2, 0x20}, 2, {0xBD, 0xF0, 0x03}, 3};
+static const cpu_bench_t LDA_INDY_CROSS = {{0xA0, 0x20}, 2, {0xB1, 0x20}, 2};
+static const cpu_bench_t STA_ABSX_CROSS = {{0xA2, 0x20}, 2, {0x9D, 0xF0, 0x03}, 3};
+
+static uint8_t load_bare(void *context, uint16_t addr) {
+    return ((uint8_t*) context)[addr];
+}
+
+static void store_bare(void *context, uint16_t addr, uint8_t value) {
+    ((uint8_t*) context)[addr] = value;
+}
+
+static bare_cpu_t *create_bare_cpu() {
+    bare_cpu_t *bare = (bare_cpu_t*) calloc(1, sizeof(bare_cpu_t));
+    bare -> memory = (uint8_t*) calloc(0x10000, 1);
+    for (int i = 0; i < 8; i++) {
+        bare -> memmap[i] = bare -> memory + 0x2000 * i;
+        bare -> page_flags[i] = PAGE_DIRECT_READ | PAGE_DIRECT_WRITE;
+    }
+    // the code lives in a rom page, like most code the machine runs.
+    bare -> page_flags[CODE_ADDR >> 13u] = PAGE_DIRECT_READ | PAGE_CODE_CACHE;
+    bare -> cpu = create_6502(load_bare, store_bare, bare -> memory, bare -> memmap, bare -> page_flags);
+    return bare;
+}
+
+static void destroy_bare_cpu(bare_cpu_t *bare) {
+    destroy_6502(bare -> cpu);
+    free(bare -> memory);
+    free(bare);
+}
+
+static void reset_bare_cpu(bare_cpu_t *bare) {
+    memset(&bare -> states, 0, sizeof(cpu_states_t));
+    bare -> states.reg_pc = CODE_ADDR;
+    bare -> states.reg_sp = 0xFF;
+    bare -> states.reg_ps = 0x24;
+}
+
+static bool prepare_cpu(bench_env_t *env, const void *arg) {
+    const cpu_bench_t *bench = (const cpu_bench_t*) arg;
+    bare_cpu_t *bare = env -> bare;
+    uint8_t *memory = bare -> memory;
+    memset(memory, 0, 0x10000);
+    // ($20) points at the indexed operands.
+    memory[0x20] = 0xF0;
+    memory[0x21] = 0x03;
+
+    uint8_t *code = memory + CODE_ADDR;
+    memcpy(code, bench -> setup, bench -> setup_length);
+    code += bench -> setup_length;
+    for (int i = 0; i < BODY_LENGTH; i++) {
+        memcpy(code, bench -> inst, bench -> inst_length);
+        code += bench -> inst_length;
+    }
+    const uint8_t tail[] = {0xE6, PASS_ADDR, 0x4C, CODE_ADDR & 0xFFu, CODE_ADDR >> 8u};
+    memcpy(code, tail, sizeof(tail));
+    invalidate_6502_code(bare -> cpu, memory + CODE_ADDR, 0x2000);
+    set_6502_translation(bare -> cpu, env -> translate);
+
+    // one pass, an instruction at a time.
+    reset_bare_cpu(bare);
+    bare -> pass_cycles = 0;
+    do {
+        bare -> pass_cycles += execute_6502_until(bare -> cpu, &bare -> states, 1);
+    } while (bare -> states.reg_pc != CODE_ADDR);
+    return true;
+}
+
+static uint64_t run_cpu(bench_env_t *env, const void *arg, uint64_t iterations) {
+    (void) arg;
+    bare_cpu_t *bare = env -> bare;
+    reset_bare_cpu(bare);
+    uint64_t cycles = execute_6502_until(bare -> cpu, &bare -> states, iterations * bare -> pass_cycles);
+    return cycles * BODY_LENGTH / bare -> pass_cycles;
+}
+
+typedef struct {
+    uint8_t bank;
+    uint16_t addr;
+    // the addresses of the operations wrap at this mask.
+    uint16_t mask;
+} memory_bench_t;
+
+static const memory_bench_t IO_PAGE = {0x00, 0x0010, 0x000F};
+static const memory_bench_t RAM_PAGE = {0x00, 0x2000, 0x0FFF};
+static const memory_bench_t NOR_PAGE = {0x00, 0x4000, 0x0FFF};
+static const memory_bench_t ROM_PAGE = {0x80, 0x4000, 0x0FFF};
+
+static bool prepare_machine(bench_env_t *env, const void *arg) {
+    (void) arg;
+    if (env -> nc == NULL) {
+        return false;
+    }
+    reset(env -> nc);
+    return true;
+}
+
+static bool prepare_memory(bench_env_t *env, const void *arg) {
+    if (!prepare_machine(env, arg)) {
+        return false;
+    }
+    write_io(env -> nc, 0x00, ((const memory_bench_t*) arg) -> bank);
+    return true;
+}
+
+static uint64_t run_load(bench_env_t *env, const void *arg, uint64_t iterations) {
+    const memory_bench_t *bench = (const memory_bench_t*) arg;
+    uint8_t sum = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        sum += load_memory(env -> nc, (uint16_t) (bench -> addr + (i & bench -> mask)));
+    }
+    _sink = sum;
+    return iterations;
+}
+
+static uint64_t run_store(bench_env_t *env, const void *arg, uint64_t iterations) {
+    const memory_bench_t *bench = (const memory_bench_t*) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        // the flash only takes commands starting with 0xAA at 0x5555, so this is no command.
+        store_memory(env -> nc, (uint16_t) (bench -> addr + (i & bench -> mask)), (uint8_t) (i & 0x7Fu));
+    }
+    return iterations;
+}
+
+typedef struct {
+    uint8_t addr;
+    uint8_t values[2];
+} switch_bench_t;
+
+static const switch_bench_t NOR_BANK_SWITCH = {0x00, {0x00, 0x01}};
+static const switch_bench_t ROM_BANK_SWITCH = {0x00, {0x80, 0x81}};
+static const switch_bench_t VOLUME_SWITCH = {0x0D, {0x00, 0x01}};
+
+static uint64_t run_switch(bench_env_t *env, const void *arg, uint64_t iterations) {
+    const switch_bench_t *bench = (const switch_bench_t*) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        write_io(env -> nc, bench -> addr, bench -> values[i & 1u]);
+    }
+    return iterations;
+}
+
+// through all 8 zero page banks, both from and to the plain one.
+static uint64_t run_zero_page_switch(bench_env_t *env, const void *arg, uint64_t iterations) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        write_io(env -> nc, 0x0F, (uint8_t) (i & 0x07u));
+    }
+    return iterations;
+}
+
+static bool prepare_lcd(bench_env_t *env, const void *arg) {
+    if (!prepare_machine(env, arg)) {
+        return false;
+    }
+    if (get_lcd_buffer(env -> nc) == NULL) {
+        write_io(env -> nc, 0x06, 0x9C);
+    }
+    return true;
+}
+
+static uint64_t run_lcd(bench_env_t *env, const void *arg, uint64_t iterations) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        copy_lcd_buffer_ex(env -> nc, env -> lcd);
+    }
+    _sink = env -> lcd[1];
+    return iterations;
+}
+
+// bytes of ram changed between two snapshots, spread over the ram.
+#define SNAPSHOT_CHANGES 256
+
+static bool prepare_snapshot(bench_env_t *env, const void *arg) {
+    if (!prepare_machine(env, arg)) {
+        return false;
+    }
+    set_rewind(env -> nc, 1, 4u << 20u);
+    take_snapshot(env -> nc -> rewind, env -> nc);
+    return true;
+}
+
+static uint64_t run_snapshot(bench_env_t *env, const void *arg, uint64_t iterations) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (uint32_t j = 0; j < SNAPSHOT_CHANGES; j++) {
+            env -> nc -> states.ram[(j * 127u + i) & 0x7FFFu]++;
+        }
+        take_snapshot(env -> nc -> rewind, env -> nc);
+    }
+    return iterations;
+}
+
+// what running ahead costs besides the emulation.
+static uint64_t run_capture_restore(bench_env_t *env, const void *arg, uint64_t iterations) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        capture_machine(env -> snapshot, env -> nc);
+        env -> nc -> states.ram[i & 0x7FFFu]++;
+        restore_machine(env -> snapshot, env -> nc);
+    }
+    return iterations;
+}
+
+static const micro_bench_t BENCHES[] = {
+        {"cpu/lda_imm", run_cpu, prepare_cpu, &LDA_IMM},
+        {"cpu/adc_imm", run_cpu, prepare_cpu, &ADC_IMM},
+        {"cpu/adc_imm_bcd", run_cpu, prepare_cpu, &ADC_IMM_BCD},
+        {"cpu/adc_zp", run_cpu, prepare_cpu, &ADC_ZP},
+        {"cpu/sbc_abs", run_cpu, prepare_cpu, &SBC_ABS},
+        {"cpu/and_zpx", run_cpu, prepare_cpu, &AND_ZPX},
+        {"cpu/cmp_imm", run_cpu, prepare_cpu, &CMP_IMM},
+        {"cpu/asl_a", run_cpu, prepare_cpu, &ASL_A},
+        {"cpu/inc_zp", run_cpu, prepare_cpu, &INC_ZP},
+        {"cpu/inc_abs", run_cpu, prepare_cpu, &INC_ABS},
+        {"cpu/ror_zpx", run_cpu, prepare_cpu, &ROR_ZPX},
+        {"cpu/bne_taken", run_cpu, prepare_cpu, &BNE_TAKEN},
+        {"cpu/beq_not_taken", run_cpu, prepare_cpu, &BEQ_NOT_TAKEN},
+        {"cpu/lda_absx", run_cpu, prepare_cpu, &LDA_ABSX},
+        {"cpu/lda_absx_cross", run_cpu, prepare_cpu, &LDA_ABSX_CROSS},
+        {"cpu/lda_indy_cross", run_cpu, prepare_cpu, &LDA_INDY_CROSS},
+        {"cpu/sta_absx_cross", run_cpu, prepare_cpu, &STA_ABSX_CROSS},
+        {"load/io", run_load, prepare_memory, &IO_PAGE},
+        {"load/ram", run_load, prepare_memory, &RAM_PAGE},
+        {"load/nor", run_load, prepare_memory, &NOR_PAGE},
+        {"load/rom", run_load, prepare_memory, &ROM_PAGE},
+        {"store/io", run_store, prepare_memory, &IO_PAGE},
+        {"store/ram", run_store, prepare_memory, &RAM_PAGE},
+        {"store/nor", run_store, prepare_memory, &NOR_PAGE},
+        {"store/rom", run_store, prepare_memory, &ROM_PAGE},
+        {"switch/nor_bank", run_switch, prepare_machine, &NOR_BANK_SWITCH},
+        {"switch/rom_bank", run_switch, prepare_machine, &ROM_BANK_SWITCH},
+        {"switch/volume", run_switch, prepare_machine, &VOLUME_SWITCH},
+        {"switch/zero_page", run_zero_page_switch, prepare_machine, NULL},
+        {"lcd/copy_ex", run_lcd, prepare_lcd, NULL},
+        {"rewind/snapshot", run_snapshot, prepare_snapshot, NULL},
+        {"ahead/capture_restore", run_capture_restore, prepare_machine, NULL},
+};
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, int percent) {
+    return sorted[(count - 1) * percent / 100];
+}
+
+// ns per operation of one sample.
+static double take_sample(const micro_bench_t *bench, bench_env_t *env, uint64_t iterations) {
+    double start_seconds = now_seconds();
+    uint64_t operations = bench -> run(env, bench -> arg, iterations);
+    double seconds = now_seconds() - start_seconds;
+    return operations ? seconds * 1e9 / (double) operations : 0;
+}
+
+static void run_micro_bench(const micro_bench_t *bench, bench_env_t *env, int repeats, double warmup_seconds) {
+    if (!bench -> prepare(env, bench -> arg)) {
+        printf("%-22s skipped, needs a rom and a nor\n", bench -> name);
+        return;
+    }
+    // doubles the iterations until a sample takes long enough, then warms up with it.
+    uint64_t iterations = 1;
+    double start_seconds = now_seconds();
+    for (;;) {
+        double sample_start = now_seconds();
+        bench -> run(env, bench -> arg, iterations);
+        if (now_seconds() - sample_start >= SAMPLE_SECONDS) {
+            break;
+        }
+        iterations *= 2;
+    }
+    while (now_seconds() - start_seconds < warmup_seconds) {
+        bench -> run(env, bench -> arg, iterations);
+    }
+
+    double *samples = (double*) malloc((size_t) repeats * sizeof(double));
+    for (int i = 0; i < repeats; i++) {
+        samples[i] = take_sample(bench, env, iterations);
+    }
+    qsort(samples, (size_t) repeats, sizeof(double), compare_doubles);
+    printf("%-22s %10llu %9.2f %9.2f %9.2f %9.2f\n", bench -> name, (unsigned long long) iterations,
+           samples[0], percentile(samples, repeats, 50), percentile(samples, repeats, 90),
+           percentile(samples, repeats, 99));
+    free(samples);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r repeats] [-w warmup ms] [-f filter] [-i] [rom nor]\n", name);
+}
+
+int main(int argc, char **argv) {
+    int repeats = 31;
+    double warmup_seconds = 0.05;
+    const char *filter = NULL;
+    bench_env_t env;
+    memset(&env, 0, sizeof(env));
+    env.translate = true;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:w:f:i")) != -1) {
+        switch (opt) {
+            case 'r': repeats = atoi(optarg); break;
+            case 'w': warmup_seconds = atof(optarg) / 1000; break;
+            case 'f': filter = optarg; break;
+            case 'i': env.translate = false; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if ((optind != argc && optind != argc - 2) || repeats < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (optind == argc - 2) {
+        const char *error;
+        env.nc = open_session(argv[optind], argv[optind + 1], NULL, &error);
+        if (env.nc == NULL) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+    }
+    env.bare = create_bare_cpu();
+    env.lcd = (uint8_t*) malloc(160 * 80);
+    env.snapshot = create_snapshot();
+
+    printf("%-22s %10s %9s %9s %9s %9s\n", "ns/op", "iterations", "min", "p50", "p90", "p99");
+    for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++) {
+        if (filter == NULL || strstr(BENCHES[i].name, filter)) {
+            run_micro_bench(&BENCHES[i], &env, repeats, warmup_seconds);
+        }
+    }
+
+    free(env.lcd);
+    destroy_snapshot(env.snapshot);
+    destroy_bare_cpu(env.bare);
+    if (env.nc) {
+        destroy_nc1020(env.nc);
+    }
+    return 0;
+}
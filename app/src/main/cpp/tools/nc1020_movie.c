@@ -0,0 +1,180 @@
+//
+// Records and plays movies, the keys and slices of a session to run it again exactly:
+//     nc1020_movie record [-s state] [-k script] rom nor ms movie
+//     nc1020_movie play [-r repeats] rom nor movie
+//     nc1020_movie seek rom nor movie cycles...
+// play runs the movie headless as fast as it goes, prints the speed and the hash of the
+// lcd it ends on, and fails if the replay went out of sync or the repeats differ.
+// seek goes to each of the cycles in turn and prints the hashes of the lcd and ram there.
+// Playing keeps keyframes in movie.idx, later seeks start from the nearest one.
+//
+
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static const uint64_t LCD_SIZE = 1600;
+static const uint64_t RAM_SIZE = 0x8000;
+
+// no lcd before the rom sets its address.
+static uint64_t hash_lcd(nc1020_t *nc) {
+    uint8_t *lcd_buffer = get_lcd_buffer(nc);
+    return lcd_buffer ? hash_bytes(lcd_buffer, LCD_SIZE) : 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s record [-s state] [-k script] rom nor ms movie\n", name);
+    fprintf(stderr, "       %s play [-r repeats] rom nor movie\n", name);
+    fprintf(stderr, "       %s seek rom nor movie cycles...\n", name);
+}
+
+static int record(int argc, char **argv) {
+    const char *state_file_path = NULL;
+    const char *script_file_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:")) != -1) {
+        switch (opt) {
+            case 's': state_file_path = optarg; break;
+            case 'k': script_file_path = optarg; break;
+            default: return 2;
+        }
+    }
+    if (optind != argc - 4) {
+        return 2;
+    }
+    size_t count = 0;
+    key_event_t *events = NULL;
+    if (script_file_path && (events = load_key_script(script_file_path, &count)) == NULL) {
+        fprintf(stderr, "cannot read %s\n", script_file_path);
+        return 1;
+    }
+    const char *error = NULL;
+    nc1020_t *nc = open_session(argv[optind], argv[optind + 1], state_file_path, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        free(events);
+        return 1;
+    }
+    const char *movie_file_path = argv[optind + 3];
+    if (!start_movie(nc, movie_file_path)) {
+        fprintf(stderr, "cannot write %s\n", movie_file_path);
+        destroy_nc1020(nc);
+        free(events);
+        return 1;
+    }
+    uint64_t cycles = run_session_ms(nc, events, count, strtoull(argv[optind + 2], NULL, 10));
+    uint64_t hash = hash_lcd(nc);
+    bool recorded = stop_movie(nc);
+    if (recorded) {
+        printf("%" PRIu64 " cycles  lcd %016" PRIx64 "\n", cycles, hash);
+    } else {
+        fprintf(stderr, "cannot write %s\n", movie_file_path);
+    }
+    destroy_nc1020(nc);
+    free(events);
+    return recorded ? 0 : 1;
+}
+
+static int play(int argc, char **argv) {
+    uint32_t repeats = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+            case 'r': repeats = (uint32_t) strtoul(optarg, NULL, 10); break;
+            default: return 2;
+        }
+    }
+    if (optind != argc - 3 || repeats == 0) {
+        return 2;
+    }
+    const char *movie_file_path = argv[optind + 2];
+    uint64_t first_hash = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        const char *error = NULL;
+        nc1020_t *nc = open_session(argv[optind], argv[optind + 1], NULL, &error);
+        if (nc == NULL) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+        if (!play_movie(nc, movie_file_path)) {
+            fprintf(stderr, "%s is not a movie of this nor\n", movie_file_path);
+            destroy_nc1020(nc);
+            return 1;
+        }
+        uint64_t start_cycles = get_cycles(nc);
+        double start = now_seconds();
+        while (run_movie_slice(nc)) {
+        }
+        double seconds = now_seconds() - start;
+        uint64_t cycles = get_cycles(nc) - start_cycles;
+        uint64_t hash = hash_lcd(nc);
+        bool in_sync = stop_movie(nc);
+        destroy_nc1020(nc);
+        printf("%.3f s  %" PRIu64 " cycles  %.1f MHz  lcd %016" PRIx64 "  %s\n",
+               seconds, cycles, (double) cycles / seconds / 1e6, hash, in_sync ? "ok" : "out of sync");
+        if (!in_sync) {
+            return 1;
+        }
+        if (i == 0) {
+            first_hash = hash;
+        } else if (hash != first_hash) {
+            fprintf(stderr, "repeat %u ended on another lcd\n", i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int seek(int argc, char **argv) {
+    if (argc < 5) {
+        return 2;
+    }
+    const char *error = NULL;
+    nc1020_t *nc = open_session(argv[1], argv[2], NULL, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+    if (!play_movie(nc, argv[3])) {
+        fprintf(stderr, "%s is not a movie of this nor\n", argv[3]);
+        destroy_nc1020(nc);
+        return 1;
+    }
+    int result = 0;
+    for (int i = 4; i < argc && result == 0; i++) {
+        uint64_t cycles = strtoull(argv[i], NULL, 10);
+        double start = now_seconds();
+        if (!seek_movie(nc, cycles)) {
+            fprintf(stderr, "cannot seek to %" PRIu64 "\n", cycles);
+            result = 1;
+            break;
+        }
+        double seconds = now_seconds() - start;
+        printf("%.3f s  %" PRIu64 " cycles  lcd %016" PRIx64 "  ram %016" PRIx64 "\n",
+               seconds, get_cycles(nc), hash_lcd(nc), hash_bytes(get_ram_buffer(nc), RAM_SIZE));
+    }
+    if (!stop_movie(nc)) {
+        fprintf(stderr, "out of sync\n");
+        result = 1;
+    }
+    destroy_nc1020(nc);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    int result = 2;
+    if (argc > 1 && strcmp(argv[1], "record") == 0) {
+        result = record(argc - 1, argv + 1);
+    } else if (argc > 1 && strcmp(argv[1], "play") == 0) {
+        result = play(argc - 1, argv + 1);
+    } else if (argc > 1 && strcmp(argv[1], "seek") == 0) {
+        result = seek(argc - 1, argv + 1);
+    }
+    if (result == 2) {
+        usage(argv[0]);
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+//
+// Runs one headless session under the cycle profiler and writes the report, needs a
+// build with NC1020_PROFILE.
+//
+
+#include "session.h"
+#include "../wqx/nc1020_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-s state] [-k script] [-y symbols] [-n limit] [-o report] rom nor cycles\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *state_file_path = NULL;
+    const char *script_file_path = NULL;
+    const char *symbol_file_path = NULL;
+    const char *report_file_path = NULL;
+    size_t limit = 50;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:y:n:o:")) != -1) {
+        switch (opt) {
+            case 's': state_file_path = optarg; break;
+            case 'k': script_file_path = optarg; break;
+            case 'y': symbol_file_path = optarg; break;
+            case 'n': limit = strtoul(optarg, NULL, 10); break;
+            case 'o': report_file_path = optarg; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 3) {
+        usage(argv[0]);
+        return 2;
+    }
+    uint64_t budget = strtoull(argv[optind + 2], NULL, 0);
+
+    size_t event_count = 0;
+    key_event_t *events = NULL;
+    if (script_file_path) {
+        events = load_key_script(script_file_path, &event_count);
+        if (events == NULL) {
+            fprintf(stderr, "cannot read %s\n", script_file_path);
+            return 1;
+        }
+    }
+    nc1020_profile_t *profile = create_profile();
+    if (symbol_file_path && !load_profile_symbols(profile, symbol_file_path)) {
+        fprintf(stderr, "cannot read %s\n", symbol_file_path);
+        return 1;
+    }
+    const char *error;
+    nc1020_t *nc = open_session(argv[optind], argv[optind + 1], state_file_path, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    attach_profile(nc, profile);
+    double start_seconds = now_seconds();
+    uint64_t cycles = run_session(nc, events, event_count, budget);
+    double seconds = now_seconds() - start_seconds;
+    attach_profile(nc, NULL);
+
+    FILE *report = report_file_path ? fopen(report_file_path, "we") : stdout;
+    if (report == NULL) {
+        fprintf(stderr, "cannot write %s\n", report_file_path);
+        return 1;
+    }
+    write_profile_report(profile, report, limit);
+    if (report != stdout) {
+        fclose(report);
+    }
+    fprintf(stderr, "%" PRIu64 " cycles in %.3f s\n", cycles, seconds);
+
+    destroy_nc1020(nc);
+    destroy_profile(profile);
+    free(events);
+    return 0;
+}
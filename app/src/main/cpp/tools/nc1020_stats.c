@@ -0,0 +1,87 @@
+//
+// Runs one headless session counting the instructions, and writes the counts per
+// opcode, per addressing mode and of the most frequent opcode pairs as csv. Needs a
+// build with NC1020_STATS.
+//
+
+#include "session.h"
+#include "../wqx/nc1020_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static bool write_csv(const char *prefix, const char *table, const cpu6502_stats_t *stats, size_t pair_limit) {
+    char file_path[512];
+    snprintf(file_path, sizeof(file_path), "%s-%s.csv", prefix, table);
+    FILE *file = fopen(file_path, "we");
+    if (file == NULL) {
+        fprintf(stderr, "cannot write %s\n", file_path);
+        return false;
+    }
+    switch (table[0]) {
+        case 'o': write_6502_opcode_stats(stats, file); break;
+        case 'm': write_6502_mode_stats(stats, file); break;
+        default: write_6502_pair_stats(stats, file, pair_limit); break;
+    }
+    fclose(file);
+    return true;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-s state] [-k script] [-p pairs] [-o prefix] rom nor cycles\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *state_file_path = NULL;
+    const char *script_file_path = NULL;
+    const char *prefix = "stats";
+    size_t pair_limit = 256;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:p:o:")) != -1) {
+        switch (opt) {
+            case 's': state_file_path = optarg; break;
+            case 'k': script_file_path = optarg; break;
+            case 'p': pair_limit = strtoul(optarg, NULL, 10); break;
+            case 'o': prefix = optarg; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 3) {
+        usage(argv[0]);
+        return 2;
+    }
+    uint64_t budget = strtoull(argv[optind + 2], NULL, 0);
+
+    size_t event_count = 0;
+    key_event_t *events = NULL;
+    if (script_file_path) {
+        events = load_key_script(script_file_path, &event_count);
+        if (events == NULL) {
+            fprintf(stderr, "cannot read %s\n", script_file_path);
+            return 1;
+        }
+    }
+    const char *error;
+    nc1020_t *nc = open_session(argv[optind], argv[optind + 1], state_file_path, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+
+    cpu6502_stats_t *stats = (cpu6502_stats_t*) calloc(1, sizeof(cpu6502_stats_t));
+    attach_stats(nc, stats);
+    uint64_t cycles = run_session(nc, events, event_count, budget);
+    attach_stats(nc, NULL);
+
+    bool written = write_csv(prefix, "opcodes", stats, pair_limit) &&
+                   write_csv(prefix, "modes", stats, pair_limit) &&
+                   write_csv(prefix, "pairs", stats, pair_limit);
+    fprintf(stderr, "%" PRIu64 " cycles, %" PRIu64 " of them in skipped idle loops\n",
+            cycles, stats -> idle_cycles);
+
+    destroy_nc1020(nc);
+    free(stats);
+    free(events);
+    return written ? 0 : 1;
+}
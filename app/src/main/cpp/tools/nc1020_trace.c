@@ -0,0 +1,246 @@
+//
+// Prints execution traces, filtered by pc range, bank or opcode. Builds with
+// NC1020_TRACE can also record them from a headless session:
+//     nc1020_trace record [-s state] [-k script] [-n records] [-m] rom nor cycles trace
+// streams every instruction to the trace, or with -m keeps the last records in a
+// mapped ring file.
+//
+
+#include "session.h"
+#include "../wqx/cpu6502_trace.h"
+#include "../wqx/cpu6502_disasm.h"
+#include "../wqx/nc1020_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+typedef struct {
+    uint32_t pc_low;
+    uint32_t pc_high;
+    int bank;
+    int opcode;
+    uint64_t last;
+} trace_filter_t;
+
+typedef struct {
+    trace_filter_t filter;
+    uint64_t cycles;
+    uint32_t last_cycles;
+    bool started;
+    // the last records that passed, printed at the end, when filter.last is set.
+    cpu6502_trace_record_t *tail;
+    uint64_t *tail_cycles;
+    uint64_t tail_count;
+} trace_printer_t;
+
+static void print_record(const cpu6502_trace_record_t *record, uint64_t cycles) {
+    char inst[32];
+    format_6502_inst(inst, sizeof(inst), record -> pc, record -> opcode, record -> operand);
+    char flags[9];
+    for (int i = 0; i < 8; i++) {
+        flags[i] = (char) (record -> reg_ps & (0x80u >> i) ? "NV-BDIZC"[i] : '.');
+    }
+    flags[8] = '\0';
+    printf("%12" PRIu64 "  %02X:%02X  %04X  %-16s A=%02X X=%02X Y=%02X P=%s S=%02X\n",
+           cycles, record -> bank, record -> volume, record -> pc, inst,
+           record -> reg_a, record -> reg_x, record -> reg_y, flags, record -> reg_sp);
+}
+
+static void print_dropped(trace_printer_t *printer, uint64_t dropped) {
+    if (dropped && printer -> filter.last == 0) {
+        printf("... %" PRIu64 " records dropped ...\n", dropped);
+    }
+}
+
+static void take_record(trace_printer_t *printer, const cpu6502_trace_record_t *record) {
+    // the stamps are the low bits of a counter that only grows.
+    if (printer -> started) {
+        printer -> cycles += (uint32_t) (record -> cycles - printer -> last_cycles);
+    } else {
+        printer -> cycles = record -> cycles;
+        printer -> started = true;
+    }
+    printer -> last_cycles = record -> cycles;
+
+    trace_filter_t *filter = &printer -> filter;
+    if (record -> pc < filter -> pc_low || record -> pc > filter -> pc_high ||
+            (filter -> bank >= 0 && record -> bank != filter -> bank) ||
+            (filter -> opcode >= 0 && record -> opcode != filter -> opcode)) {
+        return;
+    }
+    if (filter -> last) {
+        uint64_t slot = printer -> tail_count++ % filter -> last;
+        printer -> tail[slot] = *record;
+        printer -> tail_cycles[slot] = printer -> cycles;
+    } else {
+        print_record(record, printer -> cycles);
+    }
+}
+
+static bool print_trace(const char *file_path, trace_printer_t *printer) {
+    FILE *file = fopen(file_path, "rbe");
+    if (file == NULL) {
+        fprintf(stderr, "cannot read %s\n", file_path);
+        return false;
+    }
+    cpu6502_trace_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, CPU6502_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != CPU6502_TRACE_VERSION || header.record_size != sizeof(cpu6502_trace_record_t)) {
+        fprintf(stderr, "%s is not a trace\n", file_path);
+        fclose(file);
+        return false;
+    }
+
+    cpu6502_trace_record_t record;
+    if (header.capacity) {
+        // a ring, oldest record first.
+        uint64_t first = header.head > header.capacity ? header.head - header.capacity : 0;
+        for (uint64_t i = first; i < header.head; i++) {
+            if (i == first || i % header.capacity == 0) {
+                fseeko(file, (off_t) (sizeof(header) + (i % header.capacity) * sizeof(record)), SEEK_SET);
+            }
+            if (fread(&record, sizeof(record), 1, file) != 1) {
+                break;
+            }
+            take_record(printer, &record);
+        }
+    } else {
+        cpu6502_trace_chunk_t chunk;
+        while (fread(&chunk, sizeof(chunk), 1, file) == 1) {
+            for (uint32_t i = 0; i < chunk.count && fread(&record, sizeof(record), 1, file) == 1; i++) {
+                take_record(printer, &record);
+            }
+            print_dropped(printer, chunk.dropped);
+        }
+    }
+    fclose(file);
+
+    uint64_t last = printer -> filter.last;
+    uint64_t count = printer -> tail_count < last ? printer -> tail_count : last;
+    for (uint64_t i = printer -> tail_count - count; i < printer -> tail_count; i++) {
+        print_record(&printer -> tail[i % last], printer -> tail_cycles[i % last]);
+    }
+    return true;
+}
+
+#ifdef CPU6502_TRACE
+static int record_trace(int argc, char **argv) {
+    const char *state_file_path = NULL;
+    const char *script_file_path = NULL;
+    uint32_t capacity = 1u << 20u;
+    bool mapped = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:k:n:m")) != -1) {
+        switch (opt) {
+            case 's': state_file_path = optarg; break;
+            case 'k': script_file_path = optarg; break;
+            case 'n': capacity = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'm': mapped = true; break;
+            default: return 2;
+        }
+    }
+    if (optind != argc - 4) {
+        return 2;
+    }
+    uint64_t budget = strtoull(argv[optind + 2], NULL, 0);
+    const char *trace_file_path = argv[optind + 3];
+
+    size_t event_count = 0;
+    key_event_t *events = NULL;
+    if (script_file_path) {
+        events = load_key_script(script_file_path, &event_count);
+        if (events == NULL) {
+            fprintf(stderr, "cannot read %s\n", script_file_path);
+            return 1;
+        }
+    }
+    const char *error;
+    nc1020_t *nc = open_session(argv[optind], argv[optind + 1], state_file_path, &error);
+    if (nc == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+    cpu6502_trace_t *trace;
+    if (mapped) {
+        trace = map_6502_trace(trace_file_path, capacity);
+    } else {
+        trace = create_6502_trace(capacity);
+        if (trace && !stream_6502_trace(trace, trace_file_path)) {
+            destroy_6502_trace(trace);
+            trace = NULL;
+        }
+    }
+    if (trace == NULL) {
+        fprintf(stderr, "cannot write %s\n", trace_file_path);
+        return 1;
+    }
+
+    attach_trace(nc, trace);
+    double start_seconds = now_seconds();
+    uint64_t cycles = run_session(nc, events, event_count, budget);
+    double seconds = now_seconds() - start_seconds;
+    attach_trace(nc, NULL);
+
+    uint64_t records = atomic_load(&trace -> head);
+    destroy_6502_trace(trace);
+    fprintf(stderr, "%" PRIu64 " cycles in %.3f s, %" PRIu64 " records\n", cycles, seconds, records);
+
+    destroy_nc1020(nc);
+    free(events);
+    return 0;
+}
+#endif
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-p low-high] [-b bank] [-o opcode] [-l last] trace\n", name);
+#ifdef CPU6502_TRACE
+    fprintf(stderr, "       %s record [-s state] [-k script] [-n records] [-m] rom nor cycles trace\n", name);
+#endif
+}
+
+int main(int argc, char **argv) {
+#ifdef CPU6502_TRACE
+    if (argc > 1 && strcmp(argv[1], "record") == 0) {
+        int result = record_trace(argc - 1, argv + 1);
+        if (result == 2) {
+            usage(argv[0]);
+        }
+        return result;
+    }
+#endif
+    trace_printer_t printer;
+    memset(&printer, 0, sizeof(printer));
+    printer.filter.pc_high = 0xFFFF;
+    printer.filter.bank = -1;
+    printer.filter.opcode = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:b:o:l:")) != -1) {
+        switch (opt) {
+            case 'p':
+                if (sscanf(optarg, "%x-%x", &printer.filter.pc_low, &printer.filter.pc_high) != 2) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'b': printer.filter.bank = (int) strtol(optarg, NULL, 16); break;
+            case 'o': printer.filter.opcode = (int) strtol(optarg, NULL, 16); break;
+            case 'l': printer.filter.last = strtoull(optarg, NULL, 10); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (printer.filter.last) {
+        printer.tail = (cpu6502_trace_record_t*) malloc(printer.filter.last * sizeof(cpu6502_trace_record_t));
+        printer.tail_cycles = (uint64_t*) malloc(printer.filter.last * sizeof(uint64_t));
+    }
+    bool printed = print_trace(argv[optind], &printer);
+    free(printer.tail);
+    free(printer.tail_cycles);
+    return printed ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// the longest slice run between two script events.
+static const uint64_t SLICE_MS = 20;
+// the local time every session's clock syncs to, 2020-01-01 00:00.
+static const int64_t SESSION_TIME = 1577836800;
+
+static int64_t get_session_time(void *context) {
+    (void) context;
+    return SESSION_TIME;
+}
+
+static bool is_readable(const char *file_path) {
+    FILE *file = fopen(file_path, "rbe");
+    if (file == NULL) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+key_event_t *load_key_script(const char *file_path, size_t *count) {
+    *count = 0;
+    FILE *file = fopen(file_path, "re");
+    if (file == NULL) {
+        return NULL;
+    }
+    size_t capacity = 64;
+    key_event_t *events = (key_event_t*) malloc(capacity * sizeof(key_event_t));
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        unsigned long long ms;
+        unsigned int key_id, down;
+        if (sscanf(line, "%llu %i %u", &ms, &key_id, &down) != 3) {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            events = (key_event_t*) realloc(events, capacity * sizeof(key_event_t));
+        }
+        events[*count].ms = ms;
+        events[*count].key_id = (uint8_t) key_id;
+        events[*count].down = down != 0;
+        (*count)++;
+    }
+    fclose(file);
+    return events;
+}
+
+nc1020_t *open_session(const char *rom_file_path, const char *nor_file_path,
+                       const char *state_file_path, const char **error) {
+    if (!is_readable(rom_file_path)) {
+        *error = "rom not readable";
+        return NULL;
+    }
+    if (!is_readable(nor_file_path)) {
+        *error = "nor not readable";
+        return NULL;
+    }
+    if (state_file_path && !is_readable(state_file_path)) {
+        *error = "state not readable";
+        return NULL;
+    }
+    nc1020_t *nc = create_nc1020();
+    if (nc == NULL) {
+        *error = "out of memory";
+        return NULL;
+    }
+    if (!initialize(nc, rom_file_path, nor_file_path, state_file_path ? state_file_path : "")) {
+        destroy_nc1020(nc);
+        *error = "rom not loadable or path too long";
+        return NULL;
+    }
+    // other sessions may be reading the same files, and hashes have to repeat any day.
+    set_read_only(nc, true);
+    set_time_source(nc, get_session_time, NULL);
+    if (state_file_path) {
+        load_nc1020(nc);
+    } else {
+        reset(nc);
+    }
+    return nc;
+}
+
+/**
+ * Runs slices until either budget is reached, the cycles or the emulated ms.
+ * @return the cycles run.
+ */
+static uint64_t run_slices(nc1020_t *nc, const key_event_t *events, size_t count,
+                           uint64_t cycle_budget, uint64_t ms_budget) {
+    uint64_t start_cycles = get_cycles(nc);
+    uint64_t ms = 0;
+    size_t next_event = 0;
+    while (get_cycles(nc) - start_cycles < cycle_budget && ms < ms_budget) {
+        while (next_event < count && events[next_event].ms <= ms) {
+            set_key(nc, events[next_event].key_id, events[next_event].down);
+            next_event++;
+        }
+        uint64_t slice = SLICE_MS;
+        if (next_event < count && events[next_event].ms - ms < slice) {
+            slice = events[next_event].ms - ms;
+        }
+        if (ms_budget - ms < slice) {
+            slice = ms_budget - ms;
+        }
+        run_time_slice(nc, slice, false);
+        ms += slice;
+    }
+    return get_cycles(nc) - start_cycles;
+}
+
+uint64_t run_session(nc1020_t *nc, const key_event_t *events, size_t count, uint64_t budget) {
+    return run_slices(nc, events, count, budget, UINT64_MAX);
+}
+
+uint64_t run_session_ms(nc1020_t *nc, const key_event_t *events, size_t count, uint64_t ms) {
+    return run_slices(nc, events, count, UINT64_MAX, ms);
+}
+
+uint64_t hash_bytes(const uint8_t *data, uint64_t size) {
+    uint64_t hash = 0xCBF29CE484222325u;
+    for (uint64_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3u;
+    }
+    return hash;
+}
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
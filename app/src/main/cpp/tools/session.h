@@ -0,0 +1,52 @@
+//
+// Helpers shared by the host tools: starting a machine from files and running it
+// against a key script.
+//
+// A key script line is
+//     ms key down
+// pressing (down 1) or releasing (down 0) a key once that many emulated ms have
+// run, '#' starts a comment.
+//
+
+#ifndef NC1020_SESSION_H
+#define NC1020_SESSION_H
+
+#include "../wqx/nc1020.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint64_t ms;
+    uint8_t key_id;
+    bool down;
+} key_event_t;
+
+/**
+ * @return the events of the script, NULL if it can't be read. Free it when done.
+ */
+key_event_t *load_key_script(const char *file_path, size_t *count);
+
+/**
+ * Creates a machine and starts it from a state file, or from reset if state_file_path
+ * is NULL. The machine only reads the files, so sessions on any threads may share them,
+ * and its clock syncs to a fixed time, so its runs repeat.
+ * @return the machine, NULL with the reason in error if a file can't be read.
+ */
+nc1020_t *open_session(const char *rom_file_path, const char *nor_file_path,
+                       const char *state_file_path, const char **error);
+
+/**
+ * Runs the machine for at least budget cycles, pressing the keys of the script on the way.
+ * @return the cycles run.
+ */
+uint64_t run_session(nc1020_t *nc, const key_event_t *events, size_t count, uint64_t budget);
+
+// the same for ms emulated ms, the slices end exactly there.
+uint64_t run_session_ms(nc1020_t *nc, const key_event_t *events, size_t count, uint64_t ms);
+
+uint64_t hash_bytes(const uint8_t *data, uint64_t size);
+
+double now_seconds();
+
+#endif //NC1020_SESSION_H
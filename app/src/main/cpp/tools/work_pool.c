@@ -0,0 +1,187 @@
+#include "work_pool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef struct {
+    work_fn_t fn;
+    void *arg;
+} work_t;
+
+// a ring of tasks, the owner takes from the tail and thieves from the head.
+typedef struct {
+    pthread_mutex_t lock;
+    work_t *tasks;
+    size_t capacity;
+    size_t head;
+    size_t count;
+} work_deque_t;
+
+struct work_pool {
+    int workers;
+    work_deque_t *deques;
+    pthread_t *threads;
+    // deque for tasks submitted from outside the pool, round robin.
+    int next_deque;
+
+    // counts of tasks not yet done and not yet taken, guarded by idle_lock.
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    size_t pending;
+    size_t queued;
+};
+
+typedef struct {
+    work_pool_t *pool;
+    int index;
+} worker_t;
+
+static _Thread_local worker_t *_worker;
+
+static void push_work(work_deque_t *deque, work_t work) {
+    pthread_mutex_lock(&deque -> lock);
+    if (deque -> count == deque -> capacity) {
+        size_t capacity = deque -> capacity ? deque -> capacity * 2 : 16;
+        work_t *tasks = (work_t*) malloc(capacity * sizeof(work_t));
+        for (size_t i = 0; i < deque -> count; i++) {
+            tasks[i] = deque -> tasks[(deque -> head + i) % deque -> capacity];
+        }
+        free(deque -> tasks);
+        deque -> tasks = tasks;
+        deque -> capacity = capacity;
+        deque -> head = 0;
+    }
+    deque -> tasks[(deque -> head + deque -> count) % deque -> capacity] = work;
+    deque -> count++;
+    pthread_mutex_unlock(&deque -> lock);
+}
+
+static bool pop_work(work_deque_t *deque, bool steal, work_t *work) {
+    bool found = false;
+    pthread_mutex_lock(&deque -> lock);
+    if (deque -> count) {
+        if (steal) {
+            *work = deque -> tasks[deque -> head];
+            deque -> head = (deque -> head + 1) % deque -> capacity;
+        } else {
+            *work = deque -> tasks[(deque -> head + deque -> count - 1) % deque -> capacity];
+        }
+        deque -> count--;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque -> lock);
+    return found;
+}
+
+static bool take_work(work_pool_t *pool, int index, work_t *work) {
+    if (pop_work(&pool -> deques[index], false, work)) {
+        return true;
+    }
+    for (int i = 1; i < pool -> workers; i++) {
+        if (pop_work(&pool -> deques[(index + i) % pool -> workers], true, work)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *run_worker(void *arg) {
+    worker_t *worker = (worker_t*) arg;
+    work_pool_t *pool = worker -> pool;
+    _worker = worker;
+    for (;;) {
+        work_t work;
+        if (take_work(pool, worker -> index, &work)) {
+            pthread_mutex_lock(&pool -> idle_lock);
+            pool -> queued--;
+            pthread_mutex_unlock(&pool -> idle_lock);
+
+            work.fn(pool, work.arg);
+
+            pthread_mutex_lock(&pool -> idle_lock);
+            if (--pool -> pending == 0) {
+                pthread_cond_broadcast(&pool -> idle_cond);
+            }
+            pthread_mutex_unlock(&pool -> idle_lock);
+            continue;
+        }
+        pthread_mutex_lock(&pool -> idle_lock);
+        while (pool -> queued == 0 && pool -> pending != 0) {
+            pthread_cond_wait(&pool -> idle_cond, &pool -> idle_lock);
+        }
+        bool done = pool -> pending == 0;
+        pthread_mutex_unlock(&pool -> idle_lock);
+        if (done) {
+            break;
+        }
+    }
+    _worker = NULL;
+    return NULL;
+}
+
+work_pool_t *create_work_pool(int workers) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    work_pool_t *pool = (work_pool_t*) calloc(1, sizeof(work_pool_t));
+    pool -> workers = workers;
+    pool -> deques = (work_deque_t*) calloc((size_t) workers, sizeof(work_deque_t));
+    pool -> threads = (pthread_t*) calloc((size_t) workers, sizeof(pthread_t));
+    for (int i = 0; i < workers; i++) {
+        pthread_mutex_init(&pool -> deques[i].lock, NULL);
+    }
+    pthread_mutex_init(&pool -> idle_lock, NULL);
+    pthread_cond_init(&pool -> idle_cond, NULL);
+    return pool;
+}
+
+void destroy_work_pool(work_pool_t *pool) {
+    for (int i = 0; i < pool -> workers; i++) {
+        pthread_mutex_destroy(&pool -> deques[i].lock);
+        free(pool -> deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool -> idle_lock);
+    pthread_cond_destroy(&pool -> idle_cond);
+    free(pool -> deques);
+    free(pool -> threads);
+    free(pool);
+}
+
+void submit_work(work_pool_t *pool, work_fn_t fn, void *arg) {
+    int index;
+    if (_worker && _worker -> pool == pool) {
+        index = _worker -> index;
+    } else {
+        index = pool -> next_deque;
+        pool -> next_deque = (pool -> next_deque + 1) % pool -> workers;
+    }
+    // counted before the push so a worker finishing it early never sees pending drop below zero.
+    pthread_mutex_lock(&pool -> idle_lock);
+    pool -> pending++;
+    pool -> queued++;
+    pthread_mutex_unlock(&pool -> idle_lock);
+
+    work_t work = { fn, arg };
+    push_work(&pool -> deques[index], work);
+
+    pthread_mutex_lock(&pool -> idle_lock);
+    pthread_cond_broadcast(&pool -> idle_cond);
+    pthread_mutex_unlock(&pool -> idle_lock);
+}
+
+void run_work_pool(work_pool_t *pool) {
+    worker_t *workers = (worker_t*) calloc((size_t) pool -> workers, sizeof(worker_t));
+    for (int i = 0; i < pool -> workers; i++) {
+        workers[i].pool = pool;
+        workers[i].index = i;
+        pthread_create(&pool -> threads[i], NULL, run_worker, &workers[i]);
+    }
+    for (int i = 0; i < pool -> workers; i++) {
+        pthread_join(pool -> threads[i], NULL);
+    }
+    free(workers);
+}
+
+int work_pool_size(work_pool_t *pool) {
+    return pool -> workers;
+}
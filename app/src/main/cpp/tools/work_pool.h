@@ -0,0 +1,21 @@
+//
+// A fixed set of worker threads, each with its own task deque. A worker runs
+// its own tasks newest first and steals the oldest task of another worker
+// when it runs dry, so long and short tasks even out across the cores.
+//
+
+#ifndef NC1020_WORK_POOL_H
+#define NC1020_WORK_POOL_H
+
+typedef struct work_pool work_pool_t;
+typedef void (*work_fn_t)(work_pool_t *pool, void *arg);
+
+work_pool_t *create_work_pool(int workers);
+void destroy_work_pool(work_pool_t *pool);
+// may be called from a running task, the task then goes to that worker's deque.
+void submit_work(work_pool_t *pool, work_fn_t fn, void *arg);
+// runs until every submitted task, including the ones submitted meanwhile, is done.
+void run_work_pool(work_pool_t *pool);
+int work_pool_size(work_pool_t *pool);
+
+#endif //NC1020_WORK_POOL_H
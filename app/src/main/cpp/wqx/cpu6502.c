@@ -4,52 +4,645 @@
 #include "cpu6502.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
 
 
 static const uint16_t IRQ_VEC = 0xFFFE;
 
-static uint8_t (*_peek_byte)(uint16_t addr);
+// Threaded dispatch with GCC/Clang labels as values: every handler jumps straight
+// to the next one instead of going back through the switch. Define
+// CPU6502_SWITCH_DISPATCH to build the portable switch only.
+#if defined(__GNUC__) && !defined(CPU6502_SWITCH_DISPATCH)
+#define CPU6502_THREADED_DISPATCH
+#endif
 
-static uint8_t (*_load)(uint16_t addr);
+// Translation tier on top of the block cache, define CPU6502_TRANSLATE to build it:
+// decoded instructions carry the address of their handler (direct threaded code) and
+// blocks that ran TRANSLATE_THRESHOLD times are chained to their successors, so hot
+// loops run without block lookups. Needs threaded dispatch.
+#if defined(CPU6502_TRANSLATE) && !defined(CPU6502_THREADED_DISPATCH)
+#undef CPU6502_TRANSLATE
+#endif
 
-static void (*_store)(uint16_t addr, uint8_t value);
+// the operand of the current instruction, decoded by FETCH_INSTRUCTION.
+#define OPERAND_BYTE ((uint8_t) operand)
+#define OPERAND_WORD operand
+#define FETCH_BYTE() ((void) reg_pc++, OPERAND_BYTE)
 
-static uint16_t peek_word(uint16_t addr) {
-    return _peek_byte(addr) | (_peek_byte((uint16_t) (addr + 1u)) << 8u);
+// a callback that stopped the cpu ends the run after this instruction, whatever the budget.
+#define STORE(addr, value) do { \
+    if (store_byte(cpu, addr, value)) { \
+        inst_end = inst; \
+        if (cpu -> stopped) { \
+            cpu -> stopped = false; \
+            cycle_budget = 0; \
+        } \
+    } \
+} while (0)
+
+// N and Z are kept lazily: the N flag is bit 7 of flag_n and the Z flag is set when
+// flag_z is 0, so most handlers just store their result in both. reg_ps holds the
+// other flags and is only complete after PACK_FLAGS.
+#define PACK_FLAGS() (reg_ps = (reg_ps & 0x7Du) | (flag_n & 0x80u) | (!flag_z << 1u))
+#define UNPACK_FLAGS() (flag_n = reg_ps, flag_z = ~reg_ps & 0x02u)
+
+#ifdef CPU6502_PROFILE
+// a skipped pass runs no instructions to charge its cycles to, so a profiled cpu runs them all.
+#define CAN_SKIP_IDLE() (cpu -> profile == NULL)
+#else
+#define CAN_SKIP_IDLE() true
+#endif
+
+/*
+ * Called when a backward branch or jump is taken, once it added all of its cycles. If
+ * nothing changed since the same instruction last jumped to the same loop head, neither
+ * registers nor memory, every further pass is the same: whole passes are added to the
+ * cycles up to the budget at once, the rest runs as usual so the cpu stops at the same
+ * instruction as without skipping.
+ */
+#define SKIP_IDLE_LOOP(from) do { \
+    uint8_t ps = (reg_ps & 0x7Du) | (flag_n & 0x80u) | (!flag_z << 1u); \
+    if (CAN_SKIP_IDLE() && idle.pc == reg_pc && idle.from == (from) && idle.side_effects == cpu -> side_effects && \
+            idle.reg_a == reg_a && idle.reg_x == reg_x && idle.reg_y == reg_y && idle.reg_ps == ps && \
+            idle.reg_sp == reg_sp && cycles < cycle_budget) { \
+        uint64_t period = cycles - idle.cycles; \
+        uint64_t skipped = (cycle_budget - cycles) / period * period; \
+        cycles += skipped; \
+        STATS_IDLE(skipped); \
+    } \
+    idle.pc = reg_pc; \
+    idle.from = (from); \
+    idle.side_effects = cpu -> side_effects; \
+    idle.reg_a = reg_a; \
+    idle.reg_x = reg_x; \
+    idle.reg_y = reg_y; \
+    idle.reg_ps = ps; \
+    idle.reg_sp = reg_sp; \
+    idle.cycles = cycles; \
+} while (0)
+
+// a jump back is the end of a loop, the instruction is known by the pc after it.
+#define TAKE_BRANCH(addr) do { \
+    uint16_t from = reg_pc; \
+    reg_pc = (addr); \
+    if (reg_pc < from) { \
+        SKIP_IDLE_LOOP(from); \
+    } \
+} while (0)
+
+#ifdef CPU6502_PROFILE
+// hands the cycles since the last instruction start to the profiler, they belong to that instruction.
+#define PROFILE_INSTRUCTION() do { \
+    if (cpu -> profile) { \
+        cpu -> profile(cpu -> profile_context, reg_pc, cpu -> profile_cycles + (uint32_t) (cycles - profiled_cycles)); \
+        cpu -> profile_cycles = 0; \
+        profiled_cycles = cycles; \
+    } \
+} while (0)
+#else
+#define PROFILE_INSTRUCTION() do {} while (0)
+#endif
+
+#ifdef CPU6502_STATS
+// counts the instruction just fetched, and the cycles of the one before.
+#define STATS_INSTRUCTION() do { \
+    if (cpu -> stats) { \
+        if (stats_opcode >= 0) { \
+            count_6502_cycles(cpu -> stats, (uint8_t) stats_opcode, cycles - stats_cycles); \
+        } \
+        if (cpu -> stats_last_opcode >= 0) { \
+            cpu -> stats -> pairs[cpu -> stats_last_opcode << 8u | opcode]++; \
+        } \
+        cpu -> stats -> opcodes[opcode]++; \
+        cpu -> stats_last_opcode = opcode; \
+        stats_opcode = opcode; \
+        stats_cycles = cycles; \
+    } \
+} while (0)
+// skipped idle loops don't count for the branch that skipped them.
+#define STATS_IDLE(skipped) do { \
+    stats_cycles += (skipped); \
+    if (cpu -> stats) { \
+        cpu -> stats -> idle_cycles += (skipped); \
+    } \
+} while (0)
+#else
+#define STATS_INSTRUCTION() do {} while (0)
+#define STATS_IDLE(skipped) do {} while (0)
+#endif
+
+#ifdef CPU6502_TRACE
+// appends the instruction about to run to the trace, or drops it if a writer drains the
+// ring and is behind.
+#define TRACE_INSTRUCTION() do { \
+    if (trace) { \
+        if (!trace -> overwrite && trace_head - trace_tail > trace -> mask) { \
+            trace_tail = atomic_load_explicit(&trace -> tail, memory_order_acquire); \
+        } \
+        if (trace -> overwrite || trace_head - trace_tail <= trace -> mask) { \
+            cpu6502_trace_record_t *record = &trace -> records[trace_head++ & trace -> mask]; \
+            record -> cycles = (uint32_t) (trace -> cycles + cycles); \
+            record -> pc = reg_pc; \
+            record -> operand = operand; \
+            record -> opcode = opcode; \
+            record -> bank = *cpu -> trace_bank; \
+            record -> volume = *cpu -> trace_volume; \
+            record -> reg_a = reg_a; \
+            record -> reg_x = reg_x; \
+            record -> reg_y = reg_y; \
+            record -> reg_ps = (uint8_t) ((reg_ps & 0x7Du) | (flag_n & 0x80u) | (!flag_z << 1u)); \
+            record -> reg_sp = reg_sp; \
+        } else { \
+            atomic_fetch_add_explicit(&trace -> dropped, 1, memory_order_relaxed); \
+        } \
+    } \
+} while (0)
+#else
+#define TRACE_INSTRUCTION() do {} while (0)
+#endif
+
+#define FETCH_INSTRUCTION() do { \
+    PROFILE_INSTRUCTION(); \
+    if (inst == inst_end) { \
+        inst = next_block(cpu, &block, reg_pc, &inst_end, &uncached_inst); \
+    } \
+    opcode = inst -> opcode; \
+    STATS_INSTRUCTION(); \
+    operand = inst -> operand; \
+    TRACE_INSTRUCTION(); \
+    inst++; \
+    reg_pc++; \
+} while (0)
+
+#if defined(CPU6502_TRANSLATE)
+#define OPCODE(op) case op: op_##op
+#define NEXT \
+    if (cycles < cycle_budget) { \
+        FETCH_INSTRUCTION(); \
+        goto *inst[-1].handler; \
+    } \
+    break
+#elif defined(CPU6502_THREADED_DISPATCH)
+#define OPCODE(op) case op: op_##op
+#define NEXT \
+    if (cycles < cycle_budget) { \
+        FETCH_INSTRUCTION(); \
+        goto *dispatch_table[opcode]; \
+    } \
+    break
+#else
+#define OPCODE(op) case op
+#define NEXT break
+#endif
+
+/*
+ * Pre-decoded basic blocks of rom/nor code (pages with PAGE_CODE_CACHE). A block
+ * is keyed by the host address of its first opcode, so the bank and volume are part
+ * of the key, and ends at the first control flow instruction or at the page end.
+ * Code in ram is decoded again every time it runs.
+ */
+#define BLOCK_CACHE_SIZE 0x800
+#define BLOCK_MAX_INSTS 16
+#define CODE_REGION_SHIFT 11
+#define CODE_REGION_COUNT 0x400
+#define TRANSLATE_THRESHOLD 16
+#define BLOCK_LINKS 2
+
+typedef struct {
+#ifdef CPU6502_TRANSLATE
+    const void *handler;
+#endif
+    uint8_t opcode;
+    uint16_t operand;
+} decoded_inst_t;
+
+typedef struct code_block {
+    const uint8_t *code;
+    uint16_t size;
+    uint8_t count;
+#ifdef CPU6502_TRANSLATE
+    uint8_t hits;
+    // successor blocks by pc, only valid in the code generation they were linked in.
+    uint32_t link_generation;
+    uint16_t link_pcs[BLOCK_LINKS];
+    struct code_block *links[BLOCK_LINKS];
+#endif
+    decoded_inst_t insts[BLOCK_MAX_INSTS];
+} code_block_t;
+
+// the state at the head of the last loop, see SKIP_IDLE_LOOP.
+typedef struct {
+    uint16_t pc;
+    // the pc after the branch or jump that went there.
+    uint16_t from;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_ps;
+    uint8_t reg_sp;
+    uint32_t side_effects;
+    uint64_t cycles;
+} idle_loop_t;
+
+static const uint8_t INST_LENGTH[0x100] = {
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 1, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        3, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        1, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 1, 3, 1, 1,
+        2, 2, 2, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1,
+        2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1,
+};
+
+struct cpu6502 {
+    uint8_t (*load)(void *context, uint16_t addr);
+    void (*store)(void *context, uint16_t addr, uint8_t value);
+    void *context;
+    uint8_t **memmap;
+    const uint8_t *page_flags;
+
+    // bumped by every store that changes memory or goes to a device, and by
+    // mark_6502_side_effect. A loop that doesn't bump it is idle.
+    uint32_t side_effects;
+    // set by stop_6502 from a store callback.
+    bool stopped;
+
+    bool translate;
+#ifdef CPU6502_TRANSLATE
+    // bumped whenever the memmap changes or a block goes away, which breaks all links.
+    uint32_t generation;
+    const void *const *handlers;
+#endif
+#ifdef CPU6502_PROFILE
+    void (*profile)(void *context, uint16_t pc, uint32_t cycles);
+    void *profile_context;
+    // cycles of the last instruction of the previous run, not handed to the profiler yet.
+    uint32_t profile_cycles;
+#endif
+#ifdef CPU6502_TRACE
+    cpu6502_trace_t *trace;
+    const uint8_t *trace_bank;
+    const uint8_t *trace_volume;
+#endif
+#ifdef CPU6502_STATS
+    cpu6502_stats_t *stats;
+    // the opcode a pair starts with, -1 after an interrupt.
+    int stats_last_opcode;
+#endif
+
+    // cached blocks per (hashed) 2K region of host memory, to skip most invalidations.
+    uint16_t code_regions[CODE_REGION_COUNT];
+    code_block_t blocks[BLOCK_CACHE_SIZE];
+};
+
+static inline uint8_t peek_byte(cpu6502_t *cpu, uint16_t addr) {
+    return cpu -> memmap[addr >> 13u][addr & 0x1FFFu];
+}
+
+static uint16_t peek_word(cpu6502_t *cpu, uint16_t addr) {
+    return peek_byte(cpu, addr) | (peek_byte(cpu, (uint16_t) (addr + 1u)) << 8u);
+}
+
+/**
+ * Plain pages are accessed through the memmap directly, the callbacks only
+ * handle the pages with side effects (IO, flash commands, wake up).
+ */
+static inline uint8_t load_byte(cpu6502_t *cpu, uint16_t addr) {
+    if (cpu -> page_flags[addr >> 13u] & PAGE_DIRECT_READ) {
+        return peek_byte(cpu, addr);
+    }
+    return cpu -> load(cpu -> context, addr);
+}
+
+/**
+ * @return true if the store went through the callback, which may switch banks or
+ * program the nor flash, so the current block has to be fetched again.
+ */
+static inline bool store_byte(cpu6502_t *cpu, uint16_t addr, uint8_t value) {
+    if (cpu -> page_flags[addr >> 13u] & PAGE_DIRECT_WRITE) {
+        uint8_t *ptr = &cpu -> memmap[addr >> 13u][addr & 0x1FFFu];
+        if (*ptr != value) {
+            *ptr = value;
+            cpu -> side_effects++;
+        }
+        return false;
+    }
+    cpu -> side_effects++;
+    cpu -> store(cpu -> context, addr, value);
+    return true;
+}
+
+static bool is_block_end(uint8_t opcode) {
+    switch (opcode) {
+        case 0x00: case 0x20: case 0x40: case 0x4C: case 0x60: case 0x6C:
+        case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xB0: case 0xD0: case 0xF0:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static uint32_t code_region(const uint8_t *code) {
+    return (uint32_t) (((uintptr_t) code >> CODE_REGION_SHIFT) % CODE_REGION_COUNT);
+}
+
+static void track_block(cpu6502_t *cpu, const code_block_t *block, int delta) {
+    uint32_t first = code_region(block -> code);
+    uint32_t last = code_region(block -> code + block -> size - 1);
+    cpu -> code_regions[first] += delta;
+    if (last != first) {
+        cpu -> code_regions[last] += delta;
+    }
+}
+
+static code_block_t *get_block_slot(cpu6502_t *cpu, const uint8_t *code) {
+    uintptr_t key = (uintptr_t) code;
+    return &cpu -> blocks[(key ^ (key >> 11u) ^ (key >> 17u)) % BLOCK_CACHE_SIZE];
+}
+
+static void decode_inst(cpu6502_t *cpu, decoded_inst_t *inst, uint16_t pc) {
+    inst -> opcode = peek_byte(cpu, pc);
+#ifdef CPU6502_TRANSLATE
+    inst -> handler = cpu -> handlers[inst -> opcode];
+#endif
+    inst -> operand = 0;
+    if (INST_LENGTH[inst -> opcode] > 1) {
+        inst -> operand = peek_byte(cpu, (uint16_t) (pc + 1u));
+    }
+    if (INST_LENGTH[inst -> opcode] > 2) {
+        inst -> operand |= peek_byte(cpu, (uint16_t) (pc + 2u)) << 8u;
+    }
+}
+
+/**
+ * Decode the block starting at pc, all of its instructions lie in pc's page.
+ * @return false if not even the first instruction fits.
+ */
+static bool build_block(cpu6502_t *cpu, code_block_t *block, const uint8_t *code, uint16_t pc) {
+    uint32_t offset = pc & 0x1FFFu;
+    uint8_t count = 0;
+    uint16_t size = 0;
+    while (count < BLOCK_MAX_INSTS) {
+        uint8_t opcode = code[size];
+        uint8_t length = INST_LENGTH[opcode];
+        if (offset + size + length > 0x2000) {
+            break;
+        }
+        decode_inst(cpu, &block -> insts[count++], (uint16_t) (pc + size));
+        size += length;
+        if (is_block_end(opcode)) {
+            break;
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    block -> code = code;
+    block -> size = size;
+    block -> count = count;
+#ifdef CPU6502_TRANSLATE
+    block -> hits = 0;
+    block -> link_generation = cpu -> generation - 1;
+#endif
+    track_block(cpu, block, 1);
+    return true;
+}
+
+static void drop_block(cpu6502_t *cpu, code_block_t *block) {
+    track_block(cpu, block, -1);
+    block -> code = NULL;
+#ifdef CPU6502_TRANSLATE
+    cpu -> generation++;
+#endif
+}
+
+static code_block_t *fetch_block_slow(cpu6502_t *cpu, uint16_t pc) {
+    uint8_t page = (uint8_t) (pc >> 13u);
+    if (cpu -> translate && (cpu -> page_flags[page] & PAGE_CODE_CACHE)) {
+        const uint8_t *code = &cpu -> memmap[page][pc & 0x1FFFu];
+        code_block_t *block = get_block_slot(cpu, code);
+        if (block -> code) {
+            drop_block(cpu, block);
+        }
+        if (build_block(cpu, block, code, pc)) {
+            return block;
+        }
+    }
+    return NULL;
 }
 
-static void store_stack(uint8_t sp, uint8_t value) {
-    uint16_t stack_ptr = (uint16_t) (0x100 + sp);
-    _store(stack_ptr, value);
+/**
+ * @return the cached block at pc, or NULL if the code there can't be cached.
+ */
+static inline code_block_t *fetch_block(cpu6502_t *cpu, uint16_t pc) {
+    uint8_t page = (uint8_t) (pc >> 13u);
+    if (cpu -> translate && (cpu -> page_flags[page] & PAGE_CODE_CACHE)) {
+        const uint8_t *code = &cpu -> memmap[page][pc & 0x1FFFu];
+        code_block_t *block = get_block_slot(cpu, code);
+        if (block -> code == code) {
+            return block;
+        }
+    }
+    return fetch_block_slow(cpu, pc);
+}
+
+#ifdef CPU6502_TRANSLATE
+static void link_block(cpu6502_t *cpu, code_block_t *block, uint16_t pc, code_block_t *next) {
+    if (block -> link_generation != cpu -> generation) {
+        block -> link_generation = cpu -> generation;
+        for (int i = 0; i < BLOCK_LINKS; i++) {
+            block -> links[i] = NULL;
+        }
+    }
+    int slot = 0;
+    while (slot < BLOCK_LINKS - 1 && block -> links[slot]) {
+        slot++;
+    }
+    block -> link_pcs[slot] = pc;
+    block -> links[slot] = next;
+}
+#endif
+
+/**
+ * Move on from the current block to the code at pc, through the links of a
+ * translated block if possible.
+ * @return the decoded instructions from pc onwards, end is set after the last one.
+ */
+static inline const decoded_inst_t *next_block(cpu6502_t *cpu, code_block_t **current, uint16_t pc,
+                                               const decoded_inst_t **end,
+                                               decoded_inst_t *uncached_inst) {
+    code_block_t *block = NULL;
+#ifdef CPU6502_TRANSLATE
+    code_block_t *prev = *current;
+    if (prev && prev -> link_generation == cpu -> generation) {
+        for (int i = 0; i < BLOCK_LINKS; i++) {
+            if (prev -> links[i] && prev -> link_pcs[i] == pc) {
+                block = prev -> links[i];
+                break;
+            }
+        }
+    }
+    if (!block) {
+        block = fetch_block(cpu, pc);
+        if (prev && block && prev -> hits >= TRANSLATE_THRESHOLD) {
+            link_block(cpu, prev, pc, block);
+        }
+    }
+    if (block && block -> hits < TRANSLATE_THRESHOLD) {
+        block -> hits++;
+    }
+#else
+    block = fetch_block(cpu, pc);
+#endif
+    *current = block;
+    if (block) {
+        *end = block -> insts + block -> count;
+        return block -> insts;
+    }
+    decode_inst(cpu, uncached_inst, pc);
+    *end = uncached_inst + 1;
+    return uncached_inst;
+}
+
+void invalidate_6502_code(cpu6502_t *cpu, const uint8_t *code, uint32_t size) {
+    if (size == 0) {
+        return;
+    }
+    bool cached = false;
+    uintptr_t last_region = ((uintptr_t) code + size - 1) >> CODE_REGION_SHIFT;
+    for (uintptr_t region = (uintptr_t) code >> CODE_REGION_SHIFT; region <= last_region && !cached; region++) {
+        cached = cpu -> code_regions[region % CODE_REGION_COUNT] != 0;
+    }
+    if (!cached) {
+        return;
+    }
+    for (int i = 0; i < BLOCK_CACHE_SIZE; i++) {
+        code_block_t *block = &cpu -> blocks[i];
+        if (block -> code && block -> code < code + size && block -> code + block -> size > code) {
+            drop_block(cpu, block);
+        }
+    }
+}
+
+void remap_6502(cpu6502_t *cpu) {
+#ifdef CPU6502_TRANSLATE
+    cpu -> generation++;
+#else
+    (void) cpu;
+#endif
+}
+
+void set_6502_translation(cpu6502_t *cpu, bool enabled) {
+    cpu -> translate = enabled;
+}
+
+void mark_6502_side_effect(cpu6502_t *cpu) {
+    cpu -> side_effects++;
+}
+
+void stop_6502(cpu6502_t *cpu) {
+    cpu -> stopped = true;
+}
+
+#ifdef CPU6502_TRACE
+void set_6502_trace(cpu6502_t *cpu, cpu6502_trace_t *trace, const uint8_t *bank, const uint8_t *volume) {
+    cpu -> trace = trace;
+    cpu -> trace_bank = bank;
+    cpu -> trace_volume = volume;
+}
+#endif
+
+#ifdef CPU6502_STATS
+static inline void count_6502_cycles(cpu6502_stats_t *stats, uint8_t opcode, uint64_t cycles) {
+    stats -> opcode_cycles[opcode][cycles < CPU6502_STATS_CYCLES ? cycles : CPU6502_STATS_CYCLES - 1]++;
+}
+
+void set_6502_stats(cpu6502_t *cpu, cpu6502_stats_t *stats) {
+    cpu -> stats = stats;
+    cpu -> stats_last_opcode = -1;
+}
+#endif
+
+#ifdef CPU6502_PROFILE
+void set_6502_profiler(cpu6502_t *cpu, void (*profile)(void *context, uint16_t pc, uint32_t cycles),
+                       void *context) {
+    cpu -> profile = profile;
+    cpu -> profile_context = context;
+    cpu -> profile_cycles = 0;
+}
+#endif
+
+// the stack page is plain ram in page 0, after the IO registers.
+static inline void store_stack(cpu6502_t *cpu, uint8_t sp, uint8_t value) {
+    uint8_t *ptr = &cpu -> memmap[0][0x100 + sp];
+    if (*ptr != value) {
+        *ptr = value;
+        cpu -> side_effects++;
+    }
+}
+
+static inline uint8_t load_stack(cpu6502_t *cpu, uint8_t sp) {
+    return cpu -> memmap[0][0x100 + sp];
 }
 
-static uint8_t load_stack(uint8_t sp) {
-    return _load((uint16_t) (0x100 + sp));
+cpu6502_t *create_6502(uint8_t (*load)(void *context, uint16_t addr),
+        void (*store)(void *context, uint16_t addr, uint8_t value),
+        void *context,
+        uint8_t *memmap[8],
+        const uint8_t page_flags[8]) {
+    cpu6502_t *cpu = (cpu6502_t *) calloc(1, sizeof(cpu6502_t));
+    if (cpu == NULL) {
+        return NULL;
+    }
+    cpu -> load = load;
+    cpu -> store = store;
+    cpu -> context = context;
+    cpu -> memmap = memmap;
+    cpu -> page_flags = page_flags;
+    cpu -> translate = true;
+#ifdef CPU6502_STATS
+    cpu -> stats_last_opcode = -1;
+#endif
+    return cpu;
 }
 
-void init_6502(uint8_t (*peek_byte)(uint16_t addr),
-        uint8_t (*load)(uint16_t addr),
-        void (*store)(uint16_t addr, uint8_t value)) {
-    _peek_byte = peek_byte;
-    _load = load;
-    _store = store;
+void destroy_6502(cpu6502_t *cpu) {
+    free(cpu);
 }
 
 /**
  * @return cycles for the execution
  */
-uint64_t do_irq(cpu_states_t *cpu_states) {
+uint64_t do_irq(cpu6502_t *cpu, cpu_states_t *cpu_states) {
     uint8_t reg_sp = cpu_states -> reg_sp;
     uint16_t reg_pc = cpu_states -> reg_pc;
     uint8_t reg_ps = cpu_states -> reg_ps;
 
     if (!(reg_ps & 0x04u)) {
-        store_stack(reg_sp--, (uint8_t) (reg_pc >> 8u));
-        store_stack(reg_sp--, (uint8_t) (reg_pc & 0xFFu));
+        store_stack(cpu, reg_sp--, (uint8_t) (reg_pc >> 8u));
+        store_stack(cpu, reg_sp--, (uint8_t) (reg_pc & 0xFFu));
         reg_ps &= 0xEFu;
-        store_stack(reg_sp--, reg_ps);
-        reg_pc = peek_word(IRQ_VEC);
+        store_stack(cpu, reg_sp--, reg_ps);
+        reg_pc = peek_word(cpu, IRQ_VEC);
         reg_ps |= 0x04u;
+#ifdef CPU6502_STATS
+        cpu -> stats_last_opcode = -1;
+#endif
+#ifdef CPU6502_TRACE
+        if (cpu -> trace) {
+            cpu -> trace -> cycles += 7;
+        }
+#endif
 
         cpu_states -> reg_sp = reg_sp;
         cpu_states -> reg_pc = reg_pc;
@@ -61,1723 +654,1804 @@ uint64_t do_irq(cpu_states_t *cpu_states) {
 
 
 /**
+ * Execute instructions with the registers kept in locals, until at least
+ * cycle_budget cycles are consumed. At least one instruction is always executed,
+ * so a budget of 0 single steps the cpu.
+ *
  * @return cycles for the execution
  */
-uint64_t execute_6502(cpu_states_t *cpu_states) {
+uint64_t execute_6502_until(cpu6502_t *cpu, cpu_states_t *cpu_states, uint64_t cycle_budget) {
     uint64_t cycles = 0;
+    const decoded_inst_t *inst = NULL;
+    const decoded_inst_t *inst_end = NULL;
+    decoded_inst_t uncached_inst;
+    code_block_t *block = NULL;
+    uint8_t opcode;
+    uint16_t operand;
     uint16_t reg_pc = cpu_states -> reg_pc;
     uint8_t reg_a =  cpu_states -> reg_a;
     uint8_t reg_ps = cpu_states -> reg_ps;
     uint8_t reg_x = cpu_states -> reg_x;
     uint8_t reg_y = cpu_states -> reg_y;
     uint8_t reg_sp = cpu_states -> reg_sp;
+    uint8_t flag_n;
+    uint8_t flag_z;
+    UNPACK_FLAGS();
+    cpu -> stopped = false;
+    // no loop head seen yet.
+    idle_loop_t idle = {.side_effects = cpu -> side_effects - 1u};
+#ifdef CPU6502_PROFILE
+    uint64_t profiled_cycles = 0;
+#endif
+#ifdef CPU6502_STATS
+    int stats_opcode = -1;
+    uint64_t stats_cycles = 0;
+#endif
+#ifdef CPU6502_TRACE
+    cpu6502_trace_t *const trace = cpu -> trace;
+    uint64_t trace_head = 0;
+    uint64_t trace_tail = 0;
+    if (trace) {
+        trace_head = atomic_load_explicit(&trace -> head, memory_order_relaxed);
+        trace_tail = atomic_load_explicit(&trace -> tail, memory_order_acquire);
+    }
+#endif
 
-    switch (_peek_byte(reg_pc++)) {
-        case 0x00: {
-            reg_pc++;
-            store_stack(reg_sp--, (uint8_t) (reg_pc >> 8u));
-            store_stack(reg_sp--, (uint8_t) (reg_pc & 0xFFu));
-            reg_ps |= 0x10u;
-            store_stack(reg_sp--, reg_ps);
-            reg_ps |= 0x04u;
-            reg_pc = peek_word(IRQ_VEC);
-            cycles += 7;
-        }
-            break;
-        case 0x01: {
-            uint16_t addr = peek_word((uint16_t) ((_peek_byte(reg_pc++) + reg_x) & 0xFFu));
-            reg_a |= _load(addr);
-            reg_ps &= 0x7Du;
-            reg_ps |= (reg_a & 0x80u) | (!reg_a << 1u);
-            cycles += 6;
-        }
-            break;
-        case 0x02: {
-        }
-            break;
-        case 0x03: {
-        }
-            break;
-        case 0x04: {
-        }
-            break;
-        case 0x05: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_a |= _load(addr);
-            reg_ps &= 0x7Du;
-            reg_ps |= (reg_a & 0x80u) | (!reg_a << 1u);
-            cycles += 3;
-        }
-            break;
-        case 0x06: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7Cu;
-            reg_ps |= (tmp1 >> 7u);
-            tmp1 <<= 1u;
-            reg_ps |= (tmp1 & 0x80u) | (!tmp1 << 1u);
-            _store(addr, tmp1);
-            cycles += 5;
-        }
-            break;
-        case 0x07: {
-        }
-            break;
-        case 0x08: {
-            store_stack(reg_sp--, reg_ps);
-            cycles += 3;
-        }
-            break;
-        case 0x09: {
-            uint16_t addr = reg_pc++;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7Du;
-            reg_ps |= (reg_a & 0x80u) | (!reg_a << 1u);
-            cycles += 2;
-        }
-            break;
-        case 0x0A: {
-            reg_ps &= 0x7Cu;
-            reg_ps |= reg_a >> 7u;
-            reg_a <<= 1u;
-            reg_ps |= (reg_a & 0x80u) | (!reg_a << 1u);
-            cycles += 2;
-        }
-            break;
-        case 0x0B: {
-        }
-            break;
-        case 0x0C: {
-        }
-            break;
-        case 0x0D: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x0E: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 >> 7);
-            tmp1 <<= 1;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x0F: {
-        }
-            break;
-        case 0x10: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if (!(reg_ps & 0x80)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+#ifdef CPU6502_THREADED_DISPATCH
+    static const void *const dispatch_table[0x100] = {
+            &&op_0x00, &&op_0x01, &&op_0x02, &&op_0x03, &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+            &&op_0x08, &&op_0x09, &&op_0x0A, &&op_0x0B, &&op_0x0C, &&op_0x0D, &&op_0x0E, &&op_0x0F,
+            &&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13, &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+            &&op_0x18, &&op_0x19, &&op_0x1A, &&op_0x1B, &&op_0x1C, &&op_0x1D, &&op_0x1E, &&op_0x1F,
+            &&op_0x20, &&op_0x21, &&op_0x22, &&op_0x23, &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+            &&op_0x28, &&op_0x29, &&op_0x2A, &&op_0x2B, &&op_0x2C, &&op_0x2D, &&op_0x2E, &&op_0x2F,
+            &&op_0x30, &&op_0x31, &&op_0x32, &&op_0x33, &&op_0x34, &&op_0x35, &&op_0x36, &&op_0x37,
+            &&op_0x38, &&op_0x39, &&op_0x3A, &&op_0x3B, &&op_0x3C, &&op_0x3D, &&op_0x3E, &&op_0x3F,
+            &&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+            &&op_0x48, &&op_0x49, &&op_0x4A, &&op_0x4B, &&op_0x4C, &&op_0x4D, &&op_0x4E, &&op_0x4F,
+            &&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+            &&op_0x58, &&op_0x59, &&op_0x5A, &&op_0x5B, &&op_0x5C, &&op_0x5D, &&op_0x5E, &&op_0x5F,
+            &&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+            &&op_0x68, &&op_0x69, &&op_0x6A, &&op_0x6B, &&op_0x6C, &&op_0x6D, &&op_0x6E, &&op_0x6F,
+            &&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+            &&op_0x78, &&op_0x79, &&op_0x7A, &&op_0x7B, &&op_0x7C, &&op_0x7D, &&op_0x7E, &&op_0x7F,
+            &&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+            &&op_0x88, &&op_0x89, &&op_0x8A, &&op_0x8B, &&op_0x8C, &&op_0x8D, &&op_0x8E, &&op_0x8F,
+            &&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+            &&op_0x98, &&op_0x99, &&op_0x9A, &&op_0x9B, &&op_0x9C, &&op_0x9D, &&op_0x9E, &&op_0x9F,
+            &&op_0xA0, &&op_0xA1, &&op_0xA2, &&op_0xA3, &&op_0xA4, &&op_0xA5, &&op_0xA6, &&op_0xA7,
+            &&op_0xA8, &&op_0xA9, &&op_0xAA, &&op_0xAB, &&op_0xAC, &&op_0xAD, &&op_0xAE, &&op_0xAF,
+            &&op_0xB0, &&op_0xB1, &&op_0xB2, &&op_0xB3, &&op_0xB4, &&op_0xB5, &&op_0xB6, &&op_0xB7,
+            &&op_0xB8, &&op_0xB9, &&op_0xBA, &&op_0xBB, &&op_0xBC, &&op_0xBD, &&op_0xBE, &&op_0xBF,
+            &&op_0xC0, &&op_0xC1, &&op_0xC2, &&op_0xC3, &&op_0xC4, &&op_0xC5, &&op_0xC6, &&op_0xC7,
+            &&op_0xC8, &&op_0xC9, &&op_0xCA, &&op_0xCB, &&op_0xCC, &&op_0xCD, &&op_0xCE, &&op_0xCF,
+            &&op_0xD0, &&op_0xD1, &&op_0xD2, &&op_0xD3, &&op_0xD4, &&op_0xD5, &&op_0xD6, &&op_0xD7,
+            &&op_0xD8, &&op_0xD9, &&op_0xDA, &&op_0xDB, &&op_0xDC, &&op_0xDD, &&op_0xDE, &&op_0xDF,
+            &&op_0xE0, &&op_0xE1, &&op_0xE2, &&op_0xE3, &&op_0xE4, &&op_0xE5, &&op_0xE6, &&op_0xE7,
+            &&op_0xE8, &&op_0xE9, &&op_0xEA, &&op_0xEB, &&op_0xEC, &&op_0xED, &&op_0xEE, &&op_0xEF,
+            &&op_0xF0, &&op_0xF1, &&op_0xF2, &&op_0xF3, &&op_0xF4, &&op_0xF5, &&op_0xF6, &&op_0xF7,
+            &&op_0xF8, &&op_0xF9, &&op_0xFA, &&op_0xFB, &&op_0xFC, &&op_0xFD, &&op_0xFE, &&op_0xFF
+    };
+#endif
+#ifdef CPU6502_TRANSLATE
+    cpu -> handlers = dispatch_table;
+#endif
+
+    do {
+        FETCH_INSTRUCTION();
+        switch (opcode) {
+            OPCODE(0x00): {
+                reg_pc++;
+                store_stack(cpu, reg_sp--, (uint8_t) (reg_pc >> 8u));
+                store_stack(cpu, reg_sp--, (uint8_t) (reg_pc & 0xFFu));
+                PACK_FLAGS();
+                reg_ps |= 0x10u;
+                store_stack(cpu, reg_sp--, reg_ps);
+                reg_ps |= 0x04u;
+                reg_pc = peek_word(cpu, IRQ_VEC);
+                cycles += 7;
             }
-            cycles += 2;
-        }
-            break;
-        case 0x11: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 5;
-        }
-            break;
-        case 0x12: {
-        }
-            break;
-        case 0x13: {
-        }
-            break;
-        case 0x14: {
-        }
-            break;
-        case 0x15: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x16: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 >> 7);
-            tmp1 <<= 1;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x17: {
-        }
-            break;
-        case 0x18: {
-            reg_ps &= 0xFE;
-            cycles += 2;
-        }
-            break;
-        case 0x19: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x1A: {
-        }
-            break;
-        case 0x1B: {
-        }
-            break;
-        case 0x1C: {
-        }
-            break;
-        case 0x1D: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            reg_a |= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x1E: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 >> 7);
-            tmp1 <<= 1;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x1F: {
-        }
-            break;
-        case 0x20: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_pc--;
-            store_stack(reg_sp--, (uint8_t) (reg_pc >> 8));
-            store_stack(reg_sp--, (uint8_t) (reg_pc & 0xFF));
-            reg_pc = addr;
-            cycles += 6;
-        }
-            break;
-        case 0x21: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 6;
-        }
-            break;
-        case 0x22: {
-        }
-            break;
-        case 0x23: {
-        }
-            break;
-        case 0x24: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x3D;
-            reg_ps |= (!(reg_a & tmp1) << 1) | (tmp1 & 0xC0);
-            cycles += 3;
-        }
-            break;
-        case 0x25: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 3;
-        }
-            break;
-        case 0x26: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >> 7);
-            _store(addr, tmp2);
-            cycles += 5;
-        }
-            break;
-        case 0x27: {
-        }
-            break;
-        case 0x28: {
-            reg_ps = load_stack(++reg_sp);
-            cycles += 4;
-        }
-            break;
-        case 0x29: {
-            uint16_t addr = reg_pc++;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x2A: {
-            uint8_t tmp1 = reg_a;
-            reg_a = (reg_a << 1) | (reg_ps & 0x01);
-            reg_ps &= 0x7C;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1) | (tmp1 >> 7);
-            cycles += 2;
-        }
-            break;
-        case 0x2B: {
-        }
-            break;
-        case 0x2C: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x3D;
-            reg_ps |= (!(reg_a & tmp1) << 1) | (tmp1 & 0xC0);
-            cycles += 4;
-        }
-            break;
-        case 0x2D: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x2E: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >> 7);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x2F: {
-        }
-            break;
-        case 0x30: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if ((reg_ps & 0x80)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                NEXT;
+            OPCODE(0x01): {
+                uint16_t addr = peek_word(cpu, (uint16_t) ((FETCH_BYTE() + reg_x) & 0xFFu));
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x02): {
+            }
+                NEXT;
+            OPCODE(0x03): {
+            }
+                NEXT;
+            OPCODE(0x04): {
+            }
+                NEXT;
+            OPCODE(0x05): {
+                uint16_t addr = FETCH_BYTE();
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x06): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFEu;
+                reg_ps |= (tmp1 >> 7u);
+                tmp1 <<= 1u;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x07): {
+            }
+                NEXT;
+            OPCODE(0x08): {
+                PACK_FLAGS();
+                store_stack(cpu, reg_sp--, reg_ps);
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x09): {
+                uint16_t addr = reg_pc++;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x0A): {
+                reg_ps &= 0xFEu;
+                reg_ps |= reg_a >> 7u;
+                reg_a <<= 1u;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x0B): {
+            }
+                NEXT;
+            OPCODE(0x0C): {
+            }
+                NEXT;
+            OPCODE(0x0D): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x0E): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                tmp1 <<= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x0F): {
+            }
+                NEXT;
+            OPCODE(0x10): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if (!(flag_n & 0x80)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0x11): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x12): {
+            }
+                NEXT;
+            OPCODE(0x13): {
+            }
+                NEXT;
+            OPCODE(0x14): {
+            }
+                NEXT;
+            OPCODE(0x15): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x16): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                tmp1 <<= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x17): {
+            }
+                NEXT;
+            OPCODE(0x18): {
+                reg_ps &= 0xFE;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x19): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x1A): {
+            }
+                NEXT;
+            OPCODE(0x1B): {
+            }
+                NEXT;
+            OPCODE(0x1C): {
+            }
+                NEXT;
+            OPCODE(0x1D): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                reg_a |= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x1E): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                tmp1 <<= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x1F): {
+            }
+                NEXT;
+            OPCODE(0x20): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_pc--;
+                store_stack(cpu, reg_sp--, (uint8_t) (reg_pc >> 8));
+                store_stack(cpu, reg_sp--, (uint8_t) (reg_pc & 0xFF));
                 reg_pc = addr;
+                cycles += 6;
             }
-            cycles += 2;
-        }
-            break;
-        case 0x31: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 5;
-        }
-            break;
-        case 0x32: {
-        }
-            break;
-        case 0x33: {
-        }
-            break;
-        case 0x34: {
-        }
-            break;
-        case 0x35: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x36: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >> 7);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x37: {
-        }
-            break;
-        case 0x38: {
-            reg_ps |= 0x01;
-            cycles += 2;
-        }
-            break;
-        case 0x39: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x3A: {
-        }
-            break;
-        case 0x3B: {
-        }
-            break;
-        case 0x3C: {
-        }
-            break;
-        case 0x3D: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            reg_a &= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x3E: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >> 7);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x3F: {
-        }
-            break;
-        case 0x40: {
-            reg_ps = load_stack(++reg_sp);
-            reg_pc = load_stack(++reg_sp);
-            reg_pc |= (load_stack(++reg_sp) << 8);
-            cycles += 6;
-        }
-            break;
-        case 0x41: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 6;
-        }
-            break;
-        case 0x42: {
-        }
-            break;
-        case 0x43: {
-        }
-            break;
-        case 0x44: {
-        }
-            break;
-        case 0x45: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 3;
-        }
-            break;
-        case 0x46: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 & 0x01);
-            tmp1 >>= 1;
-            reg_ps |= (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 5;
-        }
-            break;
-        case 0x47: {
-        }
-            break;
-        case 0x48: {
-            store_stack(reg_sp--, reg_a);
-            cycles += 3;
-        }
-            break;
-        case 0x49: {
-            uint16_t addr = reg_pc++;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x4A: {
-            reg_ps &= 0x7C;
-            reg_ps |= reg_a & 0x01;
-            reg_a >>= 1;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x4B: {
-        }
-            break;
-        case 0x4C: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_pc = addr;
-            cycles += 3;
-        }
-            break;
-        case 0x4D: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x4E: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 & 0x01);
-            tmp1 >>= 1;
-            reg_ps |= (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x4F: {
-        }
-            break;
-        case 0x50: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if (!(reg_ps & 0x40)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+                NEXT;
+            OPCODE(0x21): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 6;
             }
-            cycles += 2;
-        }
-            break;
-        case 0x51: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 5;
-        }
-            break;
-        case 0x52: {
-        }
-            break;
-        case 0x53: {
-        }
-            break;
-        case 0x54: {
-        }
-            break;
-        case 0x55: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x56: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 & 0x01);
-            tmp1 >>= 1;
-            reg_ps |= (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x57: {
-        }
-            break;
-        case 0x58: {
-            reg_ps &= 0xFB;
-            cycles += 2;
-        }
-            break;
-        case 0x59: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x5A: {
-        }
-            break;
-        case 0x5B: {
-        }
-            break;
-        case 0x5C: {
-        }
-            break;
-        case 0x5D: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            reg_a ^= _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x5E: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp1 & 0x01);
-            tmp1 >>= 1;
-            reg_ps |= (!tmp1 << 1);
-            _store(addr, tmp1);
-            cycles += 6;
-        }
-            break;
-        case 0x5F: {
-        }
-            break;
-        case 0x60: {
-            reg_pc = load_stack(++reg_sp);
-            reg_pc |= (load_stack(++reg_sp) << 8);
-            reg_pc++;
-            cycles += 6;
-        }
-            break;
-        case 0x61: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 6;
-        }
-            break;
-        case 0x62: {
-        }
-            break;
-        case 0x63: {
-        }
-            break;
-        case 0x64: {
-        }
-            break;
-        case 0x65: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 3;
-        }
-            break;
-        case 0x66: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 & 0x01);
-            _store(addr, tmp2);
-            cycles += 5;
-        }
-            break;
-        case 0x67: {
-        }
-            break;
-        case 0x68: {
-            reg_a = load_stack(++reg_sp);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0x69: {
-            uint16_t addr = reg_pc++;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 2;
-        }
-            break;
-        case 0x6A: {
-            uint8_t tmp1 = reg_a;
-            reg_a = (reg_a >> 1) | ((reg_ps & 0x01) << 7);
-            reg_ps &= 0x7C;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1) | (tmp1 & 0x01);
-            cycles += 2;
-        }
-            break;
-        case 0x6B: {
-        }
-            break;
-        case 0x6C: {
-            uint16_t addr = peek_word(peek_word(reg_pc));
-            reg_pc += 2;
-            reg_pc = addr;
-            cycles += 6;
-        }
-            break;
-        case 0x6D: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0x6E: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 & 0x01);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x6F: {
-        }
-            break;
-        case 0x70: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if ((reg_ps & 0x40)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+                NEXT;
+            OPCODE(0x22): {
             }
-            cycles += 2;
-        }
-            break;
-        case 0x71: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 5;
-        }
-            break;
-        case 0x72: {
-        }
-            break;
-        case 0x73: {
-        }
-            break;
-        case 0x74: {
-        }
-            break;
-        case 0x75: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0x76: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 & 0x01);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x77: {
-        }
-            break;
-        case 0x78: {
-            reg_ps |= 0x04;
-            cycles += 2;
-        }
-            break;
-        case 0x79: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0x7A: {
-        }
-            break;
-        case 0x7B: {
-        }
-            break;
-        case 0x7C: {
-        }
-            break;
-        case 0x7D: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 > 0xFF)
-                      | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0x7E: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 & 0x01);
-            _store(addr, tmp2);
-            cycles += 6;
-        }
-            break;
-        case 0x7F: {
-        }
-            break;
-        case 0x80: {
-        }
-            break;
-        case 0x81: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            _store(addr, reg_a);
-            cycles += 6;
-        }
-            break;
-        case 0x82: {
-        }
-            break;
-        case 0x83: {
-        }
-            break;
-        case 0x84: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            _store(addr, reg_y);
-            cycles += 3;
-        }
-            break;
-        case 0x85: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            _store(addr, reg_a);
-            cycles += 3;
-        }
-            break;
-        case 0x86: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            _store(addr, reg_x);
-            cycles += 3;
-        }
-            break;
-        case 0x87: {
-        }
-            break;
-        case 0x88: {
-            reg_y--;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x89: {
-        }
-            break;
-        case 0x8A: {
-            reg_a = reg_x;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x8B: {
-        }
-            break;
-        case 0x8C: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            _store(addr, reg_y);
-            cycles += 4;
-        }
-            break;
-        case 0x8D: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            _store(addr, reg_a);
-            cycles += 4;
-        }
-            break;
-        case 0x8E: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            _store(addr, reg_x);
-            cycles += 4;
-        }
-            break;
-        case 0x8F: {
-        }
-            break;
-        case 0x90: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if (!(reg_ps & 0x01)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                NEXT;
+            OPCODE(0x23): {
+            }
+                NEXT;
+            OPCODE(0x24): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xBF;
+                reg_ps |= tmp1 & 0x40;
+                flag_n = tmp1;
+                flag_z = reg_a & tmp1;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x25): {
+                uint16_t addr = FETCH_BYTE();
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x26): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x27): {
+            }
+                NEXT;
+            OPCODE(0x28): {
+                reg_ps = load_stack(cpu, ++reg_sp);
+                UNPACK_FLAGS();
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x29): {
+                uint16_t addr = reg_pc++;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x2A): {
+                uint8_t tmp1 = reg_a;
+                reg_a = (reg_a << 1) | (reg_ps & 0x01);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x2B): {
+            }
+                NEXT;
+            OPCODE(0x2C): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xBF;
+                reg_ps |= tmp1 & 0x40;
+                flag_n = tmp1;
+                flag_z = reg_a & tmp1;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x2D): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x2E): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x2F): {
+            }
+                NEXT;
+            OPCODE(0x30): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if ((flag_n & 0x80)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0x31): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x32): {
+            }
+                NEXT;
+            OPCODE(0x33): {
+            }
+                NEXT;
+            OPCODE(0x34): {
+            }
+                NEXT;
+            OPCODE(0x35): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x36): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x37): {
+            }
+                NEXT;
+            OPCODE(0x38): {
+                reg_ps |= 0x01;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x39): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x3A): {
+            }
+                NEXT;
+            OPCODE(0x3B): {
+            }
+                NEXT;
+            OPCODE(0x3C): {
+            }
+                NEXT;
+            OPCODE(0x3D): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                reg_a &= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x3E): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 << 1) | (reg_ps & 0x01);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >> 7);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x3F): {
+            }
+                NEXT;
+            OPCODE(0x40): {
+                reg_ps = load_stack(cpu, ++reg_sp);
+                UNPACK_FLAGS();
+                reg_pc = load_stack(cpu, ++reg_sp);
+                reg_pc |= (load_stack(cpu, ++reg_sp) << 8);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x41): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x42): {
+            }
+                NEXT;
+            OPCODE(0x43): {
+            }
+                NEXT;
+            OPCODE(0x44): {
+            }
+                NEXT;
+            OPCODE(0x45): {
+                uint16_t addr = FETCH_BYTE();
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x46): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                tmp1 >>= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x47): {
+            }
+                NEXT;
+            OPCODE(0x48): {
+                store_stack(cpu, reg_sp--, reg_a);
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x49): {
+                uint16_t addr = reg_pc++;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x4A): {
+                reg_ps &= 0xFE;
+                reg_ps |= reg_a & 0x01;
+                reg_a >>= 1;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x4B): {
+            }
+                NEXT;
+            OPCODE(0x4C): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                cycles += 3;
+                TAKE_BRANCH(addr);
+            }
+                NEXT;
+            OPCODE(0x4D): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x4E): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                tmp1 >>= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x4F): {
+            }
+                NEXT;
+            OPCODE(0x50): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if (!(reg_ps & 0x40)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0x51): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x52): {
+            }
+                NEXT;
+            OPCODE(0x53): {
+            }
+                NEXT;
+            OPCODE(0x54): {
+            }
+                NEXT;
+            OPCODE(0x55): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x56): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                tmp1 >>= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x57): {
+            }
+                NEXT;
+            OPCODE(0x58): {
+                reg_ps &= 0xFB;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x59): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x5A): {
+            }
+                NEXT;
+            OPCODE(0x5B): {
+            }
+                NEXT;
+            OPCODE(0x5C): {
+            }
+                NEXT;
+            OPCODE(0x5D): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                reg_a ^= load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x5E): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                tmp1 >>= 1;
+                flag_n = flag_z = tmp1;
+                STORE(addr, tmp1);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x5F): {
+            }
+                NEXT;
+            OPCODE(0x60): {
+                reg_pc = load_stack(cpu, ++reg_sp);
+                reg_pc |= (load_stack(cpu, ++reg_sp) << 8);
+                reg_pc++;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x61): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x62): {
+            }
+                NEXT;
+            OPCODE(0x63): {
+            }
+                NEXT;
+            OPCODE(0x64): {
+            }
+                NEXT;
+            OPCODE(0x65): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x66): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x67): {
+            }
+                NEXT;
+            OPCODE(0x68): {
+                reg_a = load_stack(cpu, ++reg_sp);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x69): {
+                uint16_t addr = reg_pc++;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x6A): {
+                uint8_t tmp1 = reg_a;
+                reg_a = (reg_a >> 1) | ((reg_ps & 0x01) << 7);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x6B): {
+            }
+                NEXT;
+            OPCODE(0x6C): {
+                uint16_t addr = peek_word(cpu, OPERAND_WORD);
+                reg_pc += 2;
                 reg_pc = addr;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x6D): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x6E): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x6F): {
+            }
+                NEXT;
+            OPCODE(0x70): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if ((reg_ps & 0x40)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0x71): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x72): {
+            }
+                NEXT;
+            OPCODE(0x73): {
+            }
+                NEXT;
+            OPCODE(0x74): {
+            }
+                NEXT;
+            OPCODE(0x75): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x76): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x77): {
+            }
+                NEXT;
+            OPCODE(0x78): {
+                reg_ps |= 0x04;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x79): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x7A): {
+            }
+                NEXT;
+            OPCODE(0x7B): {
+            }
+                NEXT;
+            OPCODE(0x7C): {
+            }
+                NEXT;
+            OPCODE(0x7D): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a + tmp1 + (reg_ps & 0x01);
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 > 0xFF)
+                          | (((reg_a ^ tmp1 ^ 0x80) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x7E): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                uint8_t tmp2 = (tmp1 >> 1) | ((reg_ps & 0x01) << 7);
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 & 0x01);
+                flag_n = flag_z = tmp2;
+                STORE(addr, tmp2);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x7F): {
+            }
+                NEXT;
+            OPCODE(0x80): {
+            }
+                NEXT;
+            OPCODE(0x81): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                STORE(addr, reg_a);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x82): {
+            }
+                NEXT;
+            OPCODE(0x83): {
+            }
+                NEXT;
+            OPCODE(0x84): {
+                uint16_t addr = FETCH_BYTE();
+                STORE(addr, reg_y);
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x85): {
+                uint16_t addr = FETCH_BYTE();
+                STORE(addr, reg_a);
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x86): {
+                uint16_t addr = FETCH_BYTE();
+                STORE(addr, reg_x);
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0x87): {
+            }
+                NEXT;
+            OPCODE(0x88): {
+                reg_y--;
+                flag_n = flag_z = reg_y;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x89): {
+            }
+                NEXT;
+            OPCODE(0x8A): {
+                reg_a = reg_x;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x8B): {
+            }
+                NEXT;
+            OPCODE(0x8C): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                STORE(addr, reg_y);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x8D): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                STORE(addr, reg_a);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x8E): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                STORE(addr, reg_x);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x8F): {
+            }
+                NEXT;
+            OPCODE(0x90): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if (!(reg_ps & 0x01)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0x91): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                addr += reg_y;
+                reg_pc++;
+                STORE(addr, reg_a);
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0x92): {
+            }
+                NEXT;
+            OPCODE(0x93): {
+            }
+                NEXT;
+            OPCODE(0x94): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                STORE(addr, reg_y);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x95): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                STORE(addr, reg_a);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x96): {
+                uint16_t addr = (FETCH_BYTE() + reg_y) & 0xFF;
+                STORE(addr, reg_x);
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0x97): {
+            }
+                NEXT;
+            OPCODE(0x98): {
+                reg_a = reg_y;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x99): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_y;
+                reg_pc += 2;
+                STORE(addr, reg_a);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x9A): {
+                reg_sp = reg_x;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0x9B): {
+            }
+                NEXT;
+            OPCODE(0x9C): {
+            }
+                NEXT;
+            OPCODE(0x9D): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                STORE(addr, reg_a);
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0x9E): {
+            }
+                NEXT;
+            OPCODE(0x9F): {
+            }
+                NEXT;
+            OPCODE(0xA0): {
+                uint16_t addr = reg_pc++;
+                reg_y = load_byte(cpu, addr);
+                flag_n = flag_z = reg_y;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xA1): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xA2): {
+                uint16_t addr = reg_pc++;
+                reg_x = load_byte(cpu, addr);
+                flag_n = flag_z = reg_x;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xA3): {
+            }
+                NEXT;
+            OPCODE(0xA4): {
+                uint16_t addr = FETCH_BYTE();
+                reg_y = load_byte(cpu, addr);
+                flag_n = flag_z = reg_y;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0xA5): {
+                uint16_t addr = FETCH_BYTE();
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0xA6): {
+                uint16_t addr = FETCH_BYTE();
+                reg_x = load_byte(cpu, addr);
+                flag_n = flag_z = reg_x;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0xA7): {
+            }
+                NEXT;
+            OPCODE(0xA8): {
+                reg_y = reg_a;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xA9): {
+                uint16_t addr = reg_pc++;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xAA): {
+                reg_x = reg_a;
+                flag_n = flag_z = reg_a;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xAB): {
+            }
+                NEXT;
+            OPCODE(0xAC): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_y = load_byte(cpu, addr);
+                flag_n = flag_z = reg_y;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xAD): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xAE): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                reg_x = load_byte(cpu, addr);
+                flag_n = flag_z = reg_x;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xAF): {
+            }
+                NEXT;
+            OPCODE(0xB0): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if ((reg_ps & 0x01)) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0xB1): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0xB2): {
+            }
+                NEXT;
+            OPCODE(0xB3): {
+            }
+                NEXT;
+            OPCODE(0xB4): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                reg_y = load_byte(cpu, addr);
+                flag_n = flag_z = reg_y;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xB5): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xB6): {
+                uint16_t addr = (FETCH_BYTE() + reg_y) & 0xFF;
+                reg_x = load_byte(cpu, addr);
+                flag_n = flag_z = reg_x;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xB7): {
+            }
+                NEXT;
+            OPCODE(0xB8): {
+                reg_ps &= 0xBF;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xB9): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xBA): {
+                reg_x = reg_sp;
+                flag_n = flag_z = reg_x;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xBB): {
+            }
+                NEXT;
+            OPCODE(0xBC): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                reg_y = load_byte(cpu, addr);
+                flag_n = flag_z = reg_y;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xBD): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                reg_a = load_byte(cpu, addr);
+                flag_n = flag_z = reg_a;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xBE): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                reg_x = load_byte(cpu, addr);
+                flag_n = flag_z = reg_x;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xBF): {
+            }
+                NEXT;
+            OPCODE(0xC0): {
+                uint16_t addr = reg_pc++;
+                int16_t tmp1 = reg_y - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xC1): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xC2): {
+            }
+                NEXT;
+            OPCODE(0xC3): {
+            }
+                NEXT;
+            OPCODE(0xC4): {
+                uint16_t addr = FETCH_BYTE();
+                int16_t tmp1 = reg_y - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0xC5): {
+                uint16_t addr = FETCH_BYTE();
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 3;
+            }
+                NEXT;
+            OPCODE(0xC6): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr) - 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0xC7): {
+            }
+                NEXT;
+            OPCODE(0xC8): {
+                reg_y++;
+                flag_n = flag_z = reg_y;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xC9): {
+                uint16_t addr = reg_pc++;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xCA): {
+                reg_x--;
+                flag_n = flag_z = reg_x;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xCB): {
+            }
+                NEXT;
+            OPCODE(0xCC): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                int16_t tmp1 = reg_y - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xCD): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xCE): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr) - 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xCF): {
+            }
+                NEXT;
+            OPCODE(0xD0): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if (flag_z) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0xD1): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0xD2): {
+            }
+                NEXT;
+            OPCODE(0xD3): {
+            }
+                NEXT;
+            OPCODE(0xD4): {
+            }
+                NEXT;
+            OPCODE(0xD5): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xD6): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr) - 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xD7): {
+            }
+                NEXT;
+            OPCODE(0xD8): {
+                reg_ps &= 0xF7;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xD9): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xDA): {
+            }
+                NEXT;
+            OPCODE(0xDB): {
+            }
+                NEXT;
+            OPCODE(0xDC): {
+            }
+                NEXT;
+            OPCODE(0xDD): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                int16_t tmp1 = reg_a - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xDE): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr) - 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xDF): {
+            }
+                NEXT;
+            OPCODE(0xE0): {
+                uint16_t addr = reg_pc++;
+                int16_t tmp1 = reg_x - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xE1): {
+                uint16_t addr = peek_word(cpu, (FETCH_BYTE() + reg_x) & 0xFF);
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01u) - 1u;
+                uint8_t tmp3 = tmp2 & 0xFFu;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xE2): {
+            }
+                NEXT;
+            OPCODE(0xE3): {
+            }
+                NEXT;
+            OPCODE(0xE4): {
+                uint16_t addr = FETCH_BYTE();
+                int16_t tmp1 = reg_x - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 3;
             }
-            cycles += 2;
-        }
-            break;
-        case 0x91: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            addr += reg_y;
-            reg_pc++;
-            _store(addr, reg_a);
-            cycles += 6;
-        }
-            break;
-        case 0x92: {
-        }
-            break;
-        case 0x93: {
-        }
-            break;
-        case 0x94: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            _store(addr, reg_y);
-            cycles += 4;
-        }
-            break;
-        case 0x95: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            _store(addr, reg_a);
-            cycles += 4;
-        }
-            break;
-        case 0x96: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_y) & 0xFF;
-            _store(addr, reg_x);
-            cycles += 4;
-        }
-            break;
-        case 0x97: {
-        }
-            break;
-        case 0x98: {
-            reg_a = reg_y;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0x99: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_y;
-            reg_pc += 2;
-            _store(addr, reg_a);
-            cycles += 5;
-        }
-            break;
-        case 0x9A: {
-            reg_sp = reg_x;
-            cycles += 2;
-        }
-            break;
-        case 0x9B: {
-        }
-            break;
-        case 0x9C: {
-        }
-            break;
-        case 0x9D: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            _store(addr, reg_a);
-            cycles += 5;
-        }
-            break;
-        case 0x9E: {
-        }
-            break;
-        case 0x9F: {
-        }
-            break;
-        case 0xA0: {
-            uint16_t addr = reg_pc++;
-            reg_y = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xA1: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xA2: {
-            uint16_t addr = reg_pc++;
-            reg_x = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xA3: {
-        }
-            break;
-        case 0xA4: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_y = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 3;
-        }
-            break;
-        case 0xA5: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 3;
-        }
-            break;
-        case 0xA6: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            reg_x = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 3;
-        }
-            break;
-        case 0xA7: {
-        }
-            break;
-        case 0xA8: {
-            reg_y = reg_a;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xA9: {
-            uint16_t addr = reg_pc++;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xAA: {
-            reg_x = reg_a;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xAB: {
-        }
-            break;
-        case 0xAC: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_y = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xAD: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xAE: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            reg_x = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xAF: {
-        }
-            break;
-        case 0xB0: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if ((reg_ps & 0x01)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+                NEXT;
+            OPCODE(0xE5): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 3;
             }
-            cycles += 2;
-        }
-            break;
-        case 0xB1: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 5;
-        }
-            break;
-        case 0xB2: {
-        }
-            break;
-        case 0xB3: {
-        }
-            break;
-        case 0xB4: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            reg_y = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xB5: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xB6: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_y) & 0xFF;
-            reg_x = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xB7: {
-        }
-            break;
-        case 0xB8: {
-            reg_ps &= 0xBF;
-            cycles += 2;
-        }
-            break;
-        case 0xB9: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xBA: {
-            reg_x = reg_sp;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xBB: {
-        }
-            break;
-        case 0xBC: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            reg_y = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xBD: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            reg_a = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_a & 0x80) | (!reg_a << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xBE: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            reg_x = _load(addr);
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 4;
-        }
-            break;
-        case 0xBF: {
-        }
-            break;
-        case 0xC0: {
-            uint16_t addr = reg_pc++;
-            int16_t tmp1 = reg_y - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 2;
-        }
-            break;
-        case 0xC1: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 6;
-        }
-            break;
-        case 0xC2: {
-        }
-            break;
-        case 0xC3: {
-        }
-            break;
-        case 0xC4: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            int16_t tmp1 = reg_y - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 3;
-        }
-            break;
-        case 0xC5: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 3;
-        }
-            break;
-        case 0xC6: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr) - 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 5;
-        }
-            break;
-        case 0xC7: {
-        }
-            break;
-        case 0xC8: {
-            reg_y++;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_y & 0x80) | (!reg_y << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xC9: {
-            uint16_t addr = reg_pc++;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 2;
-        }
-            break;
-        case 0xCA: {
-            reg_x--;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xCB: {
-        }
-            break;
-        case 0xCC: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            int16_t tmp1 = reg_y - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xCD: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xCE: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr) - 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xCF: {
-        }
-            break;
-        case 0xD0: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if (!(reg_ps & 0x02)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+                NEXT;
+            OPCODE(0xE6): {
+                uint16_t addr = FETCH_BYTE();
+                uint8_t tmp1 = load_byte(cpu, addr) + 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 5;
             }
-            cycles += 2;
-        }
-            break;
-        case 0xD1: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 5;
-        }
-            break;
-        case 0xD2: {
-        }
-            break;
-        case 0xD3: {
-        }
-            break;
-        case 0xD4: {
-        }
-            break;
-        case 0xD5: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xD6: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr) - 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xD7: {
-        }
-            break;
-        case 0xD8: {
-            reg_ps &= 0xF7;
-            cycles += 2;
-        }
-            break;
-        case 0xD9: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xDA: {
-        }
-            break;
-        case 0xDB: {
-        }
-            break;
-        case 0xDC: {
-        }
-            break;
-        case 0xDD: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            int16_t tmp1 = reg_a - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xDE: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr) - 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xDF: {
-        }
-            break;
-        case 0xE0: {
-            uint16_t addr = reg_pc++;
-            int16_t tmp1 = reg_x - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 2;
-        }
-            break;
-        case 0xE1: {
-            uint16_t addr = peek_word((_peek_byte(reg_pc++) + reg_x) & 0xFF);
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01u) - 1u;
-            uint8_t tmp3 = tmp2 & 0xFFu;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 6;
-        }
-            break;
-        case 0xE2: {
-        }
-            break;
-        case 0xE3: {
-        }
-            break;
-        case 0xE4: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            int16_t tmp1 = reg_x - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 3;
-        }
-            break;
-        case 0xE5: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 3;
-        }
-            break;
-        case 0xE6: {
-            uint16_t addr = _peek_byte(reg_pc++);
-            uint8_t tmp1 = _load(addr) + 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 5;
-        }
-            break;
-        case 0xE7: {
-        }
-            break;
-        case 0xE8: {
-            reg_x++;
-            reg_ps &= 0x7D;
-            reg_ps |= (reg_x & 0x80) | (!reg_x << 1);
-            cycles += 2;
-        }
-            break;
-        case 0xE9: {
-            uint16_t addr = reg_pc++;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 2;
-        }
-            break;
-        case 0xEA: {
-            cycles += 2;
-        }
-            break;
-        case 0xEB: {
-        }
-            break;
-        case 0xEC: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            int16_t tmp1 = reg_x - _load(addr);
-            uint8_t tmp2 = tmp1 & 0xFF;
-            reg_ps &= 0x7C;
-            reg_ps |= (tmp2 & 0x80) | (!tmp2 << 1) | (tmp1 >= 0);
-            cycles += 4;
-        }
-            break;
-        case 0xED: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0xEE: {
-            uint16_t addr = peek_word(reg_pc);
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr) + 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xEF: {
-        }
-            break;
-        case 0xF0: {
-            int8_t tmp4 = (int8_t) (_peek_byte(reg_pc++));
-            uint16_t addr = reg_pc + tmp4;
-            if ((reg_ps & 0x02)) {
-                cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
-                reg_pc = addr;
+                NEXT;
+            OPCODE(0xE7): {
             }
-            cycles += 2;
-        }
-            break;
-        case 0xF1: {
-            uint16_t addr = peek_word(_peek_byte(reg_pc));
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc++;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 5;
-        }
-            break;
-        case 0xF2: {
-        }
-            break;
-        case 0xF3: {
-        }
-            break;
-        case 0xF4: {
-        }
-            break;
-        case 0xF5: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0xF6: {
-            uint16_t addr = (_peek_byte(reg_pc++) + reg_x) & 0xFF;
-            uint8_t tmp1 = _load(addr) + 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
-        }
-            break;
-        case 0xF7: {
-        }
-            break;
-        case 0xF8: {
-            reg_ps |= 0x08;
-            cycles += 2;
-        }
-            break;
-        case 0xF9: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
-            addr += reg_y;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0xFA: {
-        }
-            break;
-        case 0xFB: {
-        }
-            break;
-        case 0xFC: {
-        }
-            break;
-        case 0xFD: {
-            uint16_t addr = peek_word(reg_pc);
-            cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr);
-            int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
-            uint8_t tmp3 = tmp2 & 0xFF;
-            reg_ps &= 0x3C;
-            reg_ps |= (tmp3 & 0x80) | (!tmp3 << 1) | (tmp2 >= 0)
-                      | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
-            reg_a = tmp3;
-            cycles += 4;
-        }
-            break;
-        case 0xFE: {
-            uint16_t addr = peek_word(reg_pc);
-            addr += reg_x;
-            reg_pc += 2;
-            uint8_t tmp1 = _load(addr) + 1;
-            _store(addr, tmp1);
-            reg_ps &= 0x7D;
-            reg_ps |= (tmp1 & 0x80) | (!tmp1 << 1);
-            cycles += 6;
+                NEXT;
+            OPCODE(0xE8): {
+                reg_x++;
+                flag_n = flag_z = reg_x;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xE9): {
+                uint16_t addr = reg_pc++;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xEA): {
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xEB): {
+            }
+                NEXT;
+            OPCODE(0xEC): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                int16_t tmp1 = reg_x - load_byte(cpu, addr);
+                uint8_t tmp2 = tmp1 & 0xFF;
+                reg_ps &= 0xFE;
+                reg_ps |= (tmp1 >= 0);
+                flag_n = flag_z = tmp2;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xED): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xEE): {
+                uint16_t addr = OPERAND_WORD;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr) + 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xEF): {
+            }
+                NEXT;
+            OPCODE(0xF0): {
+                int8_t tmp4 = (int8_t) (FETCH_BYTE());
+                uint16_t addr = reg_pc + tmp4;
+                cycles += 2;
+                if (!flag_z) {
+                    cycles += !((reg_pc ^ addr) & 0xFF00) << 1;
+                    TAKE_BRANCH(addr);
+                }
+            }
+                NEXT;
+            OPCODE(0xF1): {
+                uint16_t addr = peek_word(cpu, OPERAND_BYTE);
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc++;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 5;
+            }
+                NEXT;
+            OPCODE(0xF2): {
+            }
+                NEXT;
+            OPCODE(0xF3): {
+            }
+                NEXT;
+            OPCODE(0xF4): {
+            }
+                NEXT;
+            OPCODE(0xF5): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xF6): {
+                uint16_t addr = (FETCH_BYTE() + reg_x) & 0xFF;
+                uint8_t tmp1 = load_byte(cpu, addr) + 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xF7): {
+            }
+                NEXT;
+            OPCODE(0xF8): {
+                reg_ps |= 0x08;
+                cycles += 2;
+            }
+                NEXT;
+            OPCODE(0xF9): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_y) & 0xFF00);
+                addr += reg_y;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xFA): {
+            }
+                NEXT;
+            OPCODE(0xFB): {
+            }
+                NEXT;
+            OPCODE(0xFC): {
+            }
+                NEXT;
+            OPCODE(0xFD): {
+                uint16_t addr = OPERAND_WORD;
+                cycles += !!(((addr & 0xFF) + reg_x) & 0xFF00);
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr);
+                int16_t tmp2 = reg_a - tmp1 + (reg_ps & 0x01) - 1;
+                uint8_t tmp3 = tmp2 & 0xFF;
+                reg_ps &= 0xBE;
+                reg_ps |= (tmp2 >= 0)
+                          | (((reg_a ^ tmp1) & (reg_a ^ tmp3) & 0x80) >> 1);
+                flag_n = flag_z = tmp3;
+                reg_a = tmp3;
+                cycles += 4;
+            }
+                NEXT;
+            OPCODE(0xFE): {
+                uint16_t addr = OPERAND_WORD;
+                addr += reg_x;
+                reg_pc += 2;
+                uint8_t tmp1 = load_byte(cpu, addr) + 1;
+                STORE(addr, tmp1);
+                flag_n = flag_z = tmp1;
+                cycles += 6;
+            }
+                NEXT;
+            OPCODE(0xFF): {
+            }
+                NEXT;
         }
-            break;
-        case 0xFF: {
+    } while (cycles < cycle_budget);
+
+#ifdef CPU6502_PROFILE
+    cpu -> profile_cycles += (uint32_t) (cycles - profiled_cycles);
+#endif
+#ifdef CPU6502_TRACE
+    if (trace) {
+        trace -> cycles += cycles;
+        atomic_store_explicit(&trace -> head, trace_head, memory_order_release);
+        if (trace -> mapping) {
+            trace -> mapping -> head = trace_head;
         }
-            break;
     }
-
+#endif
+#ifdef CPU6502_STATS
+    if (cpu -> stats && stats_opcode >= 0) {
+        count_6502_cycles(cpu -> stats, (uint8_t) stats_opcode, cycles - stats_cycles);
+    }
+#endif
     cpu_states -> reg_pc = reg_pc;
     cpu_states -> reg_a = reg_a;
+    PACK_FLAGS();
     cpu_states -> reg_ps = reg_ps;
     cpu_states -> reg_x = reg_x;
     cpu_states -> reg_y = reg_y;
@@ -1786,3 +2460,10 @@ uint64_t execute_6502(cpu_states_t *cpu_states) {
 
     return cycles;
 }
+
+/**
+ * @return cycles for the execution of a single instruction
+ */
+uint64_t execute_6502(cpu6502_t *cpu, cpu_states_t *cpu_states) {
+    return execute_6502_until(cpu, cpu_states, 0);
+}
@@ -6,6 +6,7 @@
 #define NC1020_CPU6502_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef struct {
     uint16_t reg_pc;
@@ -16,12 +17,83 @@ typedef struct {
     uint8_t reg_sp;
 } cpu_states_t;
 
-void init_6502(uint8_t (*Peek_func)(uint16_t addr),
-               uint8_t (*Load_func)(uint16_t addr),
-               void (*Store_func)(uint16_t addr, uint8_t value));
+// flags of the 8K pages in the memmap, pages without them go through the callbacks.
+#define PAGE_DIRECT_READ 0x01u
+#define PAGE_DIRECT_WRITE 0x02u
+// rom/nor code that only changes through invalidate_6502_code, decoded code is cached.
+#define PAGE_CODE_CACHE 0x04u
 
-uint64_t execute_6502(cpu_states_t *cpu_states);
+// the core with its callbacks and code cache, one per emulated machine.
+typedef struct cpu6502 cpu6502_t;
 
-uint64_t do_irq(cpu_states_t *cpu_states);
+// the callbacks get the context back, the memmap and page flags are read in place.
+cpu6502_t *create_6502(uint8_t (*Load_func)(void *context, uint16_t addr),
+                       void (*Store_func)(void *context, uint16_t addr, uint8_t value),
+                       void *context,
+                       uint8_t *memmap[8],
+                       const uint8_t page_flags[8]);
+
+void destroy_6502(cpu6502_t *cpu);
+
+uint64_t execute_6502(cpu6502_t *cpu, cpu_states_t *cpu_states);
+
+uint64_t execute_6502_until(cpu6502_t *cpu, cpu_states_t *cpu_states, uint64_t cycle_budget);
+
+uint64_t do_irq(cpu6502_t *cpu, cpu_states_t *cpu_states);
+
+void invalidate_6502_code(cpu6502_t *cpu, const uint8_t *code, uint32_t size);
+
+// must be called whenever the memmap changes.
+void remap_6502(cpu6502_t *cpu);
+
+// loads with side effects must call this, loops around them are never skipped as idle.
+void mark_6502_side_effect(cpu6502_t *cpu);
+
+// for a store callback that halts the cpu: the run ends after the storing instruction.
+void stop_6502(cpu6502_t *cpu);
+
+// false runs everything through the plain interpreter, to test it against the block cache.
+void set_6502_translation(cpu6502_t *cpu, bool enabled);
+
+#ifdef CPU6502_STATS
+#include <stddef.h>
+#include <stdio.h>
+
+#define CPU6502_STATS_CYCLES 8
+
+// what the cpu ran while the stats were set, idle loops it skipped aren't instructions.
+typedef struct {
+    uint64_t opcodes[0x100];
+    // executions of each opcode by the cycles they took, longer ones in the last column.
+    uint64_t opcode_cycles[0x100][CPU6502_STATS_CYCLES];
+    // consecutive opcodes, first << 8 | second.
+    uint64_t pairs[0x10000];
+    uint64_t idle_cycles;
+} cpu6502_stats_t;
+
+// NULL stops counting.
+void set_6502_stats(cpu6502_t *cpu, cpu6502_stats_t *stats);
+
+// the counts as csv, per opcode, per addressing mode and the pair_limit most frequent pairs.
+void write_6502_opcode_stats(const cpu6502_stats_t *stats, FILE *file);
+void write_6502_mode_stats(const cpu6502_stats_t *stats, FILE *file);
+void write_6502_pair_stats(const cpu6502_stats_t *stats, FILE *file, size_t pair_limit);
+#endif
+
+#ifdef CPU6502_TRACE
+#include "cpu6502_trace.h"
+
+// bank and volume point at the bank registers of the machine, recorded with every
+// instruction. NULL stops tracing.
+void set_6502_trace(cpu6502_t *cpu, cpu6502_trace_t *trace, const uint8_t *bank, const uint8_t *volume);
+#endif
+
+#ifdef CPU6502_PROFILE
+// profile is called before every instruction with its pc and the cycles since the previous
+// call, which belong to the previous instruction. Interrupt entry is not counted. NULL stops.
+// Idle loops aren't skipped while it is set, every pass is profiled.
+void set_6502_profiler(cpu6502_t *cpu, void (*profile)(void *context, uint16_t pc, uint32_t cycles),
+                       void *context);
+#endif
 
 #endif //NC1020_CPU6502_H
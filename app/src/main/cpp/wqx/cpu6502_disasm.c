@@ -0,0 +1,142 @@
+#include "cpu6502_disasm.h"
+#include <stdio.h>
+
+static const char *const MODE_NAMES[CPU6502_MODE_COUNT] = {
+        "imp", "acc", "imm", "zp", "zpx", "zpy", "abs", "absx", "absy", "ind", "indx", "indy", "rel", "none"
+};
+
+static const char *const MNEMONICS[0x100] = {
+        "BRK", "ORA", "???", "???", "???", "ORA", "ASL", "???",
+        "PHP", "ORA", "ASL", "???", "???", "ORA", "ASL", "???",
+        "BPL", "ORA", "???", "???", "???", "ORA", "ASL", "???",
+        "CLC", "ORA", "???", "???", "???", "ORA", "ASL", "???",
+        "JSR", "AND", "???", "???", "BIT", "AND", "ROL", "???",
+        "PLP", "AND", "ROL", "???", "BIT", "AND", "ROL", "???",
+        "BMI", "AND", "???", "???", "???", "AND", "ROL", "???",
+        "SEC", "AND", "???", "???", "???", "AND", "ROL", "???",
+        "RTI", "EOR", "???", "???", "???", "EOR", "LSR", "???",
+        "PHA", "EOR", "LSR", "???", "JMP", "EOR", "LSR", "???",
+        "BVC", "EOR", "???", "???", "???", "EOR", "LSR", "???",
+        "CLI", "EOR", "???", "???", "???", "EOR", "LSR", "???",
+        "RTS", "ADC", "???", "???", "???", "ADC", "ROR", "???",
+        "PLA", "ADC", "ROR", "???", "JMP", "ADC", "ROR", "???",
+        "BVS", "ADC", "???", "???", "???", "ADC", "ROR", "???",
+        "SEI", "ADC", "???", "???", "???", "ADC", "ROR", "???",
+        "???", "STA", "???", "???", "STY", "STA", "STX", "???",
+        "DEY", "???", "TXA", "???", "STY", "STA", "STX", "???",
+        "BCC", "STA", "???", "???", "STY", "STA", "STX", "???",
+        "TYA", "STA", "TXS", "???", "???", "STA", "???", "???",
+        "LDY", "LDA", "LDX", "???", "LDY", "LDA", "LDX", "???",
+        "TAY", "LDA", "TAX", "???", "LDY", "LDA", "LDX", "???",
+        "BCS", "LDA", "???", "???", "LDY", "LDA", "LDX", "???",
+        "CLV", "LDA", "TSX", "???", "LDY", "LDA", "LDX", "???",
+        "CPY", "CMP", "???", "???", "CPY", "CMP", "DEC", "???",
+        "INY", "CMP", "DEX", "???", "CPY", "CMP", "DEC", "???",
+        "BNE", "CMP", "???", "???", "???", "CMP", "DEC", "???",
+        "CLD", "CMP", "???", "???", "???", "CMP", "DEC", "???",
+        "CPX", "SBC", "???", "???", "CPX", "SBC", "INC", "???",
+        "INX", "SBC", "NOP", "???", "CPX", "SBC", "INC", "???",
+        "BEQ", "SBC", "???", "???", "???", "SBC", "INC", "???",
+        "SED", "SBC", "???", "???", "???", "SBC", "INC", "???",
+};
+
+static const uint8_t MODES[0x100] = {
+        CPU6502_MODE_IMP, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_ACC, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_ACC, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_ACC, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_ACC, CPU6502_MODE_NONE,
+        CPU6502_MODE_IND, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_NONE, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_ZPY, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMM, CPU6502_MODE_INDX, CPU6502_MODE_IMM, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_ZPY, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_ABSY, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMM, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMM, CPU6502_MODE_INDX, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_ZP, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_IMM, CPU6502_MODE_IMP, CPU6502_MODE_NONE,
+        CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_ABS, CPU6502_MODE_NONE,
+        CPU6502_MODE_REL, CPU6502_MODE_INDY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ZPX, CPU6502_MODE_ZPX, CPU6502_MODE_NONE,
+        CPU6502_MODE_IMP, CPU6502_MODE_ABSY, CPU6502_MODE_NONE, CPU6502_MODE_NONE,
+        CPU6502_MODE_NONE, CPU6502_MODE_ABSX, CPU6502_MODE_ABSX, CPU6502_MODE_NONE,
+};
+
+const char *get_6502_mnemonic(uint8_t opcode) {
+    return MNEMONICS[opcode];
+}
+
+cpu6502_mode_t get_6502_mode(uint8_t opcode) {
+    return (cpu6502_mode_t) MODES[opcode];
+}
+
+const char *get_6502_mode_name(cpu6502_mode_t mode) {
+    return MODE_NAMES[mode];
+}
+
+void format_6502_inst(char *text, size_t size, uint16_t pc, uint8_t opcode, uint16_t operand) {
+    const char *mnemonic = MNEMONICS[opcode];
+    uint8_t byte = (uint8_t) operand;
+    switch (MODES[opcode]) {
+        case CPU6502_MODE_ACC: snprintf(text, size, "%s A", mnemonic); break;
+        case CPU6502_MODE_IMM: snprintf(text, size, "%s #$%02X", mnemonic, byte); break;
+        case CPU6502_MODE_ZP: snprintf(text, size, "%s $%02X", mnemonic, byte); break;
+        case CPU6502_MODE_ZPX: snprintf(text, size, "%s $%02X,X", mnemonic, byte); break;
+        case CPU6502_MODE_ZPY: snprintf(text, size, "%s $%02X,Y", mnemonic, byte); break;
+        case CPU6502_MODE_ABS: snprintf(text, size, "%s $%04X", mnemonic, operand); break;
+        case CPU6502_MODE_ABSX: snprintf(text, size, "%s $%04X,X", mnemonic, operand); break;
+        case CPU6502_MODE_ABSY: snprintf(text, size, "%s $%04X,Y", mnemonic, operand); break;
+        case CPU6502_MODE_IND: snprintf(text, size, "%s ($%04X)", mnemonic, operand); break;
+        case CPU6502_MODE_INDX: snprintf(text, size, "%s ($%02X,X)", mnemonic, byte); break;
+        case CPU6502_MODE_INDY: snprintf(text, size, "%s ($%02X),Y", mnemonic, byte); break;
+        case CPU6502_MODE_REL:
+            snprintf(text, size, "%s $%04X", mnemonic, (uint16_t) (pc + 2 + (int8_t) byte));
+            break;
+        default: snprintf(text, size, "%s", mnemonic); break;
+    }
+}
@@ -0,0 +1,37 @@
+//
+// Names and addressing modes of the 6502 opcodes, for the tools.
+//
+
+#ifndef NC1020_CPU6502_DISASM_H
+#define NC1020_CPU6502_DISASM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    CPU6502_MODE_IMP,
+    CPU6502_MODE_ACC,
+    CPU6502_MODE_IMM,
+    CPU6502_MODE_ZP,
+    CPU6502_MODE_ZPX,
+    CPU6502_MODE_ZPY,
+    CPU6502_MODE_ABS,
+    CPU6502_MODE_ABSX,
+    CPU6502_MODE_ABSY,
+    CPU6502_MODE_IND,
+    CPU6502_MODE_INDX,
+    CPU6502_MODE_INDY,
+    CPU6502_MODE_REL,
+    // opcodes the core doesn't implement, they do nothing.
+    CPU6502_MODE_NONE,
+    CPU6502_MODE_COUNT
+} cpu6502_mode_t;
+
+const char *get_6502_mnemonic(uint8_t opcode);
+cpu6502_mode_t get_6502_mode(uint8_t opcode);
+const char *get_6502_mode_name(cpu6502_mode_t mode);
+
+// the instruction at pc as assembly, like "LDA $1234,X", operand as decoded by the core.
+void format_6502_inst(char *text, size_t size, uint16_t pc, uint8_t opcode, uint16_t operand);
+
+#endif //NC1020_CPU6502_DISASM_H
@@ -0,0 +1,115 @@
+//
+// Csv export of the instruction counts of builds with CPU6502_STATS.
+//
+#include "cpu6502.h"
+#include "cpu6502_disasm.h"
+
+#ifdef CPU6502_STATS
+
+#include <stdlib.h>
+#include <inttypes.h>
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    // executions that took longer than the fewest cycles seen: page crossings, taken branches.
+    uint64_t extra_count;
+    uint64_t extra_cycles;
+} cycle_summary_t;
+
+static cycle_summary_t summarize_cycles(const uint64_t counts[CPU6502_STATS_CYCLES]) {
+    cycle_summary_t summary = {0, 0, 0, 0};
+    int min_cycles = -1;
+    for (int i = 0; i < CPU6502_STATS_CYCLES; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        if (min_cycles < 0) {
+            min_cycles = i;
+        } else {
+            summary.extra_count += counts[i];
+            summary.extra_cycles += counts[i] * (uint64_t) (i - min_cycles);
+        }
+        summary.count += counts[i];
+        summary.cycles += counts[i] * (uint64_t) i;
+    }
+    return summary;
+}
+
+void write_6502_opcode_stats(const cpu6502_stats_t *stats, FILE *file) {
+    fprintf(file, "opcode,mnemonic,mode,count,cycles,extra_count,extra_cycles");
+    for (int i = 0; i < CPU6502_STATS_CYCLES; i++) {
+        fprintf(file, i == CPU6502_STATS_CYCLES - 1 ? ",cycles_%d_plus" : ",cycles_%d", i);
+    }
+    fprintf(file, "\n");
+    for (int opcode = 0; opcode < 0x100; opcode++) {
+        if (stats -> opcodes[opcode] == 0) {
+            continue;
+        }
+        cycle_summary_t summary = summarize_cycles(stats -> opcode_cycles[opcode]);
+        fprintf(file, "0x%02X,%s,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+                opcode, get_6502_mnemonic((uint8_t) opcode), get_6502_mode_name(get_6502_mode((uint8_t) opcode)),
+                stats -> opcodes[opcode],
+                summary.cycles, summary.extra_count, summary.extra_cycles);
+        for (int i = 0; i < CPU6502_STATS_CYCLES; i++) {
+            fprintf(file, ",%" PRIu64, stats -> opcode_cycles[opcode][i]);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+void write_6502_mode_stats(const cpu6502_stats_t *stats, FILE *file) {
+    cycle_summary_t modes[CPU6502_MODE_COUNT] = {{0, 0, 0, 0}};
+    for (int opcode = 0; opcode < 0x100; opcode++) {
+        cycle_summary_t summary = summarize_cycles(stats -> opcode_cycles[opcode]);
+        cycle_summary_t *mode = &modes[get_6502_mode((uint8_t) opcode)];
+        mode -> count += stats -> opcodes[opcode];
+        mode -> cycles += summary.cycles;
+        mode -> extra_count += summary.extra_count;
+        mode -> extra_cycles += summary.extra_cycles;
+    }
+    fprintf(file, "mode,count,cycles,extra_count,extra_cycles\n");
+    for (int i = 0; i < CPU6502_MODE_COUNT; i++) {
+        if (modes[i].count) {
+            fprintf(file, "%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", get_6502_mode_name((cpu6502_mode_t) i),
+                    modes[i].count, modes[i].cycles, modes[i].extra_count, modes[i].extra_cycles);
+        }
+    }
+}
+
+typedef struct {
+    uint32_t pair;
+    uint64_t count;
+} pair_count_t;
+
+static int compare_pairs(const void *a, const void *b) {
+    const pair_count_t *pair_a = (const pair_count_t*) a;
+    const pair_count_t *pair_b = (const pair_count_t*) b;
+    if (pair_a -> count != pair_b -> count) {
+        return pair_a -> count > pair_b -> count ? -1 : 1;
+    }
+    return pair_a -> pair < pair_b -> pair ? -1 : 1;
+}
+
+void write_6502_pair_stats(const cpu6502_stats_t *stats, FILE *file, size_t pair_limit) {
+    pair_count_t *pairs = (pair_count_t*) malloc(0x10000 * sizeof(pair_count_t));
+    size_t count = 0;
+    for (uint32_t pair = 0; pair < 0x10000; pair++) {
+        if (stats -> pairs[pair]) {
+            pairs[count].pair = pair;
+            pairs[count].count = stats -> pairs[pair];
+            count++;
+        }
+    }
+    qsort(pairs, count, sizeof(pair_count_t), compare_pairs);
+    fprintf(file, "first,first_mnemonic,second,second_mnemonic,count\n");
+    for (size_t i = 0; i < count && i < pair_limit; i++) {
+        uint8_t first = (uint8_t) (pairs[i].pair >> 8u);
+        uint8_t second = (uint8_t) pairs[i].pair;
+        fprintf(file, "0x%02X,%s,0x%02X,%s,%" PRIu64 "\n", first, get_6502_mnemonic(first),
+                second, get_6502_mnemonic(second), pairs[i].count);
+    }
+    free(pairs);
+}
+
+#endif
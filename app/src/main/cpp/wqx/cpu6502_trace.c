@@ -0,0 +1,147 @@
+#include "cpu6502_trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// how long the writer sleeps when the ring is empty.
+static const long WRITER_IDLE_NS = 1000000;
+
+static uint64_t ring_capacity(uint32_t capacity) {
+    uint64_t size = 1;
+    while (size < capacity) {
+        size <<= 1u;
+    }
+    return size;
+}
+
+static void init_header(cpu6502_trace_header_t *header, uint64_t capacity) {
+    memset(header, 0, sizeof(cpu6502_trace_header_t));
+    memcpy(header -> magic, CPU6502_TRACE_MAGIC, sizeof(header -> magic));
+    header -> version = CPU6502_TRACE_VERSION;
+    header -> record_size = sizeof(cpu6502_trace_record_t);
+    header -> capacity = capacity;
+}
+
+cpu6502_trace_t *create_6502_trace(uint32_t capacity) {
+    cpu6502_trace_t *trace = (cpu6502_trace_t*) calloc(1, sizeof(cpu6502_trace_t));
+    uint64_t size = ring_capacity(capacity);
+    trace -> records = (cpu6502_trace_record_t*) calloc(size, sizeof(cpu6502_trace_record_t));
+    if (trace -> records == NULL) {
+        free(trace);
+        return NULL;
+    }
+    trace -> mask = size - 1;
+    trace -> overwrite = true;
+    return trace;
+}
+
+cpu6502_trace_t *map_6502_trace(const char *file_path, uint32_t capacity) {
+    uint64_t size = ring_capacity(capacity);
+    size_t mapping_size = sizeof(cpu6502_trace_header_t) + size * sizeof(cpu6502_trace_record_t);
+    int fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t) mapping_size) != 0) {
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    cpu6502_trace_t *trace = (cpu6502_trace_t*) calloc(1, sizeof(cpu6502_trace_t));
+    trace -> mapping = (cpu6502_trace_header_t*) mapping;
+    trace -> mapping_size = mapping_size;
+    init_header(trace -> mapping, size);
+    trace -> records = (cpu6502_trace_record_t*) (trace -> mapping + 1);
+    trace -> mask = size - 1;
+    trace -> overwrite = true;
+    return trace;
+}
+
+static void *run_trace_writer(void *arg) {
+    cpu6502_trace_t *trace = (cpu6502_trace_t*) arg;
+    uint64_t tail = atomic_load_explicit(&trace -> tail, memory_order_relaxed);
+    for (;;) {
+        bool stopping = atomic_load_explicit(&trace -> stopping, memory_order_acquire);
+        uint64_t head = atomic_load_explicit(&trace -> head, memory_order_acquire);
+        if (head == tail) {
+            if (stopping) {
+                break;
+            }
+            struct timespec idle = {0, WRITER_IDLE_NS};
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        // up to the end of the ring, the rest goes in the next chunk.
+        uint64_t start = tail & trace -> mask;
+        uint64_t count = head - tail;
+        if (start + count > trace -> mask + 1) {
+            count = trace -> mask + 1 - start;
+        }
+        cpu6502_trace_chunk_t chunk;
+        chunk.count = (uint32_t) count;
+        chunk.dropped = (uint32_t) atomic_exchange_explicit(&trace -> dropped, 0, memory_order_relaxed);
+        fwrite(&chunk, sizeof(chunk), 1, trace -> stream);
+        fwrite(&trace -> records[start], sizeof(cpu6502_trace_record_t), count, trace -> stream);
+        tail += count;
+        atomic_store_explicit(&trace -> tail, tail, memory_order_release);
+    }
+    fflush(trace -> stream);
+    return NULL;
+}
+
+bool stream_6502_trace(cpu6502_trace_t *trace, const char *file_path) {
+    if (trace -> mapping || trace -> stream) {
+        return false;
+    }
+    trace -> stream = fopen(file_path, "wbe");
+    if (trace -> stream == NULL) {
+        return false;
+    }
+    cpu6502_trace_header_t header;
+    init_header(&header, 0);
+    fwrite(&header, sizeof(header), 1, trace -> stream);
+    trace -> overwrite = false;
+    atomic_store(&trace -> stopping, false);
+    if (pthread_create(&trace -> writer, NULL, run_trace_writer, trace) != 0) {
+        fclose(trace -> stream);
+        trace -> stream = NULL;
+        trace -> overwrite = true;
+        return false;
+    }
+    return true;
+}
+
+bool save_6502_trace(cpu6502_trace_t *trace, const char *file_path) {
+    FILE *file = fopen(file_path, "wbe");
+    if (file == NULL) {
+        return false;
+    }
+    cpu6502_trace_header_t header;
+    init_header(&header, trace -> mask + 1);
+    header.head = atomic_load_explicit(&trace -> head, memory_order_acquire);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(trace -> records, sizeof(cpu6502_trace_record_t), trace -> mask + 1, file);
+    fclose(file);
+    return true;
+}
+
+void destroy_6502_trace(cpu6502_trace_t *trace) {
+    if (trace -> stream) {
+        atomic_store_explicit(&trace -> stopping, true, memory_order_release);
+        pthread_join(trace -> writer, NULL);
+        fclose(trace -> stream);
+    }
+    if (trace -> mapping) {
+        munmap(trace -> mapping, trace -> mapping_size);
+    } else {
+        free(trace -> records);
+    }
+    free(trace);
+}
@@ -0,0 +1,96 @@
+//
+// Execution trace. In builds with CPU6502_TRACE the core appends a record for every
+// instruction to a ring, which either lives in memory, streamed to a file by a writer
+// thread, or in a mapped file that keeps the last records even if the process dies.
+//
+
+#ifndef NC1020_CPU6502_TRACE_H
+#define NC1020_CPU6502_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <pthread.h>
+
+// the state before the instruction ran.
+typedef struct {
+    // low bits of the cpu cycles since the trace started.
+    uint32_t cycles;
+    uint16_t pc;
+    uint16_t operand;
+    uint8_t opcode;
+    // the bank registers of the machine.
+    uint8_t bank;
+    uint8_t volume;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_ps;
+    uint8_t reg_sp;
+} cpu6502_trace_record_t;
+
+#define CPU6502_TRACE_MAGIC "NC1020TR"
+#define CPU6502_TRACE_VERSION 1
+
+/*
+ * Both kinds of trace files start with the header. A ring file is followed by the
+ * ring, a stream by chunks, each a chunk header and its records.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    // records in the ring of a ring file, 0 for a stream.
+    uint64_t capacity;
+    // records written to the ring so far, the newest is at (head - 1) % capacity.
+    uint64_t head;
+} cpu6502_trace_header_t;
+
+typedef struct {
+    uint32_t count;
+    // records lost after the start of this chunk because the writer fell behind.
+    uint32_t dropped;
+} cpu6502_trace_chunk_t;
+
+typedef struct cpu6502_trace {
+    cpu6502_trace_record_t *records;
+    uint64_t mask;
+    // a full ring overwrites its oldest records unless a writer drains it.
+    bool overwrite;
+    // published by the cpu at the end of every run.
+    _Atomic uint64_t head;
+    // advanced by the writer.
+    _Atomic uint64_t tail;
+    _Atomic uint64_t dropped;
+    uint64_t cycles;
+
+    // the header of a ring file, the cpu keeps its head up to date.
+    cpu6502_trace_header_t *mapping;
+    size_t mapping_size;
+
+    FILE *stream;
+    pthread_t writer;
+    _Atomic bool stopping;
+} cpu6502_trace_t;
+
+// a ring of at least capacity records in memory, see save_6502_trace.
+cpu6502_trace_t *create_6502_trace(uint32_t capacity);
+
+// a ring of at least capacity records in a mapped file, NULL if it can't be created.
+cpu6502_trace_t *map_6502_trace(const char *file_path, uint32_t capacity);
+
+/**
+ * Stream the records of a memory ring to a file from a writer thread, the cpu never
+ * waits for it but drops records when the ring is full. Start it before the ring is used.
+ * @return false if the file can't be created.
+ */
+bool stream_6502_trace(cpu6502_trace_t *trace, const char *file_path);
+
+// the records in a memory ring as a ring file.
+bool save_6502_trace(cpu6502_trace_t *trace, const char *file_path);
+
+// stops the writer once it has written everything.
+void destroy_6502_trace(cpu6502_trace_t *trace);
+
+#endif //NC1020_CPU6502_TRACE_H
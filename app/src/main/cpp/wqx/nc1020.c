@@ -1,491 +1,941 @@
-#include "nc1020.h"
-#include "cpu6502.h"
-#include "nc1020_states.h"
-#include "nc1020_io.h"
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-#include <stdbool.h>
-#include <time.h>
-
-// cpu cycles per second (cpu freq).
-const uint64_t CYCLES_SECOND = 5120000;
-const uint64_t TIMER0_FREQ = 2;
-const uint64_t TIMER1_FREQ = 0x100;
-// cpu cycles per timer0 period (1/2 s).
-const uint64_t CYCLES_TIMER0 = CYCLES_SECOND / TIMER0_FREQ;
-// cpu cycles per timer1 period (1/256 s).
-const uint64_t CYCLES_TIMER1 = CYCLES_SECOND / TIMER1_FREQ;
-// speed up
-const uint64_t CYCLES_TIMER1_SPEED_UP = CYCLES_SECOND / TIMER1_FREQ / 20;
-// cpu cycles per ms (1/1000 s).
-const uint64_t CYCLES_MS = CYCLES_SECOND / 1000;
-
-static const uint64_t ROM_SIZE = 0x8000 * 0x300;
-static const uint64_t NOR_SIZE = 0x8000 * 0x20;
-
-static const uint16_t IO_LIMIT = 0x40;
-
-static const uint16_t NMI_VEC = 0xFFFA;
-static const uint16_t RESET_VEC = 0xFFFC;
-
-static const uint64_t VERSION = 0x06;
-
-static const int MAX_FILE_NAME_LENGTH = 255;
-
-static char _rom_file_path[MAX_FILE_NAME_LENGTH];
-static char _nor_file_path[MAX_FILE_NAME_LENGTH];
-static char _state_file_path[MAX_FILE_NAME_LENGTH];
-
-static uint8_t _rom_buff[ROM_SIZE];
-static uint8_t _nor_buff[NOR_SIZE];
-
-static uint8_t *_nor_banks[0x20];
-
-static uint8_t *_memmap[8];
-static nc1020_states_t _nc1020_states;
-
-static uint8_t *_ram_buff;
-static uint8_t *_ram_page0;
-static uint8_t *_ram_page2;
-static uint8_t *_ram_page3;
-
-static uint8_t *_clock_buff;
-
-static uint8_t *_jg_wav_buff;
-
-static uint8_t *_fp_buff;
-
-static uint8_t *_keypad_matrix;
-
-static void adjust_time(){
-    if (++ _clock_buff[0] >= 60) {
-        _clock_buff[0] = 0;
-        if (++ _clock_buff[1] >= 60) {
-            _clock_buff[1] = 0;
-            if (++ _clock_buff[2] >= 24) {
-                _clock_buff[2] &= 0xC0u;
-                ++ _clock_buff[3];
-            }
-        }
-    }
-}
-
-static bool is_count_down(){
-    if (!(_clock_buff[10] & 0x02u) ||
-        !(_nc1020_states.clock_flags & 0x02u)) {
-        return false;
-    }
-    return (
-        ((_clock_buff[7] & 0x80u) && !(((_clock_buff[7] ^ _clock_buff[2])) & 0x1Fu)) ||
-        ((_clock_buff[6] & 0x80u) && !(((_clock_buff[6] ^ _clock_buff[1])) & 0x3Fu)) ||
-        ((_clock_buff[5] & 0x80u) && !(((_clock_buff[5] ^ _clock_buff[0])) & 0x3Fu))
-        );
-}
-
-/**
- * ProcessBinary
- * encrypt or decrypt wqx's binary file. just flip every bank.
- */
-static void process_binary(uint8_t *dest, uint8_t *src, uint64_t size){
-	uint64_t offset = 0;
-    while (offset < size) {
-        memcpy(dest + offset + 0x4000, src + offset, 0x4000);
-        memcpy(dest + offset, src + offset + 0x4000, 0x4000);
-        offset += 0x8000;
-    }
-}
-
-static void load_rom(){
-	uint8_t* temp_buff = (uint8_t*)malloc(ROM_SIZE);
-	FILE* file = fopen(_rom_file_path, "rbe");
-	fread(temp_buff, 1, ROM_SIZE, file);
-    process_binary(_rom_buff, temp_buff, ROM_SIZE);
-	free(temp_buff);
-	fclose(file);
-}
-
-static void load_nor(){
-	uint8_t* temp_buff = (uint8_t*)malloc(NOR_SIZE);
-	FILE* file = fopen(_nor_file_path, "rbe");
-	fread(temp_buff, 1, NOR_SIZE, file);
-    process_binary(_nor_buff, temp_buff, NOR_SIZE);
-	free(temp_buff);
-	fclose(file);
-}
-
-static void save_nor(){
-	uint8_t* temp_buff = (uint8_t*)malloc(NOR_SIZE);
-	FILE* file = fopen(_nor_file_path, "wbe");
-    process_binary(temp_buff, _nor_buff, NOR_SIZE);
-	fwrite(temp_buff, 1, NOR_SIZE, file);
-	fflush(file);
-	free(temp_buff);
-	fclose(file);
-}
-
-static uint8_t peek_byte(uint16_t addr) {
-	return _memmap[addr / 0x2000][addr % 0x2000];
-}
-
-static uint16_t peek_word(uint16_t addr) {
-	return peek_byte(addr) | (peek_byte((uint16_t) (addr + 1u)) << 8u);
-}
-static uint8_t load(uint16_t addr) {
-	if (addr < IO_LIMIT) {
-		return read_io((uint8_t) addr);
-	}
-	if (((_nc1020_states.fp_step == 4 && _nc1020_states.fp_type == 2) ||
-		(_nc1020_states.fp_step == 6 && _nc1020_states.fp_type == 3)) &&
-		(addr >= 0x4000 && addr < 0xC000)) {
-		_nc1020_states.fp_step = 0;
-		return 0x88;
-	}
-	if (addr == 0x45F && _nc1020_states.pending_wake_up) {
-		_nc1020_states.pending_wake_up = false;
-		_memmap[0][0x45F] = _nc1020_states.wake_up_flags;
-	}
-	return peek_byte(addr);
-}
-
-static void store(uint16_t addr, uint8_t value) {
-	if (addr < IO_LIMIT) {
-		write_io((uint8_t) addr, value);
-		return;
-	}
-	if (addr < 0x4000) {
-        _memmap[addr / 0x2000][addr % 0x2000] = value;
-		return;
-	}
-	uint8_t* page = _memmap[addr >> 13u];
-	if (page == _ram_page2 || page == _ram_page3) {
-		page[addr & 0x1FFFu] = value;
-		return;
-	}
-	if (addr >= 0xE000) {
-		return;
-	}
-
-    // write to nor_flash address space.
-    // there must select a nor_bank.
-
-    uint8_t bank_idx = read_io(0x00);
-    if (bank_idx >= 0x20) {
-        return;
-    }
-
-    uint8_t* bank = _nor_banks[bank_idx];
-
-    if (_nc1020_states.fp_step == 0) {
-        if (addr == 0x5555 && value == 0xAA) {
-            _nc1020_states.fp_step = 1;
-        }
-        return;
-    }
-    if (_nc1020_states.fp_step == 1) {
-        if (addr == 0xAAAA && value == 0x55) {
-        	_nc1020_states.fp_step = 2;
-            return;
-        }
-    } else if (_nc1020_states.fp_step == 2) {
-        if (addr == 0x5555) {
-            switch (value) {
-                case 0x90: _nc1020_states.fp_type = 1; break;
-                case 0xA0: _nc1020_states.fp_type = 2; break;
-                case 0x80: _nc1020_states.fp_type = 3; break;
-                case 0xA8: _nc1020_states.fp_type = 4; break;
-                case 0x88: _nc1020_states.fp_type = 5; break;
-                case 0x78: _nc1020_states.fp_type = 6; break;
-                default:break;
-            }
-            if (_nc1020_states.fp_type) {
-                if (_nc1020_states.fp_type == 1) {
-                    _nc1020_states.fp_bank_idx = bank_idx;
-                    _nc1020_states.fp_bak1 = bank[0x4000];
-                    _nc1020_states.fp_bak1 = bank[0x4001];
-                }
-                _nc1020_states.fp_step = 3;
-                return;
-            }
-        }
-    } else if (_nc1020_states.fp_step == 3) {
-        if (_nc1020_states.fp_type == 1) {
-            if (value == 0xF0) {
-                bank[0x4000] = _nc1020_states.fp_bak1;
-                bank[0x4001] = _nc1020_states.fp_bak2;
-                _nc1020_states.fp_step = 0;
-                return;
-            }
-        } else if (_nc1020_states.fp_type == 2) {
-            bank[addr - 0x4000] &= value;
-            _nc1020_states.fp_step = 4;
-            return;
-        } else if (_nc1020_states.fp_type == 4) {
-            _fp_buff[addr & 0xFFu] &= value;
-            _nc1020_states.fp_step = 4;
-            return;
-        } else if (_nc1020_states.fp_type == 3 || _nc1020_states.fp_type == 5) {
-            if (addr == 0x5555 && value == 0xAA) {
-                _nc1020_states.fp_step = 4;
-                return;
-            }
-        }
-    } else if (_nc1020_states.fp_step == 4) {
-        if (_nc1020_states.fp_type == 3 || _nc1020_states.fp_type == 5) {
-            if (addr == 0xAAAA && value == 0x55) {
-                _nc1020_states.fp_step = 5;
-                return;
-            }
-        }
-    } else if (_nc1020_states.fp_step == 5) {
-        if (addr == 0x5555 && value == 0x10) {
-        	for (uint64_t i=0; i<0x20; i++) {
-                memset(_nor_banks[i], 0xFF, 0x8000);
-            }
-            if (_nc1020_states.fp_type == 5) {
-                memset(_fp_buff, 0xFF, 0x100);
-            }
-            _nc1020_states.fp_step = 6;
-            return;
-        }
-        if (_nc1020_states.fp_type == 3) {
-            if (value == 0x30) {
-                memset(bank + (addr - (addr % 0x800) - 0x4000), 0xFF, 0x800);
-                _nc1020_states.fp_step = 6;
-                return;
-            }
-        } else if (_nc1020_states.fp_type == 5) {
-            if (value == 0x48) {
-                memset(_fp_buff, 0xFF, 0x100);
-                _nc1020_states.fp_step = 6;
-                return;
-            }
-        }
-    }
-    if (addr == 0x8000 && value == 0xF0) {
-        _nc1020_states.fp_step = 0;
-        return;
-    }
-    printf("error occurs when operate in flash!");
-}
-
-static void sync_time() {
-    time_t time_raw_format;
-    struct tm * ptr_time;
-    time ( &time_raw_format );
-    ptr_time = localtime ( &time_raw_format );
-    store(1138, (uint8_t) (1900 + ptr_time -> tm_year - 1881));
-    store(1139, (uint8_t) (ptr_time -> tm_mon + 1));
-    store(1140, (uint8_t) (ptr_time -> tm_mday + 1));
-    store(1141, (uint8_t) (ptr_time -> tm_wday));
-    store(1135, (uint8_t) (ptr_time -> tm_hour));
-    store(1136, (uint8_t) (ptr_time -> tm_min));
-    store(1137, (uint8_t) (ptr_time -> tm_sec / 2));
-
-    _clock_buff[0] = (uint8_t) ptr_time -> tm_sec;
-    _clock_buff[1] = (uint8_t) ptr_time -> tm_min;
-    _clock_buff[2] = (uint8_t) ptr_time -> tm_hour;
-}
-
-void initialize(const char *rom_file_path, const char *nor_file_path, const char *state_file_path) {
-    strncpy(_rom_file_path, rom_file_path, MAX_FILE_NAME_LENGTH);
-    strncpy(_nor_file_path, nor_file_path, MAX_FILE_NAME_LENGTH);
-    strncpy(_state_file_path, state_file_path, MAX_FILE_NAME_LENGTH);
-
-    _ram_buff = _nc1020_states.ram;
-    _ram_page0 = _ram_buff;
-    _ram_page2 = _ram_buff + 0x4000;
-    _ram_page3 = _ram_buff + 0x6000;
-    _clock_buff = _nc1020_states.clock_data;
-    _jg_wav_buff = _nc1020_states.jg_wav_data;
-    _fp_buff = _nc1020_states.fp_buff;
-    _keypad_matrix = _nc1020_states.keypad_matrix;
-
-	for (uint64_t i=0; i<0x20; i++) {
-		_nor_banks[i] = _nor_buff + (0x8000 * i);
-	}
-
-    init_6502(peek_byte, load, store);
-    init_nc1020_io(&_nc1020_states, _rom_buff, _nor_buff, _memmap);
-
-    load_rom();
-}
-
-static void reset_states(){
-	_nc1020_states.version = VERSION;
-
-	memset(_ram_buff, 0, 0x8000);
-	_memmap[0] = _ram_page0;
-	_memmap[2] = _ram_page2;
-    switch_volume();
-
-	memset(_keypad_matrix, 0, 8);
-
-	memset(_clock_buff, 0, 80);
-	_nc1020_states.clock_flags = 0;
-
-	_nc1020_states.timer0_toggle = false;
-
-	memset(_jg_wav_buff, 0, 0x20);
-	_nc1020_states.jg_wav_flags = 0;
-	_nc1020_states.jg_wav_idx = 0;
-
-	_nc1020_states.should_wake_up = false;
-	_nc1020_states.pending_wake_up = false;
-
-	memset(_fp_buff, 0, 0x100);
-	_nc1020_states.fp_step = 0;
-
-	_nc1020_states.should_irq = false;
-
-	_nc1020_states.cycles = 0;
-	_nc1020_states.cpu.reg_a = 0;
-	_nc1020_states.cpu.reg_ps = 0x24;
-	_nc1020_states.cpu.reg_x = 0;
-	_nc1020_states.cpu.reg_y = 0;
-	_nc1020_states.cpu.reg_sp = 0xFF;
-	_nc1020_states.cpu.reg_pc = peek_word(RESET_VEC);
-	_nc1020_states.timer0_cycles = CYCLES_TIMER0;
-	_nc1020_states.timer1_cycles = CYCLES_TIMER1;
-}
-
-static void load_states(){
-    reset_states();
-	FILE* file = fopen(_state_file_path, "rbe");
-	if (file == NULL) {
-		return;
-	}
-	fread(&_nc1020_states, 1, sizeof(_nc1020_states), file);
-	fclose(file);
-	if (_nc1020_states.version != VERSION) {
-		return;
-	}
-    switch_volume();
-}
-
-static void save_states(){
-	FILE* file = fopen(_state_file_path, "wbe");
-	fwrite(&_nc1020_states, 1, sizeof(_nc1020_states), file);
-	fflush(file);
-	fclose(file);
-}
-
-void reset() {
-    load_nor();
-    reset_states();
-}
-
-void load_nc1020(){
-    load_nor();
-    load_states();
-    sync_time();
-}
-
-void save_nc1020(){
-    save_nor();
-    save_states();
-}
-
-void set_key(uint8_t key_id, bool down_or_up){
-	uint8_t row = (uint8_t) (key_id % 8u);
-	uint8_t col = (uint8_t) (key_id / 8u);
-	uint8_t bits = (uint8_t) (1u << col);
-	if (key_id == 0x0F) {
-		bits = 0xFE;
-	}
-	if (down_or_up) {
-		_keypad_matrix[row] |= bits;
-	} else {
-		_keypad_matrix[row] &= ~bits;
-	}
-
-	if (down_or_up) {
-		if (_nc1020_states.slept) {
-			if (key_id >= 0x08 && key_id <= 0x0F && key_id != 0x0E) {
-                switch (key_id) {
-                    case 0x08: _nc1020_states.wake_up_flags = 0x00; break;
-                    case 0x09: _nc1020_states.wake_up_flags = 0x0A; break;
-                    case 0x0A: _nc1020_states.wake_up_flags = 0x08; break;
-                    case 0x0B: _nc1020_states.wake_up_flags = 0x06; break;
-                    case 0x0C: _nc1020_states.wake_up_flags = 0x04; break;
-                    case 0x0D: _nc1020_states.wake_up_flags = 0x02; break;
-                    case 0x0E: _nc1020_states.wake_up_flags = 0x0C; break;
-                    case 0x0F: _nc1020_states.wake_up_flags = 0x00; break;
-                    default:break;
-                }
-				_nc1020_states.should_wake_up = true;
-				_nc1020_states.pending_wake_up = true;
-				_nc1020_states.slept = false;
-			}
-		} else {
-			if (key_id == 0x0F) {
-				_nc1020_states.slept = true;
-			}
-		}
-	}
-}
-
-uint64_t get_cycles() {
-    return _nc1020_states.cycles;
-}
-
-/**
- * @return The LCD buffer, size is 1600 uint_8
- */
-uint8_t* get_lcd_buffer(){
-    if (_nc1020_states.lcd_addr == 0)
-        return NULL;
-
-    uint8_t *lcd_buffer = _ram_buff + _nc1020_states.lcd_addr;
-    return lcd_buffer;
-}
-
-
-void run_time_slice(uint64_t time_slice, bool speed_up) {
-    uint64_t end_cycles = time_slice * CYCLES_MS;
-
-    uint64_t cycles = 0;
-
-	while (cycles < end_cycles) {
-		cycles += execute_6502(&_nc1020_states.cpu);
-		if (cycles >= _nc1020_states.timer0_cycles) {
-			_nc1020_states.timer0_cycles += CYCLES_TIMER0;
-			_nc1020_states.timer0_toggle = !_nc1020_states.timer0_toggle;
-			if (!_nc1020_states.timer0_toggle) {
-                adjust_time();
-			}
-			if (!is_count_down() || _nc1020_states.timer0_toggle) {
-				write_io(0x3D, 0);
-			} else {
-                write_io(0x3D, 0x20);
-				_nc1020_states.clock_flags &= 0xFD;
-			}
-			_nc1020_states.should_irq = true;
-		}
-		if (_nc1020_states.should_irq) {
-			_nc1020_states.should_irq = false;
-			cycles += do_irq(&_nc1020_states.cpu);
-		}
-		if (cycles >= _nc1020_states.timer1_cycles) {
-			if (speed_up) {
-				_nc1020_states.timer1_cycles += CYCLES_TIMER1_SPEED_UP;
-			} else {
-				_nc1020_states.timer1_cycles += CYCLES_TIMER1;
-			}
-			_clock_buff[4] ++;
-			if (_nc1020_states.should_wake_up) {
-				_nc1020_states.should_wake_up = false;
-                write_io(0x01, (uint8_t) (read_io(0x01) | 0x01u));
-                write_io(0x02, (uint8_t) (read_io(0x02) | 0x01u));
-				_nc1020_states.cpu.reg_pc = peek_word(RESET_VEC);
-			} else {
-                write_io(0x01, (uint8_t) (read_io(0x01) | 0x08u));
-				_nc1020_states.should_irq = true;
-			}
-		}
-	}
-
-	_nc1020_states.cycles += cycles;
-	_nc1020_states.timer0_cycles -= end_cycles;
-	_nc1020_states.timer1_cycles -= end_cycles;
-}
+#include "nc1020.h"
+#include "cpu6502.h"
+#include "nc1020_states.h"
+#include "nc1020_context.h"
+#include "nc1020_io.h"
+#include "nc1020_save.h"
+#include "nc1020_overlay.h"
+#include "nc1020_state_file.h"
+#include "nc1020_rewind.h"
+#include "nc1020_snapshot.h"
+#include "nc1020_movie.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// cpu cycles per second (cpu freq).
+const uint64_t CYCLES_SECOND = 5120000;
+const uint64_t TIMER0_FREQ = 2;
+const uint64_t TIMER1_FREQ = 0x100;
+// cpu cycles per timer0 period (1/2 s).
+const uint64_t CYCLES_TIMER0 = CYCLES_SECOND / TIMER0_FREQ;
+// cpu cycles per timer1 period (1/256 s).
+const uint64_t CYCLES_TIMER1 = CYCLES_SECOND / TIMER1_FREQ;
+// speed up
+const uint64_t CYCLES_TIMER1_SPEED_UP = CYCLES_SECOND / TIMER1_FREQ / 20;
+// cpu cycles per ms (1/1000 s).
+const uint64_t CYCLES_MS = CYCLES_SECOND / 1000;
+// emulated ms between the keyframes kept while a movie plays.
+static const uint64_t KEYFRAME_INTERVAL_MS = 10000;
+
+static const uint16_t IO_LIMIT = 0x40;
+
+static const uint16_t NMI_VEC = 0xFFFA;
+static const uint16_t RESET_VEC = 0xFFFC;
+
+static const uint64_t VERSION = 0x06;
+
+// the loaded roms, guarded by _roms_lock.
+static nc1020_rom_t *_roms;
+static pthread_mutex_t _roms_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void adjust_time(nc1020_t *nc){
+    if (++ nc -> clock_buff[0] >= 60) {
+        nc -> clock_buff[0] = 0;
+        if (++ nc -> clock_buff[1] >= 60) {
+            nc -> clock_buff[1] = 0;
+            if (++ nc -> clock_buff[2] >= 24) {
+                nc -> clock_buff[2] &= 0xC0u;
+                ++ nc -> clock_buff[3];
+            }
+        }
+    }
+}
+
+static bool is_count_down(nc1020_t *nc){
+    if (!(nc -> clock_buff[10] & 0x02u) ||
+        !(nc -> states.clock_flags & 0x02u)) {
+        return false;
+    }
+    return (
+        ((nc -> clock_buff[7] & 0x80u) && !(((nc -> clock_buff[7] ^ nc -> clock_buff[2])) & 0x1Fu)) ||
+        ((nc -> clock_buff[6] & 0x80u) && !(((nc -> clock_buff[6] ^ nc -> clock_buff[1])) & 0x3Fu)) ||
+        ((nc -> clock_buff[5] & 0x80u) && !(((nc -> clock_buff[5] ^ nc -> clock_buff[0])) & 0x3Fu))
+        );
+}
+
+// copies a path whole, false if it doesn't fit.
+static bool copy_file_path(char *dst, const char *src){
+	size_t length = strlen(src);
+	if (length >= MAX_FILE_NAME_LENGTH) {
+		return false;
+	}
+	memcpy(dst, src, length + 1);
+	return true;
+}
+
+/**
+ * Maps the rom file read only, so all processes using it share the page cache and
+ * nothing is copied. Banks stay in the order of the file, see get_bank_page.
+ * @return NULL if the file can't be read or mapped.
+ */
+static nc1020_rom_t *load_rom(const char *rom_file_path){
+	nc1020_rom_t *rom = (nc1020_rom_t*)calloc(1, sizeof(nc1020_rom_t));
+	if (rom == NULL || !copy_file_path(rom -> file_path, rom_file_path)) {
+		free(rom);
+		return NULL;
+	}
+	int fd = open(rom_file_path, O_RDONLY | O_CLOEXEC);
+	struct stat file_stat;
+	if (fd < 0 || fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		free(rom);
+		return NULL;
+	}
+	// zeros where the file is short.
+	rom -> buff = (uint8_t*)mmap(NULL, ROM_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	size_t size = file_stat.st_size < ROM_SIZE ? (size_t) file_stat.st_size : ROM_SIZE;
+	if (rom -> buff == MAP_FAILED ||
+			mmap(rom -> buff, size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		if (rom -> buff != MAP_FAILED) {
+			munmap(rom -> buff, ROM_SIZE);
+		}
+		close(fd);
+		free(rom);
+		return NULL;
+	}
+	close(fd);
+	return rom;
+}
+
+/**
+ * @return the rom loaded from the file, shared with the other machines using it, NULL
+ * if it can't be loaded.
+ */
+static nc1020_rom_t *acquire_rom(const char *rom_file_path){
+	pthread_mutex_lock(&_roms_lock);
+	nc1020_rom_t *rom = _roms;
+	while (rom && strncmp(rom -> file_path, rom_file_path, MAX_FILE_NAME_LENGTH) != 0) {
+		rom = rom -> next;
+	}
+	if (rom == NULL && (rom = load_rom(rom_file_path)) != NULL) {
+		rom -> next = _roms;
+		_roms = rom;
+	}
+	if (rom) {
+		rom -> refs++;
+	}
+	pthread_mutex_unlock(&_roms_lock);
+	return rom;
+}
+
+static void release_rom(nc1020_rom_t *rom){
+	pthread_mutex_lock(&_roms_lock);
+	if (--rom -> refs == 0) {
+		nc1020_rom_t **link = &_roms;
+		while (*link != rom) {
+			link = &(*link) -> next;
+		}
+		*link = rom -> next;
+		munmap(rom -> buff, ROM_SIZE);
+		free(rom);
+	}
+	pthread_mutex_unlock(&_roms_lock);
+}
+
+void mark_nor_dirty(nc1020_t *nc, const uint8_t *ptr, uint32_t size){
+	uint32_t offset = (uint32_t) (ptr - nc -> nor_buff);
+	for (uint32_t i = offset / NOR_SECTOR_SIZE; i <= (offset + size - 1) / NOR_SECTOR_SIZE && i < NOR_SECTORS; i++) {
+		nc -> nor_dirty[i / 64] |= 1ull << (i % 64);
+		nc -> nor_overlay[i / 64] |= 1ull << (i % 64);
+		nc -> nor_rewind[i / 64] |= 1ull << (i % 64);
+	}
+}
+
+static void load_nor(nc1020_t *nc){
+	// the file has to have everything saved so far.
+	if (nc -> saver) {
+		flush_saver(nc -> saver);
+	}
+	// the snapshots are of another nor, and a movie doesn't go on from another start.
+	if (nc -> rewind) {
+		clear_rewind(nc -> rewind);
+	}
+	stop_movie(nc);
+	nc -> ahead_cycles = UINT64_MAX;
+	// a save a crash cut short is finished first, the states with it.
+	if (!nc -> read_only) {
+		replay_save_journal(nc -> nor_file_path, nc -> overlay_file_path, nc -> state_file_path);
+	}
+	if (nc -> overlay_file_path[0]) {
+		load_nor_overlay(nc);
+		invalidate_6502_code(nc -> cpu, nc -> nor_buff, NOR_SIZE);
+		return;
+	}
+	if (nc -> nor_mapped) {
+		// the pages of the base follow the file as saves write to it. If they can't be
+		// remapped, touching every one makes it the machine's own.
+		if (mmap(nc -> nor_buff, NOR_SIZE, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+			memset(nc -> nor_buff, 0, NOR_SIZE);
+		}
+		nc -> nor_mapped = false;
+	}
+	// a short or missing file is written whole on the next save.
+	memset(nc -> nor_dirty, 0xFF, sizeof(nc -> nor_dirty));
+	FILE* file = fopen(nc -> nor_file_path, "rbe");
+	if (file) {
+		if (fread(nc -> nor_buff, 1, NOR_SIZE, file) == NOR_SIZE) {
+			memset(nc -> nor_dirty, 0, sizeof(nc -> nor_dirty));
+		}
+		fclose(file);
+	}
+	// whatever the buffer holds now, code translated from it before is stale.
+    invalidate_6502_code(nc -> cpu, nc -> nor_buff, NOR_SIZE);
+}
+
+static uint8_t peek_byte(nc1020_t *nc, uint16_t addr) {
+	return nc -> memmap[addr / 0x2000][addr % 0x2000];
+}
+
+static uint16_t peek_word(nc1020_t *nc, uint16_t addr) {
+	return peek_byte(nc, addr) | (peek_byte(nc, (uint16_t) (addr + 1u)) << 8u);
+}
+uint8_t load_memory(void *context, uint16_t addr) {
+	nc1020_t *nc = (nc1020_t*) context;
+	if (addr < IO_LIMIT) {
+		return read_io(nc, (uint8_t) addr);
+	}
+	if (((nc -> states.fp_step == 4 && nc -> states.fp_type == 2) ||
+		(nc -> states.fp_step == 6 && nc -> states.fp_type == 3)) &&
+		(addr >= 0x4000 && addr < 0xC000)) {
+		nc -> states.fp_step = 0;
+		update_page_flags(nc);
+		mark_6502_side_effect(nc -> cpu);
+		return 0x88;
+	}
+	if (addr == 0x45F && nc -> states.pending_wake_up) {
+		nc -> states.pending_wake_up = false;
+		nc -> memmap[0][0x45F] = nc -> states.wake_up_flags;
+		mark_6502_side_effect(nc -> cpu);
+	}
+	return peek_byte(nc, addr);
+}
+
+static void store_nor(nc1020_t *nc, uint16_t addr, uint8_t value);
+
+void store_memory(void *context, uint16_t addr, uint8_t value) {
+	nc1020_t *nc = (nc1020_t*) context;
+	if (addr < IO_LIMIT) {
+		write_io(nc, (uint8_t) addr, value);
+		return;
+	}
+	if (addr < 0x4000) {
+        nc -> memmap[addr / 0x2000][addr % 0x2000] = value;
+		return;
+	}
+	uint8_t* page = nc -> memmap[addr >> 13u];
+	if (page == nc -> ram_page2 || page == nc -> ram_page3) {
+		page[addr & 0x1FFFu] = value;
+		return;
+	}
+	if (addr >= 0xE000) {
+		return;
+	}
+    store_nor(nc, addr, value);
+    update_page_flags(nc);
+}
+
+// a machine running ahead keeps what it overwrites to come back to.
+static void before_nor_write(nc1020_t *nc, const uint8_t *ptr, uint32_t size) {
+    if (nc -> nor_backup) {
+        backup_nor(nc -> nor_backup, nc, ptr, size);
+    }
+}
+
+static void store_nor(nc1020_t *nc, uint16_t addr, uint8_t value) {
+    // write to nor_flash address space.
+    // there must select a nor_bank.
+
+    uint8_t bank_idx = read_io(nc, 0x00);
+    if (bank_idx >= 0x20) {
+        return;
+    }
+
+    uint8_t* bank = nc -> nor_banks[bank_idx];
+
+    if (nc -> states.fp_step == 0) {
+        if (addr == 0x5555 && value == 0xAA) {
+            nc -> states.fp_step = 1;
+        }
+        return;
+    }
+    if (nc -> states.fp_step == 1) {
+        if (addr == 0xAAAA && value == 0x55) {
+        	nc -> states.fp_step = 2;
+            return;
+        }
+    } else if (nc -> states.fp_step == 2) {
+        if (addr == 0x5555) {
+            switch (value) {
+                case 0x90: nc -> states.fp_type = 1; break;
+                case 0xA0: nc -> states.fp_type = 2; break;
+                case 0x80: nc -> states.fp_type = 3; break;
+                case 0xA8: nc -> states.fp_type = 4; break;
+                case 0x88: nc -> states.fp_type = 5; break;
+                case 0x78: nc -> states.fp_type = 6; break;
+                default:break;
+            }
+            if (nc -> states.fp_type) {
+                if (nc -> states.fp_type == 1) {
+                    nc -> states.fp_bank_idx = bank_idx;
+                    nc -> states.fp_bak1 = bank[get_bank_offset(0x4000)];
+                    nc -> states.fp_bak1 = bank[get_bank_offset(0x4001)];
+                }
+                nc -> states.fp_step = 3;
+                return;
+            }
+        }
+    } else if (nc -> states.fp_step == 3) {
+        if (nc -> states.fp_type == 1) {
+            if (value == 0xF0) {
+                before_nor_write(nc, bank + get_bank_offset(0x4000), 2);
+                bank[get_bank_offset(0x4000)] = nc -> states.fp_bak1;
+                bank[get_bank_offset(0x4001)] = nc -> states.fp_bak2;
+                invalidate_6502_code(nc -> cpu, bank + get_bank_offset(0x4000), 2);
+                mark_nor_dirty(nc, bank + get_bank_offset(0x4000), 2);
+                nc -> states.fp_step = 0;
+                return;
+            }
+        } else if (nc -> states.fp_type == 2) {
+            uint8_t *ptr = bank + get_bank_offset(addr - 0x4000u);
+            before_nor_write(nc, ptr, 1);
+            *ptr &= value;
+            invalidate_6502_code(nc -> cpu, ptr, 1);
+            mark_nor_dirty(nc, ptr, 1);
+            nc -> states.fp_step = 4;
+            return;
+        } else if (nc -> states.fp_type == 4) {
+            nc -> fp_buff[addr & 0xFFu] &= value;
+            nc -> states.fp_step = 4;
+            return;
+        } else if (nc -> states.fp_type == 3 || nc -> states.fp_type == 5) {
+            if (addr == 0x5555 && value == 0xAA) {
+                nc -> states.fp_step = 4;
+                return;
+            }
+        }
+    } else if (nc -> states.fp_step == 4) {
+        if (nc -> states.fp_type == 3 || nc -> states.fp_type == 5) {
+            if (addr == 0xAAAA && value == 0x55) {
+                nc -> states.fp_step = 5;
+                return;
+            }
+        }
+    } else if (nc -> states.fp_step == 5) {
+        if (addr == 0x5555 && value == 0x10) {
+            before_nor_write(nc, nc -> nor_buff, NOR_SIZE);
+        	for (uint64_t i=0; i<0x20; i++) {
+                memset(nc -> nor_banks[i], 0xFF, 0x8000);
+            }
+            invalidate_6502_code(nc -> cpu, nc -> nor_buff, NOR_SIZE);
+            mark_nor_dirty(nc, nc -> nor_buff, NOR_SIZE);
+            if (nc -> states.fp_type == 5) {
+                memset(nc -> fp_buff, 0xFF, 0x100);
+            }
+            nc -> states.fp_step = 6;
+            return;
+        }
+        if (nc -> states.fp_type == 3) {
+            if (value == 0x30) {
+                uint8_t *sector = bank + get_bank_offset(addr - (addr % 0x800) - 0x4000u);
+                before_nor_write(nc, sector, 0x800);
+                memset(sector, 0xFF, 0x800);
+                invalidate_6502_code(nc -> cpu, sector, 0x800);
+                mark_nor_dirty(nc, sector, 0x800);
+                nc -> states.fp_step = 6;
+                return;
+            }
+        } else if (nc -> states.fp_type == 5) {
+            if (value == 0x48) {
+                memset(nc -> fp_buff, 0xFF, 0x100);
+                nc -> states.fp_step = 6;
+                return;
+            }
+        }
+    }
+    if (addr == 0x8000 && value == 0xF0) {
+        nc -> states.fp_step = 0;
+        return;
+    }
+    printf("error occurs when operate in flash!");
+}
+
+// the seconds since 1970 in local time the clock syncs to on load.
+static int64_t get_clock_time(nc1020_t *nc) {
+    if (nc -> time_source) {
+        return nc -> time_source(nc -> time_context);
+    }
+    time_t now = time(NULL);
+    struct tm local_time;
+    localtime_r(&now, &local_time);
+    return (int64_t) now + local_time.tm_gmtoff;
+}
+
+static void sync_time(nc1020_t *nc) {
+    time_t time_raw_format = (time_t) get_clock_time(nc);
+    struct tm time_fields;
+    struct tm * ptr_time = gmtime_r(&time_raw_format, &time_fields);
+    store_memory(nc, 1138, (uint8_t) (1900 + ptr_time -> tm_year - 1881));
+    store_memory(nc, 1139, (uint8_t) (ptr_time -> tm_mon + 1));
+    store_memory(nc, 1140, (uint8_t) (ptr_time -> tm_mday + 1));
+    store_memory(nc, 1141, (uint8_t) (ptr_time -> tm_wday));
+    store_memory(nc, 1135, (uint8_t) (ptr_time -> tm_hour));
+    store_memory(nc, 1136, (uint8_t) (ptr_time -> tm_min));
+    store_memory(nc, 1137, (uint8_t) (ptr_time -> tm_sec / 2));
+
+    nc -> clock_buff[0] = (uint8_t) ptr_time -> tm_sec;
+    nc -> clock_buff[1] = (uint8_t) ptr_time -> tm_min;
+    nc -> clock_buff[2] = (uint8_t) ptr_time -> tm_hour;
+}
+
+nc1020_t *create_nc1020() {
+    nc1020_t *nc = (nc1020_t*) calloc(1, sizeof(nc1020_t));
+    if (nc == NULL) {
+        return NULL;
+    }
+    // mapped, so an overlay can put its base in the same place.
+    nc -> nor_buff = (uint8_t*) mmap(NULL, NOR_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (nc -> nor_buff == MAP_FAILED) {
+        free(nc);
+        return NULL;
+    }
+    nc -> ahead_cycles = UINT64_MAX;
+    pthread_mutex_init(&nc -> key_lock, NULL);
+    nc -> cpu = create_6502(load_memory, store_memory, nc, nc -> memmap, nc -> page_flags);
+    if (nc -> cpu == NULL) {
+        pthread_mutex_destroy(&nc -> key_lock);
+        munmap(nc -> nor_buff, NOR_SIZE);
+        free(nc);
+        return NULL;
+    }
+    return nc;
+}
+
+void destroy_nc1020(nc1020_t *nc) {
+    if (nc -> saver) {
+        destroy_saver(nc -> saver);
+    }
+    if (nc -> rewind) {
+        destroy_rewind(nc -> rewind);
+    }
+    if (nc -> ahead) {
+        destroy_snapshot(nc -> ahead);
+    }
+    stop_movie(nc);
+    if (nc -> rom) {
+        release_rom(nc -> rom);
+    }
+    destroy_6502(nc -> cpu);
+    pthread_mutex_destroy(&nc -> key_lock);
+    munmap(nc -> nor_buff, NOR_SIZE);
+    free(nc);
+}
+
+bool initialize(nc1020_t *nc, const char *rom_file_path, const char *nor_file_path, const char *state_file_path) {
+    if (strlen(nor_file_path) >= MAX_FILE_NAME_LENGTH || strlen(state_file_path) >= MAX_FILE_NAME_LENGTH) {
+        return false;
+    }
+    // a machine initialized again may keep using the same rom.
+    nc1020_rom_t *rom = acquire_rom(rom_file_path);
+    if (rom == NULL) {
+        return false;
+    }
+    copy_file_path(nc -> nor_file_path, nor_file_path);
+    copy_file_path(nc -> state_file_path, state_file_path);
+
+    nc -> ram_buff = nc -> states.ram;
+    nc -> ram_page0 = nc -> ram_buff;
+    nc -> ram_page2 = nc -> ram_buff + 0x4000;
+    nc -> ram_page3 = nc -> ram_buff + 0x6000;
+    nc -> clock_buff = nc -> states.clock_data;
+    nc -> jg_wav_buff = nc -> states.jg_wav_data;
+    nc -> fp_buff = nc -> states.fp_buff;
+    nc -> keypad_matrix = nc -> states.keypad_matrix;
+
+    nc1020_rom_t *old_rom = nc -> rom;
+    nc -> rom = rom;
+    if (old_rom) {
+        if (old_rom != nc -> rom) {
+            invalidate_6502_code(nc -> cpu, old_rom -> buff, ROM_SIZE);
+        }
+        release_rom(old_rom);
+    }
+
+    init_nc1020_io(nc);
+    return true;
+}
+
+static void reset_states(nc1020_t *nc){
+	nc -> states.version = VERSION;
+
+	memset(nc -> ram_buff, 0, 0x8000);
+	nc -> memmap[0] = nc -> ram_page0;
+	nc -> memmap[2] = nc -> ram_page2;
+    switch_volume(nc);
+
+	memset(nc -> keypad_matrix, 0, 8);
+
+	memset(nc -> clock_buff, 0, 80);
+	nc -> states.clock_flags = 0;
+
+	nc -> states.timer0_toggle = false;
+
+	memset(nc -> jg_wav_buff, 0, 0x20);
+	nc -> states.jg_wav_flags = 0;
+	nc -> states.jg_wav_idx = 0;
+
+	nc -> states.should_wake_up = false;
+	nc -> states.pending_wake_up = false;
+
+	memset(nc -> fp_buff, 0, 0x100);
+	nc -> states.fp_step = 0;
+
+	nc -> states.should_irq = false;
+
+	nc -> states.cycles = 0;
+	nc -> states.cpu.reg_a = 0;
+	nc -> states.cpu.reg_ps = 0x24;
+	nc -> states.cpu.reg_x = 0;
+	nc -> states.cpu.reg_y = 0;
+	nc -> states.cpu.reg_sp = 0xFF;
+	nc -> states.cpu.reg_pc = peek_word(nc, RESET_VEC);
+	nc -> states.timer0_cycles = CYCLES_TIMER0;
+	nc -> states.timer1_cycles = CYCLES_TIMER1;
+	update_page_flags(nc);
+}
+
+static void load_states(nc1020_t *nc){
+    reset_states(nc);
+	FILE* file = fopen(nc -> state_file_path, "rbe");
+	if (file == NULL) {
+		return;
+	}
+	uint8_t *data = NULL;
+	long size = -1;
+	if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+		data = (uint8_t*) malloc((size_t) size);
+	}
+	bool decoded = data != NULL && fread(data, 1, (size_t) size, file) == (size_t) size &&
+		decode_states(data, (size_t) size, &nc -> states);
+	free(data);
+	fclose(file);
+	if (!decoded) {
+		reset_states(nc);
+		return;
+	}
+	nc -> states.version = VERSION;
+    switch_volume(nc);
+}
+
+void reset(nc1020_t *nc) {
+    load_nor(nc);
+    reset_states(nc);
+}
+
+void load_nc1020(nc1020_t *nc){
+    load_nor(nc);
+    load_states(nc);
+    sync_time(nc);
+}
+
+void save_nc1020(nc1020_t *nc){
+    if (nc -> read_only) {
+        return;
+    }
+    if (nc -> saver == NULL) {
+        nc -> saver = create_saver();
+    }
+    queue_save(nc -> saver, nc);
+}
+
+bool flush_nc1020(nc1020_t *nc){
+    return nc -> saver == NULL || flush_saver(nc -> saver);
+}
+
+bool set_nor_overlay(nc1020_t *nc, const char *overlay_file_path){
+    return copy_file_path(nc -> overlay_file_path, overlay_file_path);
+}
+
+bool reset_nor_overlay(nc1020_t *nc){
+    if (nc -> overlay_file_path[0] == '\0' || nc -> read_only) {
+        return false;
+    }
+    flush_nc1020(nc);
+    if (!write_nor_overlay(nc -> overlay_file_path, NULL, NULL)) {
+        return false;
+    }
+    reset(nc);
+    return true;
+}
+
+void set_rewind(nc1020_t *nc, uint32_t interval_ms, uint32_t budget){
+    if (nc -> rewind) {
+        destroy_rewind(nc -> rewind);
+        nc -> rewind = NULL;
+    }
+    if (interval_ms && budget) {
+        nc -> rewind = create_rewind(interval_ms * CYCLES_MS, budget);
+    }
+}
+
+uint32_t get_rewind_points(nc1020_t *nc){
+    return nc -> rewind ? count_snapshots(nc -> rewind) : 0;
+}
+
+bool rewind_nc1020(nc1020_t *nc, uint32_t point){
+    if (nc -> rewind == NULL || point >= count_snapshots(nc -> rewind)) {
+        return false;
+    }
+    stop_movie(nc);
+    return restore_snapshot(nc -> rewind, nc, point);
+}
+
+void set_run_ahead(nc1020_t *nc, uint32_t run_ahead_ms){
+    nc -> run_ahead_ms = run_ahead_ms;
+    nc -> ahead_cycles = UINT64_MAX;
+}
+
+void set_time_source(nc1020_t *nc, nc1020_time_source_t time_source, void *context){
+    nc -> time_source = time_source;
+    nc -> time_context = context;
+}
+
+void set_read_only(nc1020_t *nc, bool read_only){
+    nc -> read_only = read_only;
+}
+
+bool start_movie(nc1020_t *nc, const char *movie_file_path){
+    stop_movie(nc);
+    nc -> movie = record_movie(nc, movie_file_path);
+    return nc -> movie != NULL;
+}
+
+bool play_movie(nc1020_t *nc, const char *movie_file_path){
+    stop_movie(nc);
+    nc -> movie = open_movie(nc, movie_file_path, KEYFRAME_INTERVAL_MS * CYCLES_MS);
+    if (nc -> movie == NULL) {
+        return false;
+    }
+    // keys set before are for the machine the movie replaced.
+    pthread_mutex_lock(&nc -> key_lock);
+    nc -> key_count = 0;
+    pthread_mutex_unlock(&nc -> key_lock);
+    if (nc -> rewind) {
+        clear_rewind(nc -> rewind);
+    }
+    nc -> ahead_cycles = UINT64_MAX;
+    return true;
+}
+
+bool run_movie_slice(nc1020_t *nc){
+    return nc -> movie && play_movie_slice(nc -> movie, nc);
+}
+
+bool seek_movie(nc1020_t *nc, uint64_t cycles){
+    if (nc -> movie == NULL) {
+        return false;
+    }
+    if (nc -> rewind) {
+        clear_rewind(nc -> rewind);
+    }
+    nc -> ahead_cycles = UINT64_MAX;
+    return play_movie_to(nc -> movie, nc, cycles);
+}
+
+bool stop_movie(nc1020_t *nc){
+    if (nc -> movie == NULL) {
+        return true;
+    }
+    bool stopped = close_movie(nc -> movie, nc);
+    nc -> movie = NULL;
+    return stopped;
+}
+
+/*
+ * Keys may come from another thread than the one running the slices. They wait for the
+ * next slice, one running ahead would put the states back and lose them otherwise.
+ */
+void set_key(nc1020_t *nc, uint8_t key_id, bool down_or_up){
+    pthread_mutex_lock(&nc -> key_lock);
+    if (nc -> key_count < KEY_QUEUE_SIZE) {
+        nc -> key_queue[nc -> key_count++] = (uint8_t) ((key_id & 0x3Fu) | (down_or_up ? 0x80u : 0u));
+    }
+    pthread_mutex_unlock(&nc -> key_lock);
+}
+
+static void apply_key(nc1020_t *nc, uint8_t key_id, bool down_or_up){
+    if (nc -> movie) {
+        record_key(nc -> movie, nc, key_id, down_or_up);
+    }
+	uint8_t row = (uint8_t) (key_id % 8u);
+	uint8_t col = (uint8_t) (key_id / 8u);
+	uint8_t bits = (uint8_t) (1u << col);
+	if (key_id == 0x0F) {
+		bits = 0xFE;
+	}
+	if (down_or_up) {
+		nc -> keypad_matrix[row] |= bits;
+	} else {
+		nc -> keypad_matrix[row] &= ~bits;
+	}
+
+	if (down_or_up) {
+		if (nc -> states.slept) {
+			if (key_id >= 0x08 && key_id <= 0x0F && key_id != 0x0E) {
+                switch (key_id) {
+                    case 0x08: nc -> states.wake_up_flags = 0x00; break;
+                    case 0x09: nc -> states.wake_up_flags = 0x0A; break;
+                    case 0x0A: nc -> states.wake_up_flags = 0x08; break;
+                    case 0x0B: nc -> states.wake_up_flags = 0x06; break;
+                    case 0x0C: nc -> states.wake_up_flags = 0x04; break;
+                    case 0x0D: nc -> states.wake_up_flags = 0x02; break;
+                    case 0x0E: nc -> states.wake_up_flags = 0x0C; break;
+                    case 0x0F: nc -> states.wake_up_flags = 0x00; break;
+                    default:break;
+                }
+				nc -> states.should_wake_up = true;
+				nc -> states.pending_wake_up = true;
+				nc -> states.slept = false;
+			}
+		} else {
+			if (key_id == 0x0F) {
+				nc -> states.slept = true;
+			}
+		}
+	}
+}
+
+bool is_sleeping(nc1020_t *nc) {
+    return nc -> states.slept;
+}
+
+uint64_t get_cycles(nc1020_t *nc) {
+    return nc -> states.cycles;
+}
+
+/**
+ * @return The LCD buffer, size is 1600 uint_8
+ */
+uint8_t* get_lcd_buffer(nc1020_t *nc){
+    // the frame run ahead of the states, unless they moved since.
+    if (nc -> ahead_cycles == nc -> states.cycles)
+        return nc -> ahead_lcd;
+    if (nc -> states.lcd_addr == 0)
+        return NULL;
+
+    uint8_t *lcd_buffer = nc -> ram_buff + nc -> states.lcd_addr;
+    return lcd_buffer;
+}
+
+/**
+ * Expands the lcd to one byte per pixel, 0xFF on and 0x00 off, the first column is
+ * always off, it is no pixel.
+ * @param buffer 160x80 bytes, row by row
+ * @return false before the rom set the lcd up, buffer is untouched then
+ */
+bool copy_lcd_buffer_ex(nc1020_t *nc, uint8_t *buffer){
+    uint8_t *lcd_buffer = get_lcd_buffer(nc);
+    if (lcd_buffer == NULL)
+        return false;
+
+    for (int y = 0; y < 80; y++) {
+        for (int j = 0; j < 20; j++) {
+            uint8_t p = lcd_buffer[20 * y + j];
+            for (int k = 0; k < 8; k++) {
+                buffer[y * 160 + j * 8 + k] = (uint8_t) ((p & (1u << (7u - k))) != 0 ? 0xFFu : 0x00);
+            }
+        }
+    }
+
+    for (int y = 0; y < 80; y++) {
+        buffer[y * 160] = 0;
+    }
+    return true;
+}
+
+uint8_t* get_ram_buffer(nc1020_t *nc){
+    return nc -> ram_buff;
+}
+
+
+/*
+ * Timed devices, the cpu runs uninterrupted up to the nearest stamp of them. The
+ * due ones are fired in this order, a new timed device only needs a slot here.
+ */
+typedef struct {
+    // the cycle stamp in this slice, NO_EVENT if nothing is scheduled.
+    uint64_t (*next_cycles)(nc1020_t *nc);
+    // @return cycles taken by the cpu
+    uint64_t (*fire)(nc1020_t *nc);
+} event_slot_t;
+
+static const uint64_t NO_EVENT = UINT64_MAX;
+
+static uint64_t timer0_next_cycles(nc1020_t *nc) {
+    return nc -> states.timer0_cycles;
+}
+
+static uint64_t fire_timer0(nc1020_t *nc) {
+	nc -> states.timer0_cycles += CYCLES_TIMER0;
+	nc -> states.timer0_toggle = !nc -> states.timer0_toggle;
+	if (!nc -> states.timer0_toggle) {
+        adjust_time(nc);
+	}
+	if (!is_count_down(nc) || nc -> states.timer0_toggle) {
+		write_io(nc, 0x3D, 0);
+	} else {
+        write_io(nc, 0x3D, 0x20);
+		nc -> states.clock_flags &= 0xFD;
+		// the alarm wakes the cpu, it takes the pending irq.
+		nc -> states.slept = false;
+	}
+	nc -> states.should_irq = true;
+	return 0;
+}
+
+// a pending irq is due at once, so the cpu only runs one more instruction before it.
+// a halted cpu keeps it pending until it wakes up.
+static uint64_t irq_next_cycles(nc1020_t *nc) {
+    return nc -> states.should_irq && !nc -> states.slept ? 0 : NO_EVENT;
+}
+
+static uint64_t fire_irq(nc1020_t *nc) {
+	nc -> states.should_irq = false;
+	return do_irq(nc -> cpu, &nc -> states.cpu);
+}
+
+static uint64_t timer1_next_cycles(nc1020_t *nc) {
+    return nc -> states.timer1_cycles;
+}
+
+static uint64_t fire_timer1(nc1020_t *nc) {
+	if (nc -> speed_up) {
+		nc -> states.timer1_cycles += CYCLES_TIMER1_SPEED_UP;
+	} else {
+		nc -> states.timer1_cycles += CYCLES_TIMER1;
+	}
+	nc -> clock_buff[4] ++;
+	if (nc -> states.should_wake_up) {
+		nc -> states.should_wake_up = false;
+        write_io(nc, 0x01, (uint8_t) (read_io(nc, 0x01) | 0x01u));
+        write_io(nc, 0x02, (uint8_t) (read_io(nc, 0x02) | 0x01u));
+		nc -> states.cpu.reg_pc = peek_word(nc, RESET_VEC);
+	} else {
+        write_io(nc, 0x01, (uint8_t) (read_io(nc, 0x01) | 0x08u));
+		nc -> states.should_irq = true;
+	}
+	return 0;
+}
+
+static const event_slot_t EVENT_SLOTS[] = {
+        {timer0_next_cycles, fire_timer0},
+        {irq_next_cycles, fire_irq},
+        {timer1_next_cycles, fire_timer1},
+};
+
+#define EVENT_SLOT_COUNT (sizeof(EVENT_SLOTS) / sizeof(EVENT_SLOTS[0]))
+
+/**
+ * The nearest cycle stamp in this slice at which an event is due, the cpu can run
+ * uninterrupted until then.
+ */
+static uint64_t next_event_cycles(nc1020_t *nc, uint64_t cycles, uint64_t end_cycles) {
+    uint64_t next_cycles = end_cycles;
+    for (size_t i = 0; i < EVENT_SLOT_COUNT; i++) {
+        uint64_t slot_cycles = EVENT_SLOTS[i].next_cycles(nc);
+        if (slot_cycles < next_cycles) {
+            next_cycles = slot_cycles;
+        }
+    }
+    return next_cycles > cycles ? next_cycles : cycles;
+}
+
+static void run_slice(nc1020_t *nc, uint64_t time_slice) {
+    uint64_t end_cycles = time_slice * CYCLES_MS;
+
+    uint64_t cycles = 0;
+
+	while (cycles < end_cycles) {
+		uint64_t next_cycles = next_event_cycles(nc, cycles, end_cycles);
+		if (nc -> states.slept) {
+			// the cpu is halted, nothing happens until the next event.
+			cycles = next_cycles;
+		} else {
+			cycles += execute_6502_until(nc -> cpu, &nc -> states.cpu, next_cycles - cycles);
+		}
+		for (size_t i = 0; i < EVENT_SLOT_COUNT; i++) {
+			if (cycles >= EVENT_SLOTS[i].next_cycles(nc)) {
+				cycles += EVENT_SLOTS[i].fire(nc);
+			}
+		}
+	}
+
+	nc -> states.cycles += cycles;
+	nc -> states.timer0_cycles -= end_cycles;
+	nc -> states.timer1_cycles -= end_cycles;
+}
+
+// runs on with the keys as they are to show what the next frame will, then goes back.
+static void run_ahead(nc1020_t *nc) {
+    if (nc -> ahead == NULL && (nc -> ahead = create_snapshot()) == NULL) {
+        return;
+    }
+    uint64_t cycles = nc -> states.cycles;
+    capture_machine(nc -> ahead, nc);
+    run_slice(nc, nc -> run_ahead_ms);
+    bool has_lcd = nc -> states.lcd_addr != 0;
+    if (has_lcd) {
+        memcpy(nc -> ahead_lcd, nc -> ram_buff + nc -> states.lcd_addr, LCD_SIZE);
+    }
+    restore_machine(nc -> ahead, nc);
+    nc -> ahead_cycles = has_lcd ? cycles : UINT64_MAX;
+}
+
+// the keys set since the last slice, in the order they came.
+static void apply_keys(nc1020_t *nc) {
+    uint8_t keys[KEY_QUEUE_SIZE];
+    pthread_mutex_lock(&nc -> key_lock);
+    uint32_t count = nc -> key_count;
+    memcpy(keys, nc -> key_queue, count);
+    nc -> key_count = 0;
+    pthread_mutex_unlock(&nc -> key_lock);
+    for (uint32_t i = 0; i < count; i++) {
+        apply_key(nc, keys[i] & 0x3Fu, (keys[i] & 0x80u) != 0);
+    }
+}
+
+void run_time_slice(nc1020_t *nc, uint64_t time_slice, bool speed_up) {
+    apply_keys(nc);
+    if (nc -> movie) {
+        record_slice(nc -> movie, time_slice, speed_up);
+    }
+    nc -> speed_up = speed_up;
+    run_slice(nc, time_slice);
+    if (nc -> rewind) {
+        tick_rewind(nc -> rewind, nc);
+    }
+    // a fast forward shows what it runs anyway.
+    if (nc -> run_ahead_ms && !speed_up) {
+        run_ahead(nc);
+    }
+}
@@ -5,13 +5,56 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-void initialize(const char * rom_file_path, const char *nor_file_path, const char *state_file_path);
-void reset();
-void set_key(uint8_t, bool);
-void run_time_slice(uint64_t, bool);
-uint8_t* get_lcd_buffer();
-void load_nc1020();
-void save_nc1020();
-uint64_t get_cycles();
+// one emulated machine, any number of them can run on different threads.
+typedef struct nc1020 nc1020_t;
+
+nc1020_t *create_nc1020();
+void destroy_nc1020(nc1020_t *nc);
+// false if the rom can't be loaded or a path is too long, the machine keeps what it had then.
+bool initialize(nc1020_t *nc, const char * rom_file_path, const char *nor_file_path, const char *state_file_path);
+void reset(nc1020_t *nc);
+// from any thread, the key is pressed or released at the start of the next slice.
+void set_key(nc1020_t *nc, uint8_t, bool);
+void run_time_slice(nc1020_t *nc, uint64_t, bool);
+uint8_t* get_lcd_buffer(nc1020_t *nc);
+// the lcd at one byte per pixel, 160x80, false before the rom set it up.
+bool copy_lcd_buffer_ex(nc1020_t *nc, uint8_t *buffer);
+uint8_t* get_ram_buffer(nc1020_t *nc);
+void load_nc1020(nc1020_t *nc);
+// copies the state and the changed nor, they are written in the background.
+void save_nc1020(nc1020_t *nc);
+// waits for the saves to be on disk, false if one failed.
+bool flush_nc1020(nc1020_t *nc);
+// keeps the nor file as a read only base shared by all machines and saves the changes
+// to the overlay file, from the next reset or load on. "" turns it off. False if the path
+// is too long, the machine keeps the overlay it had then.
+bool set_nor_overlay(nc1020_t *nc, const char *overlay_file_path);
+// drops the changes in the overlay and resets the machine with the base nor.
+bool reset_nor_overlay(nc1020_t *nc);
+// keeps a snapshot every interval_ms emulated in budget bytes to rewind to, 0 turns it off.
+void set_rewind(nc1020_t *nc, uint32_t interval_ms, uint32_t budget);
+// the snapshots there are to rewind to.
+uint32_t get_rewind_points(nc1020_t *nc);
+// goes back to a snapshot, 0 is the newest, and drops the newer ones.
+bool rewind_nc1020(nc1020_t *nc, uint32_t point);
+// shows the lcd run_ahead_ms further on with the keys held now, for less input lag. 0 turns it off.
+void set_run_ahead(nc1020_t *nc, uint32_t run_ahead_ms);
+// the local time in seconds since 1970 the clock syncs to on load, NULL for the host's.
+typedef int64_t (*nc1020_time_source_t)(void *context);
+void set_time_source(nc1020_t *nc, nc1020_time_source_t time_source, void *context);
+// only reads the files from the next reset or load on, for machines sharing them: saves
+// are dropped and a save a crash cut short is left to the machine that owns the files.
+void set_read_only(nc1020_t *nc, bool read_only);
+// records the keys and slices from the machine as it is now, for the same nor.
+bool start_movie(nc1020_t *nc, const char *movie_file_path);
+// puts the machine where the movie started, then run_movie_slice plays it on, false at its end.
+bool play_movie(nc1020_t *nc, const char *movie_file_path);
+bool run_movie_slice(nc1020_t *nc);
+// goes to the cycles in the movie playing, from the nearest keyframe kept in its index.
+bool seek_movie(nc1020_t *nc, uint64_t cycles);
+// ends the recording or playing, false if the file failed or the replay went out of sync.
+bool stop_movie(nc1020_t *nc);
+uint64_t get_cycles(nc1020_t *nc);
+bool is_sleeping(nc1020_t *nc);
 
 #endif /* NC1020_H_ */
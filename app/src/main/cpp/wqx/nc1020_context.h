@@ -0,0 +1,128 @@
+//
+// The state of one emulated machine, shared by nc1020.c and nc1020_io.c.
+//
+
+#ifndef NC1020_NC1020_CONTEXT_H
+#define NC1020_NC1020_CONTEXT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "cpu6502.h"
+#include "nc1020_states.h"
+#include "nc1020.h"
+
+#define ROM_SIZE (0x8000 * 0x300)
+#define NOR_SIZE (0x8000 * 0x20)
+// the nor is saved in sectors, the smallest part the flash erases.
+#define NOR_SECTOR_SIZE 0x800
+#define NOR_SECTORS (NOR_SIZE / NOR_SECTOR_SIZE)
+
+#define MAX_FILE_NAME_LENGTH 255
+
+#define LCD_SIZE 1600
+
+// the keys set between two slices, more are dropped.
+#define KEY_QUEUE_SIZE 256
+
+// a rom image, loaded once per file and shared read only by all machines using it.
+typedef struct nc1020_rom {
+    char file_path[MAX_FILE_NAME_LENGTH];
+    // the file, mapped read only.
+    uint8_t *buff;
+    int refs;
+    struct nc1020_rom *next;
+} nc1020_rom_t;
+
+struct nc1020 {
+    char nor_file_path[MAX_FILE_NAME_LENGTH];
+    char state_file_path[MAX_FILE_NAME_LENGTH];
+
+    nc1020_rom_t *rom;
+    // a private mapping, of the base file when there is an overlay.
+    uint8_t *nor_buff;
+    bool nor_mapped;
+    // the sectors changed since the nor was loaded or saved, one bit each.
+    uint64_t nor_dirty[NOR_SECTORS / 64];
+    // "" unless the nor file is a base with an overlay, see nc1020_overlay.h.
+    char overlay_file_path[MAX_FILE_NAME_LENGTH];
+    // the sectors that differ from the base, and the records the overlay has.
+    uint64_t nor_overlay[NOR_SECTORS / 64];
+    uint64_t overlay_records;
+    // the sectors changed since the last rewind snapshot.
+    uint64_t nor_rewind[NOR_SECTORS / 64];
+
+    uint8_t *nor_banks[0x20];
+    uint8_t *rom_volume0[0x100];
+    uint8_t *rom_volume1[0x100];
+    uint8_t *rom_volume2[0x100];
+    uint8_t *bbs_pages[0x10];
+
+    uint8_t *memmap[8];
+    uint8_t page_flags[8];
+    cpu6502_t *cpu;
+    // writes the saves in the background, started by the first one.
+    struct nc1020_saver *saver;
+    // the snapshots to rewind to, NULL unless turned on.
+    struct nc1020_rewind *rewind;
+    // while running ahead, what the nor had before.
+    struct nc1020_snapshot *nor_backup;
+
+    // the ms run ahead of every slice, 0 for none, and the frame shown then.
+    uint32_t run_ahead_ms;
+    struct nc1020_snapshot *ahead;
+    uint8_t ahead_lcd[LCD_SIZE];
+    // the cycles of the states the frame was run ahead of.
+    uint64_t ahead_cycles;
+
+    // the movie recording or playing, see nc1020_movie.h.
+    struct nc1020_movie *movie;
+    // the local time the clock syncs to, NULL for the host's.
+    nc1020_time_source_t time_source;
+    void *time_context;
+    // only reads its files, see set_read_only.
+    bool read_only;
+
+    nc1020_states_t states;
+    bool speed_up;
+
+    // the keys set since the last slice, the key id and 0x80 when down, see set_key.
+    pthread_mutex_t key_lock;
+    uint8_t key_queue[KEY_QUEUE_SIZE];
+    uint32_t key_count;
+
+    uint8_t *ram_buff;
+    uint8_t *ram_io;
+    uint8_t *ram_40;
+    uint8_t *ram_page0;
+    uint8_t *ram_page1;
+    uint8_t *ram_page2;
+    uint8_t *ram_page3;
+
+    uint8_t *clock_buff;
+    uint8_t *jg_wav_buff;
+    uint8_t *fp_buff;
+    uint8_t *bak_40;
+    uint8_t *keypad_matrix;
+};
+
+/*
+ * Banks are kept like in the rom and nor files, where the two 16K halves of every 32K
+ * bank are swapped. These give where the cpu's offset or 8K page of a bank is.
+ */
+static inline uint32_t get_bank_offset(uint32_t offset) {
+    return offset ^ 0x4000u;
+}
+
+static inline uint8_t *get_bank_page(uint8_t *bank, uint32_t page) {
+    return bank + ((page ^ 2u) << 13u);
+}
+
+// the memory callbacks of the cpu, for the pages it can't access directly.
+uint8_t load_memory(void *context, uint16_t addr);
+void store_memory(void *context, uint16_t addr, uint8_t value);
+
+// notes that the nor changed in these bytes, for saving and rewinding.
+void mark_nor_dirty(nc1020_t *nc, const uint8_t *ptr, uint32_t size);
+
+#endif //NC1020_NC1020_CONTEXT_H
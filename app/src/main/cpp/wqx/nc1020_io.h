@@ -4,11 +4,13 @@
 
 #ifndef NC1020_NC1020_IO_H
 #define NC1020_NC1020_IO_H
-#include "nc1020_states.h"
+#include "nc1020_context.h"
 
-void init_nc1020_io(nc1020_states_t *states, uint8_t rom_buff[], uint8_t nor_buff[], uint8_t* mmap[8]);
-uint8_t read_io(uint8_t addr);
-uint8_t write_io(uint8_t addr, uint8_t value);
-void switch_volume();
+// the rom must be set, the other tables point into the machine itself.
+void init_nc1020_io(nc1020_t *nc);
+uint8_t read_io(nc1020_t *nc, uint8_t addr);
+uint8_t write_io(nc1020_t *nc, uint8_t addr, uint8_t value);
+void switch_volume(nc1020_t *nc);
+void update_page_flags(nc1020_t *nc);
 
 #endif //NC1020_NC1020_IO_H
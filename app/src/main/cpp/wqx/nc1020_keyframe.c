@@ -0,0 +1,313 @@
+#include "nc1020_keyframe.h"
+#include "nc1020_io.h"
+#include "nc1020_state_file.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define KEYFRAME_MAGIC "NC1020KF"
+#define HEADER_SIZE 32u
+// the cycles, the position, the size of the payload and the checksum of both.
+#define RECORD_SIZE ((3u + KEYFRAME_POSITION_SIZE) * 8u)
+#define NOR_BITMAP_SIZE (NOR_SECTORS / 8u)
+// what the states and the nor of a keyframe may take at most.
+#define PAYLOAD_BOUND (8u + STATE_FILE_BOUND + NOR_BITMAP_SIZE + 8u + LZ_BOUND(NOR_SIZE))
+
+typedef struct {
+    uint64_t cycles;
+    off_t offset;
+} keyframe_entry_t;
+
+struct nc1020_keyframes {
+    int fd;
+    // a write failed, the index stays as it is.
+    bool failed;
+    uint64_t interval_cycles;
+    off_t end;
+
+    // the nor the movie starts from, the keyframes have what differs from it.
+    uint8_t *base;
+
+    keyframe_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+static void put_u64(uint8_t *p, uint64_t value) {
+    for (uint32_t i = 0; i < 8; i++) {
+        p[i] = (uint8_t) (value >> (i * 8u));
+    }
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        value |= (uint64_t) p[i] << (i * 8u);
+    }
+    return value;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3u;
+    }
+    return hash;
+}
+
+static uint64_t checksum_keyframe(const uint8_t *record, const uint8_t *payload, size_t size) {
+    uint64_t hash = hash_bytes(0xCBF29CE484222325u, record, RECORD_SIZE - 8u);
+    return hash_bytes(hash, payload, size);
+}
+
+static bool read_all(int fd, uint8_t *data, size_t size, off_t offset) {
+    while (size) {
+        ssize_t count = pread(fd, data, size, offset);
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= (size_t) count;
+        offset += count;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t size, off_t offset) {
+    while (size) {
+        ssize_t count = pwrite(fd, data, size, offset);
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= (size_t) count;
+        offset += count;
+    }
+    return true;
+}
+
+static void add_entry(nc1020_keyframes_t *keyframes, uint64_t cycles, off_t offset) {
+    if (keyframes -> count == keyframes -> capacity) {
+        uint32_t capacity = keyframes -> capacity ? keyframes -> capacity * 2 : 64;
+        keyframe_entry_t *entries = (keyframe_entry_t*) realloc(keyframes -> entries, capacity * sizeof(keyframe_entry_t));
+        if (entries == NULL) {
+            return;
+        }
+        keyframes -> entries = entries;
+        keyframes -> capacity = capacity;
+    }
+    keyframes -> entries[keyframes -> count].cycles = cycles;
+    keyframes -> entries[keyframes -> count].offset = offset;
+    keyframes -> count++;
+}
+
+/**
+ * Reads the record and payload of a keyframe at offset into payload, which holds PAYLOAD_BOUND bytes.
+ * @return the size of the payload, 0 if it is torn or damaged.
+ */
+static size_t read_keyframe(int fd, off_t offset, uint8_t *record, uint8_t *payload) {
+    if (!read_all(fd, record, RECORD_SIZE, offset)) {
+        return 0;
+    }
+    uint64_t size = get_u64(record + RECORD_SIZE - 16u);
+    if (size == 0 || size > PAYLOAD_BOUND || !read_all(fd, payload, (size_t) size, offset + RECORD_SIZE) ||
+            checksum_keyframe(record, payload, (size_t) size) != get_u64(record + RECORD_SIZE - 8u)) {
+        return 0;
+    }
+    return (size_t) size;
+}
+
+static bool load_index(nc1020_keyframes_t *keyframes, const uint8_t *header) {
+    uint8_t found[HEADER_SIZE];
+    if (!read_all(keyframes -> fd, found, HEADER_SIZE, 0) || memcmp(found, header, HEADER_SIZE) != 0) {
+        return false;
+    }
+    uint8_t record[RECORD_SIZE];
+    uint8_t *payload = (uint8_t*) malloc(PAYLOAD_BOUND);
+    if (payload == NULL) {
+        return false;
+    }
+    off_t offset = HEADER_SIZE;
+    size_t size;
+    while ((size = read_keyframe(keyframes -> fd, offset, record, payload)) != 0) {
+        uint64_t cycles = get_u64(record);
+        if (keyframes -> count && cycles <= keyframes -> entries[keyframes -> count - 1].cycles) {
+            break;
+        }
+        add_entry(keyframes, cycles, offset);
+        offset += (off_t) (RECORD_SIZE + size);
+    }
+    free(payload);
+    // what follows the last whole keyframe was torn.
+    keyframes -> end = offset;
+    return ftruncate(keyframes -> fd, offset) == 0;
+}
+
+nc1020_keyframes_t *open_keyframes(const char *index_file_path, uint64_t movie_hash,
+                                   uint64_t interval_cycles, const nc1020_t *nc) {
+    nc1020_keyframes_t *keyframes = (nc1020_keyframes_t*) calloc(1, sizeof(nc1020_keyframes_t));
+    if (keyframes == NULL) {
+        return NULL;
+    }
+    keyframes -> interval_cycles = interval_cycles;
+    keyframes -> base = (uint8_t*) malloc(NOR_SIZE);
+    keyframes -> fd = open(index_file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (keyframes -> base == NULL || keyframes -> fd < 0) {
+        close_keyframes(keyframes);
+        return NULL;
+    }
+    memcpy(keyframes -> base, nc -> nor_buff, NOR_SIZE);
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, KEYFRAME_MAGIC, 8);
+    put_u64(header + 8, KEYFRAME_VERSION);
+    put_u64(header + 16, movie_hash);
+    put_u64(header + 24, interval_cycles);
+    if (!load_index(keyframes, header)) {
+        keyframes -> count = 0;
+        keyframes -> end = HEADER_SIZE;
+        if (ftruncate(keyframes -> fd, 0) != 0 || !write_all(keyframes -> fd, header, HEADER_SIZE, 0)) {
+            close_keyframes(keyframes);
+            return NULL;
+        }
+    }
+    return keyframes;
+}
+
+void close_keyframes(nc1020_keyframes_t *keyframes) {
+    if (keyframes -> fd >= 0) {
+        close(keyframes -> fd);
+    }
+    free(keyframes -> base);
+    free(keyframes -> entries);
+    free(keyframes);
+}
+
+// the states, the bitmap of the sectors that differ from the base and those sectors compressed.
+static size_t encode_keyframe(const nc1020_keyframes_t *keyframes, const nc1020_t *nc, uint8_t *payload,
+                              uint8_t *sectors) {
+    size_t state_size = encode_states(&nc -> states, payload + 8);
+    put_u64(payload, state_size);
+    uint8_t *bitmap = payload + 8 + state_size;
+    memset(bitmap, 0, NOR_BITMAP_SIZE);
+    size_t sectors_size = 0;
+    for (uint32_t i = 0; i < NOR_SECTORS; i++) {
+        const uint8_t *sector = nc -> nor_buff + i * NOR_SECTOR_SIZE;
+        if (memcmp(sector, keyframes -> base + i * NOR_SECTOR_SIZE, NOR_SECTOR_SIZE) != 0) {
+            bitmap[i / 8] |= (uint8_t) (1u << (i % 8));
+            memcpy(sectors + sectors_size, sector, NOR_SECTOR_SIZE);
+            sectors_size += NOR_SECTOR_SIZE;
+        }
+    }
+    uint8_t *nor = bitmap + NOR_BITMAP_SIZE;
+    size_t nor_size = sectors_size ? lz_compress(sectors, sectors_size, nor + 8, LZ_BOUND(NOR_SIZE)) : 0;
+    put_u64(nor, nor_size);
+    return (size_t) (nor + 8 + nor_size - payload);
+}
+
+void tick_keyframes(nc1020_keyframes_t *keyframes, const nc1020_t *nc,
+                    const uint64_t position[KEYFRAME_POSITION_SIZE]) {
+    if (keyframes -> failed || (keyframes -> count &&
+            nc -> states.cycles < keyframes -> entries[keyframes -> count - 1].cycles + keyframes -> interval_cycles)) {
+        return;
+    }
+    uint8_t record[RECORD_SIZE];
+    uint8_t *payload = (uint8_t*) malloc(PAYLOAD_BOUND);
+    uint8_t *sectors = (uint8_t*) malloc(NOR_SIZE);
+    if (payload == NULL || sectors == NULL) {
+        free(payload);
+        free(sectors);
+        return;
+    }
+    size_t size = encode_keyframe(keyframes, nc, payload, sectors);
+    put_u64(record, nc -> states.cycles);
+    for (uint32_t i = 0; i < KEYFRAME_POSITION_SIZE; i++) {
+        put_u64(record + 8 + i * 8, position[i]);
+    }
+    put_u64(record + RECORD_SIZE - 16u, size);
+    put_u64(record + RECORD_SIZE - 8u, checksum_keyframe(record, payload, size));
+    if (write_all(keyframes -> fd, record, RECORD_SIZE, keyframes -> end) &&
+            write_all(keyframes -> fd, payload, size, keyframes -> end + RECORD_SIZE)) {
+        add_entry(keyframes, nc -> states.cycles, keyframes -> end);
+        keyframes -> end += (off_t) (RECORD_SIZE + size);
+    } else {
+        keyframes -> failed = true;
+    }
+    free(payload);
+    free(sectors);
+}
+
+// the index of the newest keyframe at or before cycles, -1 if there is none.
+static int64_t search_keyframe(const nc1020_keyframes_t *keyframes, uint64_t cycles) {
+    int64_t low = 0;
+    int64_t high = (int64_t) keyframes -> count - 1;
+    int64_t found = -1;
+    while (low <= high) {
+        int64_t middle = (low + high) / 2;
+        if (keyframes -> entries[middle].cycles <= cycles) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+uint64_t find_keyframe(const nc1020_keyframes_t *keyframes, uint64_t cycles) {
+    int64_t found = search_keyframe(keyframes, cycles);
+    return found < 0 ? UINT64_MAX : keyframes -> entries[found].cycles;
+}
+
+bool restore_keyframe(nc1020_keyframes_t *keyframes, nc1020_t *nc, uint64_t cycles,
+                      uint64_t position[KEYFRAME_POSITION_SIZE]) {
+    int64_t found = search_keyframe(keyframes, cycles);
+    if (found < 0) {
+        return false;
+    }
+    uint8_t record[RECORD_SIZE];
+    uint8_t *payload = (uint8_t*) malloc(PAYLOAD_BOUND);
+    uint8_t *sectors = (uint8_t*) malloc(NOR_SIZE);
+    nc1020_states_t states = nc -> states;
+    bool decoded = false;
+    size_t size;
+    if (payload && sectors &&
+            (size = read_keyframe(keyframes -> fd, keyframes -> entries[found].offset, record, payload)) != 0) {
+        uint64_t state_size = get_u64(payload);
+        const uint8_t *bitmap = payload + 8 + state_size;
+        uint32_t changed = 0;
+        for (uint32_t i = 0; state_size + 8 + NOR_BITMAP_SIZE + 8 <= size && i < NOR_BITMAP_SIZE; i++) {
+            changed += (uint32_t) __builtin_popcount(bitmap[i]);
+        }
+        const uint8_t *nor = bitmap + NOR_BITMAP_SIZE;
+        decoded = state_size + 8 + NOR_BITMAP_SIZE + 8 <= size &&
+                get_u64(nor) == size - (state_size + 8 + NOR_BITMAP_SIZE + 8) &&
+                decode_states(payload + 8, (size_t) state_size, &states) &&
+                (changed == 0 || lz_decompress(nor + 8, (size_t) get_u64(nor), sectors, changed * NOR_SECTOR_SIZE));
+        // only the sectors that differ from the keyframe are written.
+        const uint8_t *next = sectors;
+        for (uint32_t i = 0; decoded && i < NOR_SECTORS; i++) {
+            const uint8_t *sector = keyframes -> base + i * NOR_SECTOR_SIZE;
+            if ((bitmap[i / 8] >> (i % 8)) & 1u) {
+                sector = next;
+                next += NOR_SECTOR_SIZE;
+            }
+            uint8_t *target = nc -> nor_buff + i * NOR_SECTOR_SIZE;
+            if (memcmp(target, sector, NOR_SECTOR_SIZE) != 0) {
+                memcpy(target, sector, NOR_SECTOR_SIZE);
+                mark_nor_dirty(nc, target, NOR_SECTOR_SIZE);
+                invalidate_6502_code(nc -> cpu, target, NOR_SECTOR_SIZE);
+            }
+        }
+    }
+    if (decoded) {
+        nc -> states = states;
+        switch_volume(nc);
+        for (uint32_t i = 0; i < KEYFRAME_POSITION_SIZE; i++) {
+            position[i] = get_u64(record + 8 + i * 8);
+        }
+    }
+    free(payload);
+    free(sectors);
+    return decoded;
+}
@@ -0,0 +1,46 @@
+//
+// The keyframe index of a movie, a side file of whole machines taken every so many
+// cycles while it plays, to seek in it without playing it from the start. A keyframe
+// has the encoded states, the sectors of the nor that differ from where the movie
+// started, compressed, and where the movie was in its records. The index names the
+// movie by a hash of it and is appended to as playing reaches past its last keyframe,
+// so it grows over the plays and a torn one is cut back to its last whole keyframe.
+//
+
+#ifndef NC1020_NC1020_KEYFRAME_H
+#define NC1020_NC1020_KEYFRAME_H
+
+#include "nc1020_context.h"
+
+#define KEYFRAME_VERSION 1
+
+// the values the movie keeps of where it is, stored with each keyframe.
+#define KEYFRAME_POSITION_SIZE 5
+
+typedef struct nc1020_keyframes nc1020_keyframes_t;
+
+/**
+ * Opens the index of a movie starting from nc as it is now, starting it over if it is
+ * of another movie or interval.
+ * @return NULL if it can't be read or written.
+ */
+nc1020_keyframes_t *open_keyframes(const char *index_file_path, uint64_t movie_hash,
+                                   uint64_t interval_cycles, const nc1020_t *nc);
+
+void close_keyframes(nc1020_keyframes_t *keyframes);
+
+// appends a keyframe once the interval passed since the last one in the index.
+void tick_keyframes(nc1020_keyframes_t *keyframes, const nc1020_t *nc,
+                    const uint64_t position[KEYFRAME_POSITION_SIZE]);
+
+// the cycles of the newest keyframe at or before cycles, UINT64_MAX if there is none.
+uint64_t find_keyframe(const nc1020_keyframes_t *keyframes, uint64_t cycles);
+
+/**
+ * Puts nc and the position back to the newest keyframe at or before cycles.
+ * @return false if there is none or it can't be read, nc is untouched then.
+ */
+bool restore_keyframe(nc1020_keyframes_t *keyframes, nc1020_t *nc, uint64_t cycles,
+                      uint64_t position[KEYFRAME_POSITION_SIZE]);
+
+#endif //NC1020_NC1020_KEYFRAME_H
@@ -0,0 +1,142 @@
+#include "nc1020_lz.h"
+#include <string.h>
+
+#define MIN_MATCH 4u
+#define MAX_OFFSET 0xFFFFu
+#define HASH_BITS 12u
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8u | (uint32_t) p[2] << 16u | (uint32_t) p[3] << 24u;
+}
+
+static uint32_t hash_u32(uint32_t value) {
+    return (value * 2654435761u) >> (32u - HASH_BITS);
+}
+
+// the part of a length beyond its nibble, as bytes of 255 and a last one below.
+static uint8_t *put_length(uint8_t *op, size_t length) {
+    while (length >= 0xFF) {
+        *op++ = 0xFF;
+        length -= 0xFF;
+    }
+    *op++ = (uint8_t) length;
+    return op;
+}
+
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *literals, size_t literal_length,
+                             size_t offset, size_t match_length) {
+    uint8_t *token = op++;
+    *token = (uint8_t) ((literal_length < 15 ? literal_length : 15) << 4u);
+    if (literal_length >= 15) {
+        op = put_length(op, literal_length - 15);
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) {
+        return op;
+    }
+    *op++ = (uint8_t) offset;
+    *op++ = (uint8_t) (offset >> 8u);
+    match_length -= MIN_MATCH;
+    *token |= (uint8_t) (match_length < 15 ? match_length : 15);
+    if (match_length >= 15) {
+        op = put_length(op, match_length - 15);
+    }
+    return op;
+}
+
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+    if (capacity < LZ_BOUND(size)) {
+        return 0;
+    }
+    // positions + 1, 0 is none.
+    uint32_t table[1u << HASH_BITS];
+    memset(table, 0, sizeof(table));
+    const uint8_t *end = src + size;
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    uint8_t *op = dst;
+    while (ip + MIN_MATCH <= end) {
+        uint32_t sequence = read_u32(ip);
+        uint32_t hash = hash_u32(sequence);
+        uint32_t candidate = table[hash];
+        table[hash] = (uint32_t) (ip - src) + 1;
+        // a run of one byte matches itself one back, which the table would miss.
+        const uint8_t *match = NULL;
+        if (ip > src && ip[-1] == ip[0] && sequence == ip[0] * 0x01010101u) {
+            match = ip - 1;
+        } else if (candidate && (size_t) (ip - src) + 1 - candidate <= MAX_OFFSET &&
+                read_u32(src + candidate - 1) == sequence) {
+            match = src + candidate - 1;
+        }
+        if (match == NULL) {
+            ip++;
+            continue;
+        }
+        size_t length = MIN_MATCH;
+        while (ip + length < end && match[length] == ip[length]) {
+            length++;
+        }
+        op = put_sequence(op, anchor, (size_t) (ip - anchor), (size_t) (ip - match), length);
+        ip += length;
+        anchor = ip;
+    }
+    op = put_sequence(op, anchor, (size_t) (end - anchor), 0, 0);
+    return (size_t) (op - dst);
+}
+
+static bool get_length(const uint8_t **ip, const uint8_t *end, size_t *length) {
+    uint8_t byte;
+    do {
+        if (*ip >= end) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 0xFF);
+    return true;
+}
+
+bool lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + size;
+    uint8_t *op = dst;
+    uint8_t *op_end = dst + dst_size;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literal_length = token >> 4u;
+        if (literal_length == 15 && !get_length(&ip, end, &literal_length)) {
+            return false;
+        }
+        if (literal_length > (size_t) (end - ip) || literal_length > (size_t) (op_end - op)) {
+            return false;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        // the last sequence has no match.
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = (size_t) ip[0] | (size_t) ip[1] << 8u;
+        ip += 2;
+        size_t match_length = token & 0x0Fu;
+        if (match_length == 15 && !get_length(&ip, end, &match_length)) {
+            return false;
+        }
+        match_length += MIN_MATCH;
+        if (offset == 0 || offset > (size_t) (op - dst) || match_length > (size_t) (op_end - op)) {
+            return false;
+        }
+        // byte by byte, the match may overlap what it writes.
+        const uint8_t *match = op - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+    return op == op_end;
+}
@@ -0,0 +1,23 @@
+//
+// A small lz77 compressor for states, in the block format of lz4: a token with the
+// lengths of the literals and of the match in its nibbles, the literals, the offset of
+// the match back from the end of the output. Overlapping matches make runs.
+//
+
+#ifndef NC1020_NC1020_LZ_H
+#define NC1020_NC1020_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// what compressing size bytes may take at worst.
+#define LZ_BOUND(size) ((size) + (size) / 255u + 16u)
+
+// compresses src into dst, returns the compressed size, 0 if it doesn't fit in capacity.
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+// false unless src decompresses to exactly dst_size bytes.
+bool lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
+
+#endif //NC1020_NC1020_LZ_H
@@ -0,0 +1,327 @@
+#include "nc1020_movie.h"
+#include "nc1020_io.h"
+#include "nc1020_state_file.h"
+#include "nc1020_keyframe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOVIE_MAGIC "NC1020MV"
+// the magic, version, hash of the nor and size of the states come before them.
+#define STATES_OFFSET 32
+
+// the kind of a record is in its low bits, the key is down or the slice fast with the top one.
+#define RECORD_END 0
+#define RECORD_SLICE 1
+#define RECORD_KEY 2
+#define RECORD_FLAG 0x80u
+
+#define MAX_VARINT_SIZE 10
+#define INDEX_SUFFIX ".idx"
+#define MAX_PATH_LENGTH (MAX_FILE_NAME_LENGTH + 16)
+
+struct nc1020_movie {
+    // the recording, NULL when playing.
+    FILE *file;
+    // a write failed, or the replay went out of sync.
+    bool failed;
+    // the cycles of the last key, or of the start.
+    uint64_t cycles;
+
+    // the run of equal slices not written yet, or left to play.
+    uint64_t slice_ms;
+    bool slice_speed_up;
+    uint64_t slice_count;
+
+    uint8_t *data;
+    size_t size;
+    size_t offset;
+    bool ended;
+    // the keyframes to seek with, NULL if the index can't be written.
+    nc1020_keyframes_t *keyframes;
+};
+
+static uint64_t hash_nor(const nc1020_t *nc) {
+    uint64_t hash = 0xCBF29CE484222325u;
+    for (uint32_t i = 0; i < NOR_SIZE; i++) {
+        hash = (hash ^ nc -> nor_buff[i]) * 0x100000001B3u;
+    }
+    return hash;
+}
+
+static void put_u64(uint8_t *p, uint64_t value) {
+    for (uint32_t i = 0; i < 8; i++) {
+        p[i] = (uint8_t) (value >> (i * 8u));
+    }
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        value |= (uint64_t) p[i] << (i * 8u);
+    }
+    return value;
+}
+
+static void write_bytes(nc1020_movie_t *movie, const uint8_t *data, size_t size) {
+    if (fwrite(data, 1, size, movie -> file) != size) {
+        movie -> failed = true;
+    }
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t) (value | 0x80u);
+        value >>= 7u;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static bool get_varint(nc1020_movie_t *movie, uint64_t *value) {
+    *value = 0;
+    for (uint32_t shift = 0; movie -> offset < movie -> size && shift < 64; shift += 7) {
+        uint8_t byte = movie -> data[movie -> offset++];
+        *value |= (uint64_t) (byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+nc1020_movie_t *record_movie(nc1020_t *nc, const char *movie_file_path) {
+    nc1020_movie_t *movie = (nc1020_movie_t*) calloc(1, sizeof(nc1020_movie_t));
+    uint8_t *state = (uint8_t*) malloc(STATE_FILE_BOUND);
+    if (movie == NULL || state == NULL || (movie -> file = fopen(movie_file_path, "wbe")) == NULL) {
+        free(movie);
+        free(state);
+        return NULL;
+    }
+    movie -> cycles = nc -> states.cycles;
+    uint8_t header[24];
+    memcpy(header, MOVIE_MAGIC, 8);
+    put_u64(header + 8, MOVIE_VERSION);
+    put_u64(header + 16, hash_nor(nc));
+    write_bytes(movie, header, sizeof(header));
+    uint8_t size[8];
+    put_u64(size, encode_states(&nc -> states, state));
+    write_bytes(movie, size, sizeof(size));
+    write_bytes(movie, state, (size_t) get_u64(size));
+    free(state);
+    return movie;
+}
+
+static void flush_slices(nc1020_movie_t *movie) {
+    if (movie -> slice_count == 0) {
+        return;
+    }
+    uint8_t record[1 + 2 * MAX_VARINT_SIZE];
+    record[0] = (uint8_t) (RECORD_SLICE | (movie -> slice_speed_up ? RECORD_FLAG : 0));
+    uint8_t *end = put_varint(record + 1, movie -> slice_ms);
+    end = put_varint(end, movie -> slice_count);
+    write_bytes(movie, record, (size_t) (end - record));
+    movie -> slice_count = 0;
+}
+
+void record_key(nc1020_movie_t *movie, nc1020_t *nc, uint8_t key_id, bool down_or_up) {
+    if (movie -> file == NULL) {
+        return;
+    }
+    flush_slices(movie);
+    uint8_t record[2 + MAX_VARINT_SIZE];
+    record[0] = (uint8_t) (RECORD_KEY | (down_or_up ? RECORD_FLAG : 0));
+    record[1] = key_id;
+    uint8_t *end = put_varint(record + 2, nc -> states.cycles - movie -> cycles);
+    write_bytes(movie, record, (size_t) (end - record));
+    movie -> cycles = nc -> states.cycles;
+}
+
+void record_slice(nc1020_movie_t *movie, uint64_t time_slice, bool speed_up) {
+    if (movie -> file == NULL) {
+        return;
+    }
+    if (movie -> slice_count && (movie -> slice_ms != time_slice || movie -> slice_speed_up != speed_up)) {
+        flush_slices(movie);
+    }
+    movie -> slice_ms = time_slice;
+    movie -> slice_speed_up = speed_up;
+    movie -> slice_count++;
+}
+
+static uint8_t *read_file(const char *file_path, size_t *size) {
+    FILE *file = fopen(file_path, "rbe");
+    if (file == NULL) {
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    long length;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0 &&
+            (data = (uint8_t*) malloc((size_t) length)) != NULL &&
+            fread(data, 1, (size_t) length, file) != (size_t) length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t) length : 0;
+    return data;
+}
+
+static void get_position(const nc1020_movie_t *movie, uint64_t position[KEYFRAME_POSITION_SIZE]) {
+    position[0] = movie -> offset;
+    position[1] = movie -> cycles;
+    position[2] = movie -> slice_ms;
+    position[3] = movie -> slice_count;
+    position[4] = movie -> slice_speed_up;
+}
+
+static bool set_position(nc1020_movie_t *movie, const uint64_t position[KEYFRAME_POSITION_SIZE]) {
+    if (position[0] < STATES_OFFSET || position[0] > movie -> size) {
+        return false;
+    }
+    movie -> offset = (size_t) position[0];
+    movie -> cycles = position[1];
+    movie -> slice_ms = position[2];
+    movie -> slice_count = position[3];
+    movie -> slice_speed_up = position[4] != 0;
+    movie -> ended = false;
+    return true;
+}
+
+nc1020_movie_t *open_movie(nc1020_t *nc, const char *movie_file_path, uint64_t keyframe_cycles) {
+    size_t size;
+    uint8_t *data = read_file(movie_file_path, &size);
+    if (data == NULL || size < STATES_OFFSET || memcmp(data, MOVIE_MAGIC, 8) != 0 || get_u64(data + 8) != MOVIE_VERSION ||
+            get_u64(data + 16) != hash_nor(nc) || get_u64(data + 24) > size - STATES_OFFSET) {
+        free(data);
+        return NULL;
+    }
+    size_t state_size = (size_t) get_u64(data + 24);
+    nc1020_states_t states = nc -> states;
+    nc1020_movie_t *movie = (nc1020_movie_t*) calloc(1, sizeof(nc1020_movie_t));
+    if (movie == NULL || !decode_states(data + STATES_OFFSET, state_size, &states)) {
+        free(movie);
+        free(data);
+        return NULL;
+    }
+    nc -> states = states;
+    switch_volume(nc);
+    movie -> cycles = nc -> states.cycles;
+    movie -> data = data;
+    movie -> size = size;
+    movie -> offset = STATES_OFFSET + state_size;
+
+    // a path too long for the index plays without keyframes.
+    char index_file_path[MAX_PATH_LENGTH];
+    int length = snprintf(index_file_path, sizeof(index_file_path), "%s" INDEX_SUFFIX, movie_file_path);
+    if (length >= 0 && length < MAX_PATH_LENGTH) {
+        uint64_t movie_hash = 0xCBF29CE484222325u;
+        for (size_t i = 0; i < size; i++) {
+            movie_hash = (movie_hash ^ data[i]) * 0x100000001B3u;
+        }
+        movie -> keyframes = open_keyframes(index_file_path, movie_hash, keyframe_cycles, nc);
+    }
+    if (movie -> keyframes) {
+        uint64_t position[KEYFRAME_POSITION_SIZE];
+        get_position(movie, position);
+        tick_keyframes(movie -> keyframes, nc, position);
+    }
+    return movie;
+}
+
+// reads the next record, false once there are no more.
+static bool play_record(nc1020_movie_t *movie, nc1020_t *nc) {
+    if (movie -> offset >= movie -> size) {
+        movie -> failed = true;
+        return false;
+    }
+    uint8_t tag = movie -> data[movie -> offset++];
+    uint64_t value;
+    switch (tag & ~RECORD_FLAG) {
+        case RECORD_KEY: {
+            if (movie -> offset >= movie -> size) {
+                movie -> failed = true;
+                return false;
+            }
+            uint8_t key_id = movie -> data[movie -> offset++];
+            // a key coming at other cycles than it was recorded at means the replay is off.
+            if (!get_varint(movie, &value) || movie -> cycles + value != nc -> states.cycles) {
+                movie -> failed = true;
+                return false;
+            }
+            movie -> cycles += value;
+            set_key(nc, key_id, (tag & RECORD_FLAG) != 0);
+            return true;
+        }
+        case RECORD_SLICE:
+            if (!get_varint(movie, &movie -> slice_ms) || !get_varint(movie, &movie -> slice_count)) {
+                movie -> failed = true;
+                return false;
+            }
+            movie -> slice_speed_up = (tag & RECORD_FLAG) != 0;
+            return true;
+        default:
+            // the end has the cycles the machine stopped at.
+            movie -> failed = movie -> failed || tag != RECORD_END || !get_varint(movie, &value) ||
+                    value != nc -> states.cycles;
+            return false;
+    }
+}
+
+bool play_movie_slice(nc1020_movie_t *movie, nc1020_t *nc) {
+    while (!movie -> ended && movie -> slice_count == 0) {
+        movie -> ended = !play_record(movie, nc);
+    }
+    if (movie -> ended) {
+        return false;
+    }
+    movie -> slice_count--;
+    run_time_slice(nc, movie -> slice_ms, movie -> slice_speed_up);
+    if (movie -> keyframes) {
+        uint64_t position[KEYFRAME_POSITION_SIZE];
+        get_position(movie, position);
+        tick_keyframes(movie -> keyframes, nc, position);
+    }
+    return true;
+}
+
+bool play_movie_to(nc1020_movie_t *movie, nc1020_t *nc, uint64_t cycles) {
+    if (movie -> file) {
+        return false;
+    }
+    // a keyframe is restored unless playing on from here is shorter.
+    uint64_t keyframe = movie -> keyframes ? find_keyframe(movie -> keyframes, cycles) : UINT64_MAX;
+    if (keyframe != UINT64_MAX && (nc -> states.cycles > cycles || nc -> states.cycles < keyframe)) {
+        uint64_t position[KEYFRAME_POSITION_SIZE];
+        if (!restore_keyframe(movie -> keyframes, nc, cycles, position) || !set_position(movie, position)) {
+            return false;
+        }
+    } else if (nc -> states.cycles > cycles) {
+        return false;
+    }
+    while (nc -> states.cycles < cycles) {
+        if (!play_movie_slice(movie, nc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool close_movie(nc1020_movie_t *movie, nc1020_t *nc) {
+    bool closed = true;
+    if (movie -> file) {
+        flush_slices(movie);
+        uint8_t record[1 + MAX_VARINT_SIZE];
+        record[0] = RECORD_END;
+        uint8_t *end = put_varint(record + 1, nc -> states.cycles);
+        write_bytes(movie, record, (size_t) (end - record));
+        closed = fclose(movie -> file) == 0;
+    }
+    closed = closed && !movie -> failed;
+    if (movie -> keyframes) {
+        close_keyframes(movie -> keyframes);
+    }
+    free(movie -> data);
+    free(movie);
+    return closed;
+}
@@ -0,0 +1,48 @@
+//
+// Movies: the keys pressed on a machine and the slices it ran, to run it again exactly.
+// A movie starts with the hash of the nor and the states, which have the clock in them,
+// then has a record for each key with the cycles it came at, and for each run of equal
+// slices. Playing one puts the states back, runs the same slices and presses the keys
+// once the cycles are there, and checks they are, so it can run headless at any speed.
+//
+
+#ifndef NC1020_NC1020_MOVIE_H
+#define NC1020_NC1020_MOVIE_H
+
+#include "nc1020_context.h"
+
+#define MOVIE_VERSION 2
+
+typedef struct nc1020_movie nc1020_movie_t;
+
+// starts writing a movie of nc from where it is, NULL if the file can't be written.
+nc1020_movie_t *record_movie(nc1020_t *nc, const char *movie_file_path);
+
+// nothing unless the movie is recording.
+void record_key(nc1020_movie_t *movie, nc1020_t *nc, uint8_t key_id, bool down_or_up);
+void record_slice(nc1020_movie_t *movie, uint64_t time_slice, bool speed_up);
+
+/**
+ * Opens a movie to play and puts nc where it starts. Playing it keeps a keyframe every
+ * keyframe_cycles in the index next to it, see nc1020_keyframe.h.
+ * @return NULL if it can't be read, isn't a movie or was recorded on another nor.
+ */
+nc1020_movie_t *open_movie(nc1020_t *nc, const char *movie_file_path, uint64_t keyframe_cycles);
+
+// presses the keys due and runs the next slice, false at the end or once out of sync.
+bool play_movie_slice(nc1020_movie_t *movie, nc1020_t *nc);
+
+/**
+ * Seeks to the first slice that ends at or after cycles, from the newest keyframe before
+ * them or from where the movie is, whichever is closer.
+ * @return false if the movie ends or goes out of sync first, or can't go back that far.
+ */
+bool play_movie_to(nc1020_movie_t *movie, nc1020_t *nc, uint64_t cycles);
+
+/**
+ * Ends the movie, writing what is left of a recording.
+ * @return false if a recording failed to write or a replay went out of sync.
+ */
+bool close_movie(nc1020_movie_t *movie, nc1020_t *nc);
+
+#endif //NC1020_NC1020_MOVIE_H
@@ -0,0 +1,237 @@
+#include "nc1020_overlay.h"
+#include "nc1020_save.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OVERLAY_MAGIC "NC1020NO"
+#define OVERLAY_VERSION 1
+#define TEMP_SUFFIX ".tmp"
+#define MAX_PATH_LENGTH (MAX_FILE_NAME_LENGTH + 16)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t sector_size;
+} overlay_header_t;
+
+// a sector of data follows unless it was erased.
+#define RECORD_DATA 0
+#define RECORD_ERASED 1
+
+typedef struct {
+    uint16_t sector;
+    uint8_t kind;
+    uint8_t reserved;
+    // of the record with its data, so a torn write at the end is found.
+    uint32_t checksum;
+} overlay_record_t;
+
+static uint32_t checksum_record(const overlay_record_t *record, const uint8_t *data) {
+    uint32_t hash = 0x811C9DC5u;
+    hash = (hash ^ (record -> sector & 0xFFu)) * 0x01000193u;
+    hash = (hash ^ (record -> sector >> 8u)) * 0x01000193u;
+    hash = (hash ^ record -> kind) * 0x01000193u;
+    if (record -> kind == RECORD_DATA) {
+        for (uint32_t i = 0; i < NOR_SECTOR_SIZE; i++) {
+            hash = (hash ^ data[i]) * 0x01000193u;
+        }
+    }
+    return hash;
+}
+
+static bool is_erased(const uint8_t *data) {
+    for (uint32_t i = 0; i < NOR_SECTOR_SIZE; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void init_header(overlay_header_t *header) {
+    memset(header, 0, sizeof(overlay_header_t));
+    memcpy(header -> magic, OVERLAY_MAGIC, sizeof(header -> magic));
+    header -> version = OVERLAY_VERSION;
+    header -> sector_size = NOR_SECTOR_SIZE;
+}
+
+static void map_base(nc1020_t *nc) {
+    int fd = open(nc -> nor_file_path, O_RDONLY | O_CLOEXEC);
+    struct stat file_stat;
+    if (fd >= 0 && fstat(fd, &file_stat) == 0 && file_stat.st_size >= NOR_SIZE &&
+            mmap(nc -> nor_buff, NOR_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        nc -> nor_mapped = true;
+    } else {
+        // a short base can't be mapped, what there is of it is read. Pages of an earlier
+        // base that can't be remapped are made the machine's own by touching them.
+        if (mmap(nc -> nor_buff, NOR_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+            memset(nc -> nor_buff, 0, NOR_SIZE);
+        }
+        nc -> nor_mapped = false;
+        if (fd >= 0) {
+            pread(fd, nc -> nor_buff, NOR_SIZE, 0);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void load_nor_overlay(nc1020_t *nc) {
+    map_base(nc);
+    memset(nc -> nor_dirty, 0, sizeof(nc -> nor_dirty));
+    memset(nc -> nor_overlay, 0, sizeof(nc -> nor_overlay));
+    nc -> overlay_records = 0;
+
+    FILE *file = fopen(nc -> overlay_file_path, "r+be");
+    if (file == NULL) {
+        return;
+    }
+    overlay_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, OVERLAY_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != OVERLAY_VERSION || header.sector_size != NOR_SECTOR_SIZE) {
+        fclose(file);
+        return;
+    }
+    overlay_record_t record;
+    uint8_t data[NOR_SECTOR_SIZE];
+    long end = ftell(file);
+    while (fread(&record, sizeof(record), 1, file) == 1 && record.sector < NOR_SECTORS) {
+        if (record.kind == RECORD_DATA) {
+            if (fread(data, NOR_SECTOR_SIZE, 1, file) != 1) {
+                break;
+            }
+        } else if (record.kind != RECORD_ERASED) {
+            break;
+        }
+        if (checksum_record(&record, data) != record.checksum) {
+            break;
+        }
+        uint8_t *sector = nc -> nor_buff + record.sector * NOR_SECTOR_SIZE;
+        if (record.kind == RECORD_DATA) {
+            memcpy(sector, data, NOR_SECTOR_SIZE);
+        } else {
+            memset(sector, 0xFF, NOR_SECTOR_SIZE);
+        }
+        nc -> nor_overlay[record.sector / 64] |= 1ull << (record.sector % 64);
+        nc -> overlay_records++;
+        end = ftell(file);
+    }
+    // what follows the last whole record was torn by a crash.
+    fflush(file);
+    if (ftruncate(fileno(file), end) == 0) {
+        fsync(fileno(file));
+    }
+    fclose(file);
+}
+
+// the records of the sectors of nor in one buffer, with the header if asked, NULL without memory.
+static uint8_t *build_records(const uint64_t *sectors, const uint8_t *nor, bool with_header, size_t *size) {
+    size_t capacity = sizeof(overlay_header_t);
+    for (uint32_t i = 0; sectors && i < NOR_SECTORS / 64; i++) {
+        capacity += (size_t) __builtin_popcountll(sectors[i]) * (sizeof(overlay_record_t) + NOR_SECTOR_SIZE);
+    }
+    uint8_t *buffer = (uint8_t*) malloc(capacity);
+    *size = 0;
+    if (buffer == NULL) {
+        return NULL;
+    }
+    if (with_header) {
+        overlay_header_t header;
+        init_header(&header);
+        memcpy(buffer, &header, sizeof(header));
+        *size += sizeof(header);
+    }
+    for (uint32_t sector = 0; sectors && sector < NOR_SECTORS; sector++) {
+        if (!((sectors[sector / 64] >> (sector % 64)) & 1u)) {
+            continue;
+        }
+        const uint8_t *data = nor + sector * NOR_SECTOR_SIZE;
+        overlay_record_t record;
+        memset(&record, 0, sizeof(record));
+        record.sector = (uint16_t) sector;
+        record.kind = is_erased(data) ? RECORD_ERASED : RECORD_DATA;
+        record.checksum = checksum_record(&record, data);
+        memcpy(buffer + *size, &record, sizeof(record));
+        *size += sizeof(record);
+        if (record.kind == RECORD_DATA) {
+            memcpy(buffer + *size, data, NOR_SECTOR_SIZE);
+            *size += NOR_SECTOR_SIZE;
+        }
+    }
+    return buffer;
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t size) {
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+// whether the file starts with the header of this version, records go after it then.
+static bool has_header(int fd) {
+    overlay_header_t expected;
+    overlay_header_t header;
+    init_header(&expected);
+    return pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header) &&
+           memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+bool append_nor_overlay(const char *overlay_file_path, const uint64_t *dirty, const uint8_t *nor) {
+    int fd = open(overlay_file_path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool empty = lseek(fd, 0, SEEK_END) == 0;
+    // records after a bad or old header would never load, the file is started over with them.
+    if (!empty && !has_header(fd)) {
+        close(fd);
+        return write_nor_overlay(overlay_file_path, dirty, nor);
+    }
+    size_t size;
+    uint8_t *records = build_records(dirty, nor, empty, &size);
+    bool written = records != NULL && write_all(fd, records, size) && fsync(fd) == 0;
+    free(records);
+    close(fd);
+    // the first append may have created the file.
+    if (written && empty) {
+        sync_parent_dir(overlay_file_path);
+    }
+    return written;
+}
+
+bool write_nor_overlay(const char *overlay_file_path, const uint64_t *sectors, const uint8_t *nor) {
+    char temp_file_path[MAX_PATH_LENGTH];
+    int length = snprintf(temp_file_path, sizeof(temp_file_path), "%s" TEMP_SUFFIX, overlay_file_path);
+    if (length < 0 || length >= (int) sizeof(temp_file_path)) {
+        return false;
+    }
+    int fd = open(temp_file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size;
+    uint8_t *records = build_records(sectors, nor, true, &size);
+    bool written = records != NULL && write_all(fd, records, size) && fsync(fd) == 0;
+    free(records);
+    close(fd);
+    if (!written || rename(temp_file_path, overlay_file_path) != 0) {
+        unlink(temp_file_path);
+        return false;
+    }
+    sync_parent_dir(overlay_file_path);
+    return true;
+}
@@ -0,0 +1,26 @@
+//
+// The nor as a read only base with an overlay. The base file is mapped copy on write,
+// so all machines share the pages they never program, and the sectors that changed go
+// to an append only overlay file: saves append the dirty sectors, loads replay them
+// over the base. Records a later one replaces are dropped when the overlay is rewritten,
+// which a save does once most of them are.
+//
+
+#ifndef NC1020_NC1020_OVERLAY_H
+#define NC1020_NC1020_OVERLAY_H
+
+#include "nc1020_context.h"
+
+// the records an overlay may have beyond twice its sectors before it is rewritten.
+#define OVERLAY_SLACK 64
+
+// maps the base and replays the overlay, a torn record at the end is cut off.
+void load_nor_overlay(nc1020_t *nc);
+
+// appends the dirty sectors of nor, which are at their offsets, and syncs.
+bool append_nor_overlay(const char *overlay_file_path, const uint64_t *dirty, const uint8_t *nor);
+
+// replaces the overlay by one with just these sectors of nor, NULL with none.
+bool write_nor_overlay(const char *overlay_file_path, const uint64_t *sectors, const uint8_t *nor);
+
+#endif //NC1020_NC1020_OVERLAY_H
@@ -0,0 +1,330 @@
+#include "nc1020_profile.h"
+#include "nc1020_context.h"
+
+#ifdef CPU6502_TRACE
+void attach_trace(nc1020_t *nc, cpu6502_trace_t *trace) {
+    set_6502_trace(nc -> cpu, trace, &nc -> ram_io[0x00], &nc -> ram_io[0x0D]);
+}
+#endif
+
+#ifdef CPU6502_STATS
+void attach_stats(nc1020_t *nc, cpu6502_stats_t *stats) {
+    set_6502_stats(nc -> cpu, stats);
+}
+#endif
+
+#ifdef CPU6502_PROFILE
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/*
+ * A location is the pc together with what the cpu sees there: the pc alone is
+ * ambiguous in the bank windows. The memmap already follows the bank (0x00) and
+ * volume (0x0D) registers, so the host address of the pc tells the nor bank or
+ * the rom volume and bank. The region is the upper half of the key.
+ */
+#define REGION_RAM 0x0000u
+#define REGION_NOR 0x1000u
+#define REGION_ROM 0x2000u
+#define REGION_UNKNOWN 0x3000u
+// symbols given by pc only.
+#define REGION_ANY 0xFFFFu
+
+#define KEY_REGION(key) ((uint16_t) ((key) >> 16u))
+#define KEY_PC(key) ((uint16_t) (key))
+
+typedef struct {
+    uint32_t key;
+    uint64_t cycles;
+    uint64_t count;
+} profile_entry_t;
+
+typedef struct {
+    uint32_t key;
+    char *name;
+} profile_symbol_t;
+
+struct nc1020_profile {
+    nc1020_t *nc;
+    // open addressing, used entries have a count.
+    profile_entry_t *entries;
+    size_t capacity;
+    size_t size;
+
+    // the instruction the next cycles belong to.
+    bool has_last;
+    uint32_t last_key;
+
+    // sorted by key.
+    profile_symbol_t *symbols;
+    size_t symbol_count;
+};
+
+static uint32_t location_key(nc1020_t *nc, uint16_t pc) {
+    const uint8_t *host = nc -> memmap[pc >> 13u] + (pc & 0x1FFFu);
+    uint32_t region = REGION_UNKNOWN;
+    if (host >= nc -> ram_buff && host < nc -> ram_buff + 0x8000) {
+        region = REGION_RAM;
+    } else if (host >= nc -> nor_buff && host < nc -> nor_buff + NOR_SIZE) {
+        region = REGION_NOR | (uint32_t) ((host - nc -> nor_buff) >> 15u);
+    } else if (host >= nc -> rom -> buff && host < nc -> rom -> buff + ROM_SIZE) {
+        uint32_t offset = (uint32_t) (host - nc -> rom -> buff);
+        region = REGION_ROM | ((offset >> 23u) << 8u) | ((offset >> 15u) & 0xFFu);
+    }
+    return region << 16u | pc;
+}
+
+static size_t entry_slot(uint32_t key, size_t capacity) {
+    return (size_t) ((key * 0x9E3779B1u) >> 7u) & (capacity - 1);
+}
+
+static void grow_entries(nc1020_profile_t *profile) {
+    size_t capacity = profile -> capacity * 2;
+    profile_entry_t *entries = (profile_entry_t*) calloc(capacity, sizeof(profile_entry_t));
+    for (size_t i = 0; i < profile -> capacity; i++) {
+        profile_entry_t *entry = &profile -> entries[i];
+        if (entry -> count) {
+            size_t slot = entry_slot(entry -> key, capacity);
+            while (entries[slot].count) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = *entry;
+        }
+    }
+    free(profile -> entries);
+    profile -> entries = entries;
+    profile -> capacity = capacity;
+}
+
+static void add_cycles(nc1020_profile_t *profile, uint32_t key, uint32_t cycles) {
+    if (profile -> size * 2 >= profile -> capacity) {
+        grow_entries(profile);
+    }
+    size_t slot = entry_slot(key, profile -> capacity);
+    while (profile -> entries[slot].count && profile -> entries[slot].key != key) {
+        slot = (slot + 1) & (profile -> capacity - 1);
+    }
+    profile_entry_t *entry = &profile -> entries[slot];
+    if (entry -> count == 0) {
+        entry -> key = key;
+        profile -> size++;
+    }
+    entry -> cycles += cycles;
+    entry -> count++;
+}
+
+static void profile_instruction(void *context, uint16_t pc, uint32_t cycles) {
+    nc1020_profile_t *profile = (nc1020_profile_t*) context;
+    if (profile -> has_last) {
+        add_cycles(profile, profile -> last_key, cycles);
+    }
+    profile -> last_key = location_key(profile -> nc, pc);
+    profile -> has_last = true;
+}
+
+nc1020_profile_t *create_profile() {
+    nc1020_profile_t *profile = (nc1020_profile_t*) calloc(1, sizeof(nc1020_profile_t));
+    profile -> capacity = 0x1000;
+    profile -> entries = (profile_entry_t*) calloc(profile -> capacity, sizeof(profile_entry_t));
+    return profile;
+}
+
+void destroy_profile(nc1020_profile_t *profile) {
+    for (size_t i = 0; i < profile -> symbol_count; i++) {
+        free(profile -> symbols[i].name);
+    }
+    free(profile -> symbols);
+    free(profile -> entries);
+    free(profile);
+}
+
+void attach_profile(nc1020_t *nc, nc1020_profile_t *profile) {
+    if (profile) {
+        profile -> nc = nc;
+        profile -> has_last = false;
+        set_6502_profiler(nc -> cpu, profile_instruction, profile);
+    } else {
+        set_6502_profiler(nc -> cpu, NULL, NULL);
+    }
+}
+
+static void format_location(uint32_t key, char *text, size_t size) {
+    uint16_t region = KEY_REGION(key);
+    uint8_t bank = (uint8_t) region;
+    switch (region & 0xF000u) {
+        case REGION_RAM:
+            snprintf(text, size, "ram:%04X", KEY_PC(key));
+            break;
+        case REGION_NOR:
+            snprintf(text, size, "nor/%02X:%04X", bank, KEY_PC(key));
+            break;
+        case REGION_ROM:
+            snprintf(text, size, "rom%u/%02X:%04X", (region >> 8u) & 0x0Fu, bank, KEY_PC(key));
+            break;
+        default:
+            snprintf(text, size, region == REGION_ANY ? "%04X" : "?:%04X", KEY_PC(key));
+            break;
+    }
+}
+
+static bool parse_location(const char *text, uint32_t *key) {
+    unsigned int volume, bank, pc;
+    char end;
+    if (sscanf(text, "ram:%x%c", &pc, &end) == 1) {
+        *key = REGION_RAM << 16u | pc;
+    } else if (sscanf(text, "nor/%x:%x%c", &bank, &pc, &end) == 2) {
+        *key = (REGION_NOR | (bank & 0xFFu)) << 16u | pc;
+    } else if (sscanf(text, "rom%u/%x:%x%c", &volume, &bank, &pc, &end) == 3) {
+        *key = (REGION_ROM | (volume & 0x0Fu) << 8u | (bank & 0xFFu)) << 16u | pc;
+    } else if (sscanf(text, "%x%c", &pc, &end) == 1) {
+        *key = REGION_ANY << 16u | pc;
+    } else {
+        return false;
+    }
+    return pc <= 0xFFFF;
+}
+
+static int compare_symbols(const void *a, const void *b) {
+    uint32_t key_a = ((const profile_symbol_t*) a) -> key;
+    uint32_t key_b = ((const profile_symbol_t*) b) -> key;
+    return key_a < key_b ? -1 : key_a > key_b;
+}
+
+bool load_profile_symbols(nc1020_profile_t *profile, const char *file_path) {
+    FILE *file = fopen(file_path, "re");
+    if (file == NULL) {
+        return false;
+    }
+    size_t capacity = profile -> symbol_count + 256;
+    profile -> symbols = (profile_symbol_t*) realloc(profile -> symbols, capacity * sizeof(profile_symbol_t));
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char location[64], name[256];
+        uint32_t key;
+        if (line[0] == '#' || sscanf(line, "%63s %255s", location, name) != 2 || !parse_location(location, &key)) {
+            continue;
+        }
+        if (profile -> symbol_count == capacity) {
+            capacity *= 2;
+            profile -> symbols = (profile_symbol_t*) realloc(profile -> symbols, capacity * sizeof(profile_symbol_t));
+        }
+        profile -> symbols[profile -> symbol_count].key = key;
+        profile -> symbols[profile -> symbol_count].name = strdup(name);
+        profile -> symbol_count++;
+    }
+    fclose(file);
+    qsort(profile -> symbols, profile -> symbol_count, sizeof(profile_symbol_t), compare_symbols);
+    return true;
+}
+
+// the last symbol at or below key in the same region.
+static const profile_symbol_t *find_symbol_in(nc1020_profile_t *profile, uint32_t key) {
+    size_t low = 0, high = profile -> symbol_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (profile -> symbols[mid].key <= key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0 || KEY_REGION(profile -> symbols[low - 1].key) != KEY_REGION(key)) {
+        return NULL;
+    }
+    return &profile -> symbols[low - 1];
+}
+
+static const profile_symbol_t *find_symbol(nc1020_profile_t *profile, uint32_t key) {
+    const profile_symbol_t *symbol = find_symbol_in(profile, key);
+    if (symbol == NULL) {
+        symbol = find_symbol_in(profile, REGION_ANY << 16u | KEY_PC(key));
+    }
+    return symbol;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const profile_entry_t *entry_a = (const profile_entry_t*) a;
+    const profile_entry_t *entry_b = (const profile_entry_t*) b;
+    if (entry_a -> cycles != entry_b -> cycles) {
+        return entry_a -> cycles > entry_b -> cycles ? -1 : 1;
+    }
+    return entry_a -> key < entry_b -> key ? -1 : entry_a -> key > entry_b -> key;
+}
+
+// the routines, their key is the index of the symbol.
+static size_t sum_routines(nc1020_profile_t *profile, const profile_entry_t *entries, size_t count,
+                           profile_entry_t *routines) {
+    for (size_t i = 0; i < profile -> symbol_count; i++) {
+        routines[i].key = (uint32_t) i;
+        routines[i].cycles = 0;
+        routines[i].count = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const profile_symbol_t *symbol = find_symbol(profile, entries[i].key);
+        if (symbol) {
+            profile_entry_t *routine = &routines[symbol - profile -> symbols];
+            routine -> cycles += entries[i].cycles;
+            routine -> count += entries[i].count;
+        }
+    }
+    qsort(routines, profile -> symbol_count, sizeof(profile_entry_t), compare_entries);
+    size_t used = 0;
+    while (used < profile -> symbol_count && routines[used].cycles) {
+        used++;
+    }
+    return used;
+}
+
+void write_profile_report(nc1020_profile_t *profile, FILE *file, size_t limit) {
+    profile_entry_t *entries = (profile_entry_t*) malloc((profile -> size + 1) * sizeof(profile_entry_t));
+    size_t count = 0;
+    uint64_t total_cycles = 0;
+    uint64_t total_count = 0;
+    for (size_t i = 0; i < profile -> capacity; i++) {
+        if (profile -> entries[i].count) {
+            entries[count++] = profile -> entries[i];
+            total_cycles += profile -> entries[i].cycles;
+            total_count += profile -> entries[i].count;
+        }
+    }
+    qsort(entries, count, sizeof(profile_entry_t), compare_entries);
+    double percent = total_cycles ? 100.0 / (double) total_cycles : 0;
+
+    fprintf(file, "# %" PRIu64 " cycles in %" PRIu64 " instructions at %zu locations\n",
+            total_cycles, total_count, count);
+
+    if (profile -> symbol_count) {
+        profile_entry_t *routines = (profile_entry_t*) malloc(profile -> symbol_count * sizeof(profile_entry_t));
+        size_t routine_count = sum_routines(profile, entries, count, routines);
+        fprintf(file, "\n# routines\n%14s %7s %12s  %-14s %s\n", "cycles", "%", "count", "location", "symbol");
+        for (size_t i = 0; i < routine_count && i < limit; i++) {
+            const profile_symbol_t *symbol = &profile -> symbols[routines[i].key];
+            char location[32];
+            format_location(symbol -> key, location, sizeof(location));
+            fprintf(file, "%14" PRIu64 " %7.3f %12" PRIu64 "  %-14s %s\n", routines[i].cycles,
+                    (double) routines[i].cycles * percent, routines[i].count, location, symbol -> name);
+        }
+        free(routines);
+        fprintf(file, "\n# locations\n");
+    }
+
+    fprintf(file, "%14s %7s %12s  %-14s %s\n", "cycles", "%", "count", "location", "symbol");
+    for (size_t i = 0; i < count && i < limit; i++) {
+        char location[32];
+        format_location(entries[i].key, location, sizeof(location));
+        fprintf(file, "%14" PRIu64 " %7.3f %12" PRIu64 "  %-14s ", entries[i].cycles,
+                (double) entries[i].cycles * percent, entries[i].count, location);
+        const profile_symbol_t *symbol = find_symbol(profile, entries[i].key);
+        if (symbol && KEY_PC(entries[i].key) != KEY_PC(symbol -> key)) {
+            fprintf(file, "%s+%X", symbol -> name, KEY_PC(entries[i].key) - KEY_PC(symbol -> key));
+        } else if (symbol) {
+            fprintf(file, "%s", symbol -> name);
+        }
+        fprintf(file, "\n");
+    }
+    free(entries);
+}
+
+#endif
@@ -0,0 +1,52 @@
+//
+// Instrumentation of the code a machine runs: the cycle profile keyed by bank and pc in
+// builds with CPU6502_PROFILE, the instruction counts in builds with CPU6502_STATS and
+// the execution trace in builds with CPU6502_TRACE.
+//
+
+#ifndef NC1020_NC1020_PROFILE_H
+#define NC1020_NC1020_PROFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "nc1020.h"
+
+#ifdef CPU6502_PROFILE
+
+typedef struct nc1020_profile nc1020_profile_t;
+
+nc1020_profile_t *create_profile();
+void destroy_profile(nc1020_profile_t *profile);
+
+// counts the cycles of every instruction nc runs from now on, NULL stops counting.
+void attach_profile(nc1020_t *nc, nc1020_profile_t *profile);
+
+/**
+ * Symbol lines are "location name", the location either written like in the report
+ * (ram:0123, nor/05:4000, rom1/85:4000) or just a pc, which holds in every bank.
+ * @return false if the file can't be read.
+ */
+bool load_profile_symbols(nc1020_profile_t *profile, const char *file_path);
+
+// the limit most expensive locations, and the routines they belong to if there are symbols.
+void write_profile_report(nc1020_profile_t *profile, FILE *file, size_t limit);
+
+#endif
+
+#ifdef CPU6502_TRACE
+#include "cpu6502.h"
+
+// traces the instructions nc runs from now on, with its bank (0x00) and volume (0x0D)
+// registers. NULL stops tracing.
+void attach_trace(nc1020_t *nc, cpu6502_trace_t *trace);
+#endif
+
+#ifdef CPU6502_STATS
+#include "cpu6502.h"
+
+// counts the instructions nc runs from now on, NULL stops counting.
+void attach_stats(nc1020_t *nc, cpu6502_stats_t *stats);
+#endif
+
+#endif //NC1020_NC1020_PROFILE_H
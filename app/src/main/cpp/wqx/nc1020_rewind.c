@@ -0,0 +1,339 @@
+#include "nc1020_rewind.h"
+#include "nc1020_io.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// equal bytes it takes to end a run of changed ones.
+#define MIN_EQUAL_RUN 4u
+// what encoding the delta of size bytes may take at most.
+#define DELTA_BOUND(size) ((size) + 16u)
+#define SECTOR_HEADER_SIZE 6u
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} snapshot_entry_t;
+
+struct nc1020_rewind {
+    uint64_t interval_cycles;
+    uint64_t next_cycles;
+
+    // the newest snapshot, whole.
+    bool has_head;
+    nc1020_states_t head;
+    uint8_t *nor;
+
+    // the deltas to the older snapshots, the oldest first, in a ring of budget bytes.
+    uint8_t *ring;
+    size_t budget;
+    size_t ring_head;
+    snapshot_entry_t *entries;
+    uint32_t capacity;
+    uint32_t first;
+    uint32_t count;
+
+    // a snapshot is encoded here before it goes to the ring.
+    uint8_t *scratch;
+};
+
+static uint8_t *put_varint(uint8_t *p, size_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t) (value | 0x80u);
+        value >>= 7u;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, size_t *value) {
+    *value = 0;
+    for (uint32_t shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        *value |= (size_t) (byte & 0x7Fu) << shift;
+        if (!(byte & 0x80u)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static bool equal_words(const uint8_t *a, const uint8_t *b) {
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return x == y;
+}
+
+/*
+ * Writes what current XORs with previous as runs of a count of equal bytes, a count of
+ * changed ones and what they XOR with, and makes previous current on the way.
+ */
+static uint8_t *encode_delta(uint8_t *out, const uint8_t *current, uint8_t *previous, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        size_t equal_start = i;
+        while (i + 8 <= size && equal_words(current + i, previous + i)) {
+            i += 8;
+        }
+        while (i < size && current[i] == previous[i]) {
+            i++;
+        }
+        if (i == size) {
+            break;
+        }
+        size_t changed_start = i;
+        while (i < size) {
+            if (current[i] != previous[i]) {
+                i++;
+                continue;
+            }
+            size_t equal = 1;
+            while (equal < MIN_EQUAL_RUN && i + equal < size && current[i + equal] == previous[i + equal]) {
+                equal++;
+            }
+            if (equal == MIN_EQUAL_RUN || i + equal == size) {
+                break;
+            }
+            i += equal;
+        }
+        out = put_varint(out, changed_start - equal_start);
+        out = put_varint(out, i - changed_start);
+        for (size_t j = changed_start; j < i; j++) {
+            *out++ = current[j] ^ previous[j];
+            previous[j] = current[j];
+        }
+    }
+    return out;
+}
+
+// XORs the delta into target, false if it doesn't fit.
+static bool apply_delta(const uint8_t *delta, size_t delta_size, uint8_t *target, size_t size) {
+    const uint8_t *end = delta + delta_size;
+    size_t offset = 0;
+    while (delta < end) {
+        size_t equal, changed;
+        if ((delta = get_varint(delta, end, &equal)) == NULL ||
+                (delta = get_varint(delta, end, &changed)) == NULL ||
+                changed > (size_t) (end - delta) || equal > size - offset || changed > size - offset - equal) {
+            return false;
+        }
+        offset += equal;
+        for (size_t j = 0; j < changed; j++) {
+            target[offset + j] ^= delta[j];
+        }
+        offset += changed;
+        delta += changed;
+    }
+    return true;
+}
+
+nc1020_rewind_t *create_rewind(uint64_t interval_cycles, size_t budget) {
+    nc1020_rewind_t *rewind = (nc1020_rewind_t*) calloc(1, sizeof(nc1020_rewind_t));
+    if (rewind == NULL) {
+        return NULL;
+    }
+    rewind -> interval_cycles = interval_cycles;
+    rewind -> budget = budget;
+    rewind -> capacity = 64;
+    rewind -> nor = (uint8_t*) mmap(NULL, NOR_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    rewind -> ring = (uint8_t*) malloc(budget);
+    rewind -> entries = (snapshot_entry_t*) malloc(rewind -> capacity * sizeof(snapshot_entry_t));
+    // untouched pages cost nothing, only a snapshot writing the whole nor needs all of it.
+    rewind -> scratch = (uint8_t*) malloc(DELTA_BOUND(sizeof(nc1020_states_t)) +
+                                          NOR_SECTORS * (SECTOR_HEADER_SIZE + DELTA_BOUND(NOR_SECTOR_SIZE)));
+    if (rewind -> nor == MAP_FAILED || rewind -> ring == NULL || rewind -> entries == NULL || rewind -> scratch == NULL) {
+        if (rewind -> nor != MAP_FAILED) {
+            munmap(rewind -> nor, NOR_SIZE);
+        }
+        free(rewind -> ring);
+        free(rewind -> entries);
+        free(rewind -> scratch);
+        free(rewind);
+        return NULL;
+    }
+    return rewind;
+}
+
+void destroy_rewind(nc1020_rewind_t *rewind) {
+    munmap(rewind -> nor, NOR_SIZE);
+    free(rewind -> ring);
+    free(rewind -> entries);
+    free(rewind -> scratch);
+    free(rewind);
+}
+
+void clear_rewind(nc1020_rewind_t *rewind) {
+    rewind -> has_head = false;
+    rewind -> next_cycles = 0;
+    rewind -> ring_head = 0;
+    rewind -> first = 0;
+    rewind -> count = 0;
+}
+
+static snapshot_entry_t *get_entry(nc1020_rewind_t *rewind, uint32_t index) {
+    return &rewind -> entries[(rewind -> first + index) % rewind -> capacity];
+}
+
+static void drop_oldest(nc1020_rewind_t *rewind) {
+    rewind -> first = (rewind -> first + 1) % rewind -> capacity;
+    rewind -> count--;
+}
+
+static bool grow_entries(nc1020_rewind_t *rewind) {
+    uint32_t capacity = rewind -> capacity * 2;
+    snapshot_entry_t *entries = (snapshot_entry_t*) malloc(capacity * sizeof(snapshot_entry_t));
+    if (entries == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < rewind -> count; i++) {
+        entries[i] = *get_entry(rewind, i);
+    }
+    free(rewind -> entries);
+    rewind -> entries = entries;
+    rewind -> capacity = capacity;
+    rewind -> first = 0;
+    return true;
+}
+
+/*
+ * Makes room for size bytes at the head of the ring by dropping the oldest entries.
+ * Those are the ones past the head, up to the end of the ring, then from its start.
+ */
+static uint8_t *allocate_entry(nc1020_rewind_t *rewind, size_t size) {
+    if (size > rewind -> budget || (rewind -> count == rewind -> capacity && !grow_entries(rewind))) {
+        return NULL;
+    }
+    if (rewind -> ring_head + size > rewind -> budget) {
+        while (rewind -> count && get_entry(rewind, 0) -> offset >= rewind -> ring_head) {
+            drop_oldest(rewind);
+        }
+        rewind -> ring_head = 0;
+    }
+    while (rewind -> count && get_entry(rewind, 0) -> offset >= rewind -> ring_head &&
+            get_entry(rewind, 0) -> offset < rewind -> ring_head + size) {
+        drop_oldest(rewind);
+    }
+    snapshot_entry_t *entry = get_entry(rewind, rewind -> count++);
+    entry -> offset = rewind -> ring_head;
+    entry -> size = size;
+    rewind -> ring_head += size;
+    return rewind -> ring + entry -> offset;
+}
+
+void take_snapshot(nc1020_rewind_t *rewind, nc1020_t *nc) {
+    rewind -> next_cycles = nc -> states.cycles + rewind -> interval_cycles;
+    if (!rewind -> has_head) {
+        rewind -> head = nc -> states;
+        memcpy(rewind -> nor, nc -> nor_buff, NOR_SIZE);
+        memset(nc -> nor_rewind, 0, sizeof(nc -> nor_rewind));
+        rewind -> has_head = true;
+        return;
+    }
+    // the states delta, its size first, then the sectors that changed.
+    uint8_t *start = rewind -> scratch;
+    uint8_t *states_end = encode_delta(start + 4, (const uint8_t*) &nc -> states, (uint8_t*) &rewind -> head,
+                                       sizeof(nc1020_states_t));
+    uint32_t states_size = (uint32_t) (states_end - start - 4);
+    memcpy(start, &states_size, 4);
+    uint8_t *end = states_end;
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        uint64_t bits = nc -> nor_rewind[i];
+        while (bits) {
+            uint32_t sector = i * 64 + (uint32_t) __builtin_ctzll(bits);
+            uint32_t offset = sector * NOR_SECTOR_SIZE;
+            uint8_t *delta_end = encode_delta(end + SECTOR_HEADER_SIZE, nc -> nor_buff + offset,
+                                              rewind -> nor + offset, NOR_SECTOR_SIZE);
+            uint32_t delta_size = (uint32_t) (delta_end - end - SECTOR_HEADER_SIZE);
+            // a sector written back as it was has no delta.
+            if (delta_size) {
+                uint16_t index = (uint16_t) sector;
+                memcpy(end, &index, 2);
+                memcpy(end + 2, &delta_size, 4);
+                end = delta_end;
+            }
+            bits &= bits - 1;
+        }
+        nc -> nor_rewind[i] = 0;
+    }
+    size_t size = (size_t) (end - start);
+    uint8_t *entry = allocate_entry(rewind, size);
+    if (entry == NULL) {
+        // the history can't go past a snapshot that doesn't fit, it starts over from here.
+        rewind -> ring_head = 0;
+        rewind -> first = 0;
+        rewind -> count = 0;
+        return;
+    }
+    memcpy(entry, start, size);
+}
+
+void tick_rewind(nc1020_rewind_t *rewind, nc1020_t *nc) {
+    if (nc -> states.cycles >= rewind -> next_cycles) {
+        take_snapshot(rewind, nc);
+    }
+}
+
+uint32_t count_snapshots(const nc1020_rewind_t *rewind) {
+    return rewind -> has_head ? rewind -> count + 1 : 0;
+}
+
+// takes the newest delta back out of head and the nor copy, noting the sectors it touched.
+static bool undo_entry(nc1020_rewind_t *rewind, uint64_t *restored) {
+    const snapshot_entry_t *entry = get_entry(rewind, rewind -> count - 1);
+    const uint8_t *start = rewind -> ring + entry -> offset;
+    const uint8_t *end = start + entry -> size;
+    uint32_t states_size;
+    memcpy(&states_size, start, 4);
+    const uint8_t *p = start + 4;
+    if (!apply_delta(p, states_size, (uint8_t*) &rewind -> head, sizeof(nc1020_states_t))) {
+        return false;
+    }
+    p += states_size;
+    while (p + SECTOR_HEADER_SIZE <= end) {
+        uint16_t sector;
+        uint32_t delta_size;
+        memcpy(&sector, p, 2);
+        memcpy(&delta_size, p + 2, 4);
+        p += SECTOR_HEADER_SIZE;
+        if (sector >= NOR_SECTORS || delta_size > (size_t) (end - p) ||
+                !apply_delta(p, delta_size, rewind -> nor + sector * NOR_SECTOR_SIZE, NOR_SECTOR_SIZE)) {
+            return false;
+        }
+        restored[sector / 64] |= 1ull << (sector % 64);
+        p += delta_size;
+    }
+    rewind -> count--;
+    rewind -> ring_head = entry -> offset;
+    return true;
+}
+
+bool restore_snapshot(nc1020_rewind_t *rewind, nc1020_t *nc, uint32_t point) {
+    if (point >= count_snapshots(rewind)) {
+        return false;
+    }
+    // the sectors written since the newest snapshot go back too.
+    uint64_t restored[NOR_SECTORS / 64];
+    memcpy(restored, nc -> nor_rewind, sizeof(restored));
+    for (uint32_t i = 0; i < point; i++) {
+        if (!undo_entry(rewind, restored)) {
+            clear_rewind(rewind);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        uint64_t bits = restored[i];
+        while (bits) {
+            uint32_t offset = (i * 64 + (uint32_t) __builtin_ctzll(bits)) * NOR_SECTOR_SIZE;
+            memcpy(nc -> nor_buff + offset, rewind -> nor + offset, NOR_SECTOR_SIZE);
+            mark_nor_dirty(nc, nc -> nor_buff + offset, NOR_SECTOR_SIZE);
+            invalidate_6502_code(nc -> cpu, nc -> nor_buff + offset, NOR_SECTOR_SIZE);
+            bits &= bits - 1;
+        }
+    }
+    memset(nc -> nor_rewind, 0, sizeof(nc -> nor_rewind));
+    nc -> states = rewind -> head;
+    switch_volume(nc);
+    rewind -> next_cycles = nc -> states.cycles + rewind -> interval_cycles;
+    return true;
+}
@@ -0,0 +1,36 @@
+//
+// Rewinding. A snapshot of the states and the nor is taken every so many cycles into
+// a ring of a fixed size. The newest is kept whole, every older one as what it XORs
+// with the next, run length encoded: the zero runs between the bytes that changed
+// are just counted, so a snapshot costs about what changed since the last one. The
+// nor is compared only in the sectors written since, against a copy of it as of the
+// newest snapshot. When the ring is full the oldest snapshots are dropped.
+//
+
+#ifndef NC1020_NC1020_REWIND_H
+#define NC1020_NC1020_REWIND_H
+
+#include <stddef.h>
+#include "nc1020_context.h"
+
+typedef struct nc1020_rewind nc1020_rewind_t;
+
+nc1020_rewind_t *create_rewind(uint64_t interval_cycles, size_t budget);
+
+void destroy_rewind(nc1020_rewind_t *rewind);
+
+// forgets the snapshots, the next one is taken at the next tick.
+void clear_rewind(nc1020_rewind_t *rewind);
+
+// takes a snapshot once the interval passed since the last one.
+void tick_rewind(nc1020_rewind_t *rewind, nc1020_t *nc);
+
+void take_snapshot(nc1020_rewind_t *rewind, nc1020_t *nc);
+
+// the snapshots to go back to, the newest is 0.
+uint32_t count_snapshots(const nc1020_rewind_t *rewind);
+
+// puts nc back to a snapshot, the newer ones are dropped.
+bool restore_snapshot(nc1020_rewind_t *rewind, nc1020_t *nc, uint32_t point);
+
+#endif //NC1020_NC1020_REWIND_H
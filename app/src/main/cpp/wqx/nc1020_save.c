@@ -0,0 +1,450 @@
+#include "nc1020_save.h"
+#include "nc1020_overlay.h"
+#include "nc1020_state_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define JOURNAL_MAGIC "NC1020SJ"
+#define JOURNAL_SUFFIX ".journal"
+#define TEMP_SUFFIX ".tmp"
+#define MAX_PATH_LENGTH (MAX_FILE_NAME_LENGTH + 16)
+
+// the sectors go to the overlay, and replace all of it.
+#define JOURNAL_OVERLAY 1u
+#define JOURNAL_COMPACT 2u
+
+// followed by the dirty bitmap, the dirty sectors in order and the encoded states.
+typedef struct {
+    char magic[8];
+    uint32_t sector_size;
+    uint32_t sectors;
+    uint32_t flags;
+    // 0 without states.
+    uint32_t state_size;
+} journal_header_t;
+
+typedef struct {
+    char state_file_path[MAX_FILE_NAME_LENGTH];
+    char nor_file_path[MAX_FILE_NAME_LENGTH];
+    // the sectors go to the overlay instead of the nor when there is one.
+    char overlay_file_path[MAX_FILE_NAME_LENGTH];
+    // the sectors are all the overlay has, it is rewritten with just them.
+    bool compact;
+    bool has_states;
+    nc1020_states_t states;
+    uint64_t nor_dirty[NOR_SECTORS / 64];
+    // the dirty sectors at their offsets in the nor, the rest is never touched.
+    uint8_t *nor;
+} save_job_t;
+
+struct nc1020_saver {
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t idle;
+    save_job_t jobs[2];
+    // filled by queue_save, handed to the writer when ready.
+    save_job_t *pending;
+    bool ready;
+    // owned by the writer while busy.
+    save_job_t *writing;
+    bool busy;
+    bool failed;
+    bool stopping;
+    // without the thread, queue_save writes itself.
+    bool threaded;
+    pthread_t writer;
+};
+
+static bool is_dirty(const uint64_t *dirty, uint32_t sector) {
+    return (dirty[sector / 64] >> (sector % 64)) & 1u;
+}
+
+static bool has_nor(const save_job_t *job) {
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        if (job -> nor_dirty[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void clear_job(save_job_t *job) {
+    job -> compact = false;
+    job -> has_states = false;
+    memset(job -> nor_dirty, 0, sizeof(job -> nor_dirty));
+}
+
+static bool write_fully(int fd, const void *data, size_t size, off_t offset) {
+    const uint8_t *bytes = (const uint8_t*) data;
+    while (size) {
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= (size_t) written;
+        offset += written;
+    }
+    return true;
+}
+
+// file_path with the suffix, false if it doesn't fit, a cut path would name another file.
+static bool add_suffix(char *buffer, const char *file_path, const char *suffix) {
+    int length = snprintf(buffer, MAX_PATH_LENGTH, "%s%s", file_path, suffix);
+    return length >= 0 && length < MAX_PATH_LENGTH;
+}
+
+void sync_parent_dir(const char *file_path) {
+    char dir_path[MAX_PATH_LENGTH];
+    strncpy(dir_path, file_path, sizeof(dir_path) - 1);
+    dir_path[sizeof(dir_path) - 1] = '\0';
+    char *slash = strrchr(dir_path, '/');
+    if (slash == NULL) {
+        strcpy(dir_path, ".");
+    } else if (slash == dir_path) {
+        slash[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// writes the dirty sectors of nor into the nor file in place.
+static bool apply_sectors(const char *nor_file_path, const uint64_t *dirty, const uint8_t *nor) {
+    int fd = open(nor_file_path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = true;
+    uint32_t sector = 0;
+    while (written && sector < NOR_SECTORS) {
+        if (!is_dirty(dirty, sector)) {
+            sector++;
+            continue;
+        }
+        uint32_t end = sector + 1;
+        while (end < NOR_SECTORS && is_dirty(dirty, end)) {
+            end++;
+        }
+        off_t offset = (off_t) sector * NOR_SECTOR_SIZE;
+        written = write_fully(fd, nor + offset, (end - sector) * NOR_SECTOR_SIZE, offset);
+        sector = end;
+    }
+    written = written && fsync(fd) == 0;
+    close(fd);
+    return written;
+}
+
+// writes the sectors where they go, the nor in place or the overlay.
+static bool write_sectors(const char *nor_file_path, const char *overlay_file_path, uint32_t flags,
+                          const uint64_t *dirty, const uint8_t *nor) {
+    if (!(flags & JOURNAL_OVERLAY)) {
+        return apply_sectors(nor_file_path, dirty, nor);
+    }
+    if (flags & JOURNAL_COMPACT) {
+        return write_nor_overlay(overlay_file_path, dirty, nor);
+    }
+    return append_nor_overlay(overlay_file_path, dirty, nor);
+}
+
+// replaces the state file with the encoded states through a temporary file.
+static bool put_states(const char *state_file_path, const uint8_t *data, size_t size) {
+    char temp_file_path[MAX_PATH_LENGTH];
+    if (!add_suffix(temp_file_path, state_file_path, TEMP_SUFFIX)) {
+        return false;
+    }
+    int fd = open(temp_file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = write_fully(fd, data, size, 0) && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(temp_file_path, state_file_path) != 0) {
+        unlink(temp_file_path);
+        return false;
+    }
+    sync_parent_dir(state_file_path);
+    return true;
+}
+
+// the journal is next to what the sectors go to.
+static bool get_journal_path(char *buffer, const char *nor_file_path, const char *overlay_file_path) {
+    return add_suffix(buffer, overlay_file_path[0] ? overlay_file_path : nor_file_path, JOURNAL_SUFFIX);
+}
+
+/**
+ * Writes the sectors and the states as one: both go to a journal first, which is
+ * renamed into place once synced, then to their files. Until the rename the old
+ * files are untouched, after it a crash is finished by replay_save_journal.
+ */
+static bool write_journaled(const save_job_t *job, const uint8_t *states, size_t state_size) {
+    char journal_file_path[MAX_PATH_LENGTH];
+    char temp_file_path[MAX_PATH_LENGTH];
+    if (!get_journal_path(journal_file_path, job -> nor_file_path, job -> overlay_file_path) ||
+            !add_suffix(temp_file_path, journal_file_path, TEMP_SUFFIX)) {
+        return false;
+    }
+    int fd = open(temp_file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    journal_header_t header;
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.sector_size = NOR_SECTOR_SIZE;
+    header.sectors = NOR_SECTORS;
+    header.flags = (job -> overlay_file_path[0] ? JOURNAL_OVERLAY : 0) | (job -> compact ? JOURNAL_COMPACT : 0);
+    header.state_size = (uint32_t) state_size;
+    off_t offset = 0;
+    bool written = write_fully(fd, &header, sizeof(header), offset);
+    offset += sizeof(header);
+    written = written && write_fully(fd, job -> nor_dirty, sizeof(job -> nor_dirty), offset);
+    offset += sizeof(job -> nor_dirty);
+    for (uint32_t sector = 0; written && sector < NOR_SECTORS; sector++) {
+        if (is_dirty(job -> nor_dirty, sector)) {
+            written = write_fully(fd, job -> nor + sector * NOR_SECTOR_SIZE, NOR_SECTOR_SIZE, offset);
+            offset += NOR_SECTOR_SIZE;
+        }
+    }
+    written = written && write_fully(fd, states, state_size, offset);
+    written = written && fsync(fd) == 0;
+    close(fd);
+    // from the rename on the save is safe, whatever happens to the files.
+    if (!written || rename(temp_file_path, journal_file_path) != 0) {
+        unlink(temp_file_path);
+        return false;
+    }
+    sync_parent_dir(journal_file_path);
+    if (!write_sectors(job -> nor_file_path, job -> overlay_file_path, header.flags, job -> nor_dirty, job -> nor) ||
+            (state_size && !put_states(job -> state_file_path, states, state_size))) {
+        return false;
+    }
+    unlink(journal_file_path);
+    return true;
+}
+
+static bool has_same_files(const save_job_t *job, const save_job_t *other) {
+    return strncmp(job -> state_file_path, other -> state_file_path, MAX_FILE_NAME_LENGTH) == 0 &&
+           strncmp(job -> nor_file_path, other -> nor_file_path, MAX_FILE_NAME_LENGTH) == 0 &&
+           strncmp(job -> overlay_file_path, other -> overlay_file_path, MAX_FILE_NAME_LENGTH) == 0;
+}
+
+// what the writer couldn't write goes back to pending, under what was queued since.
+static void keep_unwritten(nc1020_saver_t *saver) {
+    save_job_t *pending = saver -> pending;
+    save_job_t *writing = saver -> writing;
+    if (!saver -> ready) {
+        memcpy(pending -> state_file_path, writing -> state_file_path, MAX_FILE_NAME_LENGTH);
+        memcpy(pending -> nor_file_path, writing -> nor_file_path, MAX_FILE_NAME_LENGTH);
+        memcpy(pending -> overlay_file_path, writing -> overlay_file_path, MAX_FILE_NAME_LENGTH);
+    } else if (!has_same_files(pending, writing)) {
+        return;
+    }
+    // the sectors of a rewrite are still all the overlay needs, with the newer ones.
+    pending -> compact |= writing -> compact;
+    if (writing -> has_states && !pending -> has_states) {
+        pending -> states = writing -> states;
+        pending -> has_states = true;
+    }
+    for (uint32_t sector = 0; sector < NOR_SECTORS; sector++) {
+        if (is_dirty(writing -> nor_dirty, sector) && !is_dirty(pending -> nor_dirty, sector)) {
+            memcpy(pending -> nor + sector * NOR_SECTOR_SIZE, writing -> nor + sector * NOR_SECTOR_SIZE,
+                   NOR_SECTOR_SIZE);
+            pending -> nor_dirty[sector / 64] |= 1ull << (sector % 64);
+        }
+    }
+}
+
+// takes the pending job and writes it, called and returning with the lock held.
+static void write_pending(nc1020_saver_t *saver) {
+    save_job_t *job = saver -> pending;
+    saver -> pending = saver -> writing;
+    saver -> writing = job;
+    saver -> ready = false;
+    saver -> busy = true;
+    pthread_mutex_unlock(&saver -> lock);
+
+    uint8_t *states = NULL;
+    size_t state_size = 0;
+    bool written = true;
+    if (job -> has_states && job -> state_file_path[0]) {
+        states = (uint8_t*) malloc(STATE_FILE_BOUND);
+        written = states != NULL;
+        state_size = written ? encode_states(&job -> states, states) : 0;
+    }
+    // the states alone replace their file at once, with sectors they need the journal.
+    if (written && (job -> compact || has_nor(job))) {
+        written = write_journaled(job, states, state_size);
+    } else if (written && state_size) {
+        written = put_states(job -> state_file_path, states, state_size);
+    }
+    free(states);
+
+    pthread_mutex_lock(&saver -> lock);
+    if (!written) {
+        saver -> failed = true;
+        keep_unwritten(saver);
+    }
+    clear_job(job);
+    saver -> busy = false;
+    pthread_cond_broadcast(&saver -> idle);
+}
+
+static void *run_writer(void *arg) {
+    nc1020_saver_t *saver = (nc1020_saver_t*) arg;
+    pthread_mutex_lock(&saver -> lock);
+    for (;;) {
+        while (!saver -> ready && !saver -> stopping) {
+            pthread_cond_wait(&saver -> queued, &saver -> lock);
+        }
+        if (!saver -> ready) {
+            break;
+        }
+        write_pending(saver);
+    }
+    pthread_mutex_unlock(&saver -> lock);
+    return NULL;
+}
+
+nc1020_saver_t *create_saver() {
+    nc1020_saver_t *saver = (nc1020_saver_t*) calloc(1, sizeof(nc1020_saver_t));
+    // only the pages of sectors that were ever dirty get memory.
+    saver -> jobs[0].nor = (uint8_t*) calloc(1, NOR_SIZE);
+    saver -> jobs[1].nor = (uint8_t*) calloc(1, NOR_SIZE);
+    saver -> pending = &saver -> jobs[0];
+    saver -> writing = &saver -> jobs[1];
+    pthread_mutex_init(&saver -> lock, NULL);
+    pthread_cond_init(&saver -> queued, NULL);
+    pthread_cond_init(&saver -> idle, NULL);
+    saver -> threaded = pthread_create(&saver -> writer, NULL, run_writer, saver) == 0;
+    return saver;
+}
+
+void destroy_saver(nc1020_saver_t *saver) {
+    if (saver -> threaded) {
+        pthread_mutex_lock(&saver -> lock);
+        saver -> stopping = true;
+        pthread_cond_signal(&saver -> queued);
+        pthread_mutex_unlock(&saver -> lock);
+        pthread_join(saver -> writer, NULL);
+    }
+    pthread_cond_destroy(&saver -> idle);
+    pthread_cond_destroy(&saver -> queued);
+    pthread_mutex_destroy(&saver -> lock);
+    free(saver -> jobs[0].nor);
+    free(saver -> jobs[1].nor);
+    free(saver);
+}
+
+static uint32_t count_sectors(const uint64_t *sectors) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        count += (uint32_t) __builtin_popcountll(sectors[i]);
+    }
+    return count;
+}
+
+void queue_save(nc1020_saver_t *saver, nc1020_t *nc) {
+    pthread_mutex_lock(&saver -> lock);
+    save_job_t *job = saver -> pending;
+    // what failed for other files isn't theirs to write.
+    if (strncmp(job -> state_file_path, nc -> state_file_path, MAX_FILE_NAME_LENGTH) != 0 ||
+            strncmp(job -> nor_file_path, nc -> nor_file_path, MAX_FILE_NAME_LENGTH) != 0 ||
+            strncmp(job -> overlay_file_path, nc -> overlay_file_path, MAX_FILE_NAME_LENGTH) != 0) {
+        clear_job(job);
+        memcpy(job -> state_file_path, nc -> state_file_path, MAX_FILE_NAME_LENGTH);
+        memcpy(job -> nor_file_path, nc -> nor_file_path, MAX_FILE_NAME_LENGTH);
+        memcpy(job -> overlay_file_path, nc -> overlay_file_path, MAX_FILE_NAME_LENGTH);
+    }
+    job -> states = nc -> states;
+    job -> has_states = true;
+
+    // once most records of the overlay are replaced by later ones it is rewritten.
+    bool compact = false;
+    if (nc -> overlay_file_path[0]) {
+        uint32_t sectors = count_sectors(nc -> nor_overlay);
+        nc -> overlay_records += count_sectors(nc -> nor_dirty);
+        if (nc -> overlay_records > 2 * (uint64_t) sectors + OVERLAY_SLACK) {
+            compact = true;
+            nc -> overlay_records = sectors;
+        }
+    }
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        uint64_t copied = compact ? nc -> nor_overlay[i] : nc -> nor_dirty[i];
+        uint64_t bits = copied;
+        while (bits) {
+            uint32_t offset = (i * 64 + (uint32_t) __builtin_ctzll(bits)) * NOR_SECTOR_SIZE;
+            memcpy(job -> nor + offset, nc -> nor_buff + offset, NOR_SECTOR_SIZE);
+            bits &= bits - 1;
+        }
+        job -> nor_dirty[i] |= copied;
+        nc -> nor_dirty[i] = 0;
+    }
+    job -> compact |= compact;
+    saver -> ready = true;
+    if (saver -> threaded) {
+        pthread_cond_signal(&saver -> queued);
+    } else {
+        write_pending(saver);
+    }
+    pthread_mutex_unlock(&saver -> lock);
+}
+
+bool flush_saver(nc1020_saver_t *saver) {
+    pthread_mutex_lock(&saver -> lock);
+    while (saver -> ready || saver -> busy) {
+        pthread_cond_wait(&saver -> idle, &saver -> lock);
+    }
+    bool saved = !saver -> failed;
+    saver -> failed = false;
+    pthread_mutex_unlock(&saver -> lock);
+    return saved;
+}
+
+bool replay_save_journal(const char *nor_file_path, const char *overlay_file_path, const char *state_file_path) {
+    char journal_file_path[MAX_PATH_LENGTH];
+    if (!get_journal_path(journal_file_path, nor_file_path, overlay_file_path)) {
+        return false;
+    }
+    FILE *file = fopen(journal_file_path, "rbe");
+    if (file == NULL) {
+        return true;
+    }
+    journal_header_t header;
+    uint64_t dirty[NOR_SECTORS / 64];
+    uint8_t *nor = (uint8_t*) malloc(NOR_SIZE);
+    uint8_t *states = NULL;
+    bool complete = nor != NULL && fread(&header, sizeof(header), 1, file) == 1 &&
+                    memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+                    header.sector_size == NOR_SECTOR_SIZE && header.sectors == NOR_SECTORS &&
+                    header.state_size <= STATE_FILE_BOUND &&
+                    fread(dirty, sizeof(dirty), 1, file) == 1;
+    for (uint32_t sector = 0; complete && sector < NOR_SECTORS; sector++) {
+        if (is_dirty(dirty, sector)) {
+            complete = fread(nor + sector * NOR_SECTOR_SIZE, NOR_SECTOR_SIZE, 1, file) == 1;
+        }
+    }
+    if (complete && header.state_size) {
+        states = (uint8_t*) malloc(header.state_size);
+        complete = states != NULL && fread(states, header.state_size, 1, file) == 1;
+    }
+    fclose(file);
+    // journals are only renamed into place when complete, a broken one is of no use.
+    bool applied = complete &&
+            write_sectors(nor_file_path, overlay_file_path, header.flags, dirty, nor) &&
+            (header.state_size == 0 || state_file_path[0] == '\0' ||
+             put_states(state_file_path, states, header.state_size));
+    if (applied || !complete) {
+        unlink(journal_file_path);
+    }
+    free(states);
+    free(nor);
+    return applied;
+}
@@ -0,0 +1,43 @@
+//
+// Saves in the background. A save copies the states and the dirty nor sectors of a
+// machine, then a writer thread puts them on disk so that a crash at any point leaves
+// either the old or the new files, as a pair:
+// - states alone go to a temporary file which replaces the old one once it is synced.
+// - with nor sectors, both go to a journal next to the nor or the overlay, renamed into
+//   place once synced, then the sectors are written to the nor in place or appended to
+//   the overlay and the states replace their file. A journal left by a crash is
+//   replayed before either is read.
+//
+
+#ifndef NC1020_NC1020_SAVE_H
+#define NC1020_NC1020_SAVE_H
+
+#include "nc1020_context.h"
+
+typedef struct nc1020_saver nc1020_saver_t;
+
+nc1020_saver_t *create_saver();
+
+// waits for the queued saves.
+void destroy_saver(nc1020_saver_t *saver);
+
+// copies the states and the dirty nor sectors of nc, which are clean afterwards.
+void queue_save(nc1020_saver_t *saver, nc1020_t *nc);
+
+/**
+ * Blocks until everything queued is on disk.
+ * @return false if a save failed since the last flush, its data is written with the next.
+ */
+bool flush_saver(nc1020_saver_t *saver);
+
+/**
+ * Finishes a save that a crash interrupted, call it before reading the nor, the overlay
+ * ("" without one) or the states.
+ * @return false if there was a journal that couldn't be applied.
+ */
+bool replay_save_journal(const char *nor_file_path, const char *overlay_file_path, const char *state_file_path);
+
+// makes a rename or a new file in the directory of file_path durable.
+void sync_parent_dir(const char *file_path);
+
+#endif //NC1020_NC1020_SAVE_H
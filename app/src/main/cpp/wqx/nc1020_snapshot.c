@@ -0,0 +1,85 @@
+#include "nc1020_snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+struct nc1020_snapshot {
+    nc1020_states_t states;
+    uint8_t *memmap[8];
+    uint8_t *bbs_pages[0x10];
+    uint8_t page_flags[8];
+
+    uint64_t nor_dirty[NOR_SECTORS / 64];
+    uint64_t nor_overlay[NOR_SECTORS / 64];
+    uint64_t nor_rewind[NOR_SECTORS / 64];
+    // the sectors backed up in nor, at their offsets.
+    uint64_t nor_saved[NOR_SECTORS / 64];
+    uint8_t *nor;
+};
+
+nc1020_snapshot_t *create_snapshot() {
+    nc1020_snapshot_t *snapshot = (nc1020_snapshot_t*) calloc(1, sizeof(nc1020_snapshot_t));
+    if (snapshot == NULL) {
+        return NULL;
+    }
+    // only the sectors ever backed up take memory.
+    snapshot -> nor = (uint8_t*) mmap(NULL, NOR_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (snapshot -> nor == MAP_FAILED) {
+        free(snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+void destroy_snapshot(nc1020_snapshot_t *snapshot) {
+    munmap(snapshot -> nor, NOR_SIZE);
+    free(snapshot);
+}
+
+void capture_machine(nc1020_snapshot_t *snapshot, nc1020_t *nc) {
+    snapshot -> states = nc -> states;
+    memcpy(snapshot -> memmap, nc -> memmap, sizeof(snapshot -> memmap));
+    memcpy(snapshot -> bbs_pages, nc -> bbs_pages, sizeof(snapshot -> bbs_pages));
+    memcpy(snapshot -> page_flags, nc -> page_flags, sizeof(snapshot -> page_flags));
+    memcpy(snapshot -> nor_dirty, nc -> nor_dirty, sizeof(snapshot -> nor_dirty));
+    memcpy(snapshot -> nor_overlay, nc -> nor_overlay, sizeof(snapshot -> nor_overlay));
+    memcpy(snapshot -> nor_rewind, nc -> nor_rewind, sizeof(snapshot -> nor_rewind));
+    memset(snapshot -> nor_saved, 0, sizeof(snapshot -> nor_saved));
+    nc -> nor_backup = snapshot;
+}
+
+void backup_nor(nc1020_snapshot_t *snapshot, nc1020_t *nc, const uint8_t *ptr, uint32_t size) {
+    uint32_t offset = (uint32_t) (ptr - nc -> nor_buff);
+    for (uint32_t i = offset / NOR_SECTOR_SIZE; i <= (offset + size - 1) / NOR_SECTOR_SIZE && i < NOR_SECTORS; i++) {
+        uint64_t bit = 1ull << (i % 64);
+        if (!(snapshot -> nor_saved[i / 64] & bit)) {
+            memcpy(snapshot -> nor + i * NOR_SECTOR_SIZE, nc -> nor_buff + i * NOR_SECTOR_SIZE, NOR_SECTOR_SIZE);
+            snapshot -> nor_saved[i / 64] |= bit;
+        }
+    }
+}
+
+void restore_machine(nc1020_snapshot_t *snapshot, nc1020_t *nc) {
+    for (uint32_t i = 0; i < NOR_SECTORS / 64; i++) {
+        uint64_t bits = snapshot -> nor_saved[i];
+        while (bits) {
+            uint32_t offset = (i * 64 + (uint32_t) __builtin_ctzll(bits)) * NOR_SECTOR_SIZE;
+            memcpy(nc -> nor_buff + offset, snapshot -> nor + offset, NOR_SECTOR_SIZE);
+            invalidate_6502_code(nc -> cpu, nc -> nor_buff + offset, NOR_SECTOR_SIZE);
+            bits &= bits - 1;
+        }
+    }
+    nc -> nor_backup = NULL;
+    memcpy(nc -> nor_dirty, snapshot -> nor_dirty, sizeof(nc -> nor_dirty));
+    memcpy(nc -> nor_overlay, snapshot -> nor_overlay, sizeof(nc -> nor_overlay));
+    memcpy(nc -> nor_rewind, snapshot -> nor_rewind, sizeof(nc -> nor_rewind));
+
+    nc -> states = snapshot -> states;
+    bool remap = memcmp(nc -> memmap, snapshot -> memmap, sizeof(nc -> memmap)) != 0;
+    memcpy(nc -> memmap, snapshot -> memmap, sizeof(nc -> memmap));
+    memcpy(nc -> bbs_pages, snapshot -> bbs_pages, sizeof(nc -> bbs_pages));
+    memcpy(nc -> page_flags, snapshot -> page_flags, sizeof(nc -> page_flags));
+    if (remap) {
+        remap_6502(nc -> cpu);
+    }
+}
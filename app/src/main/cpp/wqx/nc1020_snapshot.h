@@ -0,0 +1,27 @@
+//
+// A snapshot of a machine in memory, to run it ahead and come back. Capturing copies
+// the states and the memory map, the nor is only copied a sector at a time before the
+// machine first writes to it, so a capture and a restore cost about two copies of the
+// states.
+//
+
+#ifndef NC1020_NC1020_SNAPSHOT_H
+#define NC1020_NC1020_SNAPSHOT_H
+
+#include "nc1020_context.h"
+
+typedef struct nc1020_snapshot nc1020_snapshot_t;
+
+nc1020_snapshot_t *create_snapshot();
+
+void destroy_snapshot(nc1020_snapshot_t *snapshot);
+
+// the nor is followed until the restore, one capture at a time per machine.
+void capture_machine(nc1020_snapshot_t *snapshot, nc1020_t *nc);
+
+void restore_machine(nc1020_snapshot_t *snapshot, nc1020_t *nc);
+
+// keeps what the nor has in these bytes before the machine writes to them.
+void backup_nor(nc1020_snapshot_t *snapshot, nc1020_t *nc, const uint8_t *ptr, uint32_t size);
+
+#endif //NC1020_NC1020_SNAPSHOT_H
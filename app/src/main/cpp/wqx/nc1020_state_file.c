@@ -0,0 +1,231 @@
+#include "nc1020_state_file.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STATE_FILE_MAGIC "NC1020ST"
+// an empty section closing the file, one cut off at a section is rejected too.
+#define END_TAG "END "
+// the raw states of before, nc1020_states_t still has their layout.
+#define RAW_STATES_VERSION 6u
+
+#define HEADER_SIZE 12u
+#define SECTION_HEADER_SIZE 12u
+// smaller sections aren't worth compressing.
+#define MIN_COMPRESSED_SIZE 64u
+
+// a little endian integer of its size, or bytes as they are.
+#define FIELD_INT 0
+#define FIELD_BOOL 1
+#define FIELD_BYTES 2
+
+typedef struct {
+    size_t offset;
+    uint16_t size;
+    uint8_t kind;
+} field_t;
+
+#define INT(name) {offsetof(nc1020_states_t, name), sizeof(((nc1020_states_t*) 0) -> name), FIELD_INT}
+#define BOOL(name) {offsetof(nc1020_states_t, name), 1, FIELD_BOOL}
+#define BYTES(name) {offsetof(nc1020_states_t, name), sizeof(((nc1020_states_t*) 0) -> name), FIELD_BYTES}
+
+// fields are only ever appended to a section, new ones go into new sections.
+static const field_t cpu_fields[] = {
+    INT(cpu.reg_pc), INT(cpu.reg_a), INT(cpu.reg_ps), INT(cpu.reg_x), INT(cpu.reg_y), INT(cpu.reg_sp),
+};
+static const field_t ram_fields[] = {
+    BYTES(ram),
+};
+static const field_t io_fields[] = {
+    BYTES(bak_40), INT(lcd_addr), BYTES(keypad_matrix),
+};
+static const field_t clock_fields[] = {
+    BYTES(clock_data), INT(clock_flags),
+};
+static const field_t wav_fields[] = {
+    BYTES(jg_wav_data), INT(jg_wav_flags), INT(jg_wav_idx), BOOL(jg_wav_playing),
+};
+static const field_t flash_fields[] = {
+    INT(fp_step), INT(fp_type), INT(fp_bank_idx), INT(fp_bak1), INT(fp_bak2), BYTES(fp_buff),
+};
+static const field_t timer_fields[] = {
+    INT(cycles), INT(timer0_cycles), INT(timer1_cycles), BOOL(timer0_toggle), BOOL(should_irq),
+    BOOL(slept), BOOL(should_wake_up), BOOL(pending_wake_up), INT(wake_up_flags),
+};
+
+typedef struct {
+    char tag[4];
+    const field_t *fields;
+    uint32_t count;
+} section_t;
+
+#define SECTION(tag, fields) {tag, fields, sizeof(fields) / sizeof(field_t)}
+
+static const section_t sections[] = {
+    SECTION("CPU ", cpu_fields),
+    SECTION("RAM ", ram_fields),
+    SECTION("IO  ", io_fields),
+    SECTION("CLCK", clock_fields),
+    SECTION("WAV ", wav_fields),
+    SECTION("FLSH", flash_fields),
+    SECTION("TIME", timer_fields),
+};
+
+#define SECTION_COUNT (sizeof(sections) / sizeof(section_t))
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    for (uint32_t i = 0; i < 4; i++) {
+        p[i] = (uint8_t) (value >> (i * 8u));
+    }
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8u | (uint32_t) p[2] << 16u | (uint32_t) p[3] << 24u;
+}
+
+static void put_field(const field_t *field, const nc1020_states_t *states, uint8_t *p) {
+    const uint8_t *value = (const uint8_t*) states + field -> offset;
+    if (field -> kind == FIELD_BYTES) {
+        memcpy(p, value, field -> size);
+        return;
+    }
+    uint64_t integer = 0;
+    switch (field -> size) {
+        case 1: integer = *value; break;
+        case 2: integer = *(const uint16_t*) value; break;
+        case 4: integer = *(const uint32_t*) value; break;
+        default: integer = *(const uint64_t*) value; break;
+    }
+    for (uint32_t i = 0; i < field -> size; i++) {
+        p[i] = (uint8_t) (integer >> (i * 8u));
+    }
+}
+
+static void get_field(const field_t *field, nc1020_states_t *states, const uint8_t *p) {
+    uint8_t *value = (uint8_t*) states + field -> offset;
+    if (field -> kind == FIELD_BYTES) {
+        memcpy(value, p, field -> size);
+        return;
+    }
+    uint64_t integer = 0;
+    for (uint32_t i = 0; i < field -> size; i++) {
+        integer |= (uint64_t) p[i] << (i * 8u);
+    }
+    switch (field -> size) {
+        case 1:
+            if (field -> kind == FIELD_BOOL) {
+                *(bool*) value = integer != 0;
+            } else {
+                *value = (uint8_t) integer;
+            }
+            break;
+        case 2: *(uint16_t*) value = (uint16_t) integer; break;
+        case 4: *(uint32_t*) value = (uint32_t) integer; break;
+        default: *(uint64_t*) value = integer; break;
+    }
+}
+
+size_t encode_states(const nc1020_states_t *states, uint8_t *buffer) {
+    memcpy(buffer, STATE_FILE_MAGIC, 8);
+    put_u32(buffer + 8, STATE_FILE_VERSION);
+    size_t size = HEADER_SIZE;
+    uint8_t raw[sizeof(nc1020_states_t)];
+    for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+        const section_t *section = &sections[i];
+        uint32_t raw_size = 0;
+        for (uint32_t j = 0; j < section -> count; j++) {
+            put_field(&section -> fields[j], states, raw + raw_size);
+            raw_size += section -> fields[j].size;
+        }
+        uint8_t *header = buffer + size;
+        uint8_t *data = header + SECTION_HEADER_SIZE;
+        size_t stored_size = 0;
+        if (raw_size >= MIN_COMPRESSED_SIZE) {
+            stored_size = lz_compress(raw, raw_size, data, STATE_FILE_BOUND - (size_t) (data - buffer));
+        }
+        if (stored_size == 0 || stored_size >= raw_size) {
+            memcpy(data, raw, raw_size);
+            stored_size = raw_size;
+        }
+        memcpy(header, section -> tag, 4);
+        put_u32(header + 4, raw_size);
+        put_u32(header + 8, (uint32_t) stored_size);
+        size += SECTION_HEADER_SIZE + stored_size;
+    }
+    memcpy(buffer + size, END_TAG, 4);
+    put_u32(buffer + size + 4, 0);
+    put_u32(buffer + size + 8, 0);
+    return size + SECTION_HEADER_SIZE;
+}
+
+static const section_t *find_section(const uint8_t *tag) {
+    for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+        if (memcmp(sections[i].tag, tag, 4) == 0) {
+            return &sections[i];
+        }
+    }
+    return NULL;
+}
+
+// the fields the data has, the rest keep their values.
+static void get_fields(const section_t *section, nc1020_states_t *states, const uint8_t *data, uint32_t size) {
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < section -> count && offset + section -> fields[i].size <= size; i++) {
+        get_field(&section -> fields[i], states, data + offset);
+        offset += section -> fields[i].size;
+    }
+}
+
+static bool decode_sections(const uint8_t *data, size_t size, nc1020_states_t *states) {
+    size_t offset = HEADER_SIZE;
+    while (offset < size) {
+        if (size - offset < SECTION_HEADER_SIZE) {
+            return false;
+        }
+        const uint8_t *header = data + offset;
+        uint32_t raw_size = get_u32(header + 4);
+        uint32_t stored_size = get_u32(header + 8);
+        offset += SECTION_HEADER_SIZE;
+        if (stored_size > raw_size || stored_size > size - offset) {
+            return false;
+        }
+        const uint8_t *stored = data + offset;
+        offset += stored_size;
+        if (memcmp(header, END_TAG, 4) == 0) {
+            return true;
+        }
+        const section_t *section = find_section(header);
+        if (section == NULL) {
+            continue;
+        }
+        if (stored_size == raw_size) {
+            get_fields(section, states, stored, raw_size);
+            continue;
+        }
+        uint8_t *raw = (uint8_t*) malloc(raw_size);
+        if (raw == NULL || !lz_decompress(stored, stored_size, raw, raw_size)) {
+            free(raw);
+            return false;
+        }
+        get_fields(section, states, raw, raw_size);
+        free(raw);
+    }
+    return false;
+}
+
+bool decode_states(const uint8_t *data, size_t size, nc1020_states_t *states) {
+    if (size >= HEADER_SIZE && memcmp(data, STATE_FILE_MAGIC, 8) == 0) {
+        uint32_t version = get_u32(data + 8);
+        // sections carry their own sizes, so every version decodes the same way.
+        return version >= 1 && decode_sections(data, size, states);
+    }
+    if (size != sizeof(nc1020_states_t)) {
+        return false;
+    }
+    uint64_t raw_version;
+    memcpy(&raw_version, data, sizeof(raw_version));
+    if (raw_version != RAW_STATES_VERSION) {
+        return false;
+    }
+    memcpy(states, data, sizeof(nc1020_states_t));
+    return true;
+}
@@ -0,0 +1,32 @@
+//
+// The states on disk. A header with a magic and the format version, then sections of
+// a tag, the size of the section and the size it is stored in, which is smaller when
+// it is compressed, and an empty END section. Every field is little endian whatever the
+// host, so a state moves between devices.
+// Sections or fields a file lacks keep what the states had, and the ones a newer
+// version appended are skipped, so old files load into new states and the other way.
+// Files of version 6, the raw states, are migrated.
+//
+
+#ifndef NC1020_NC1020_STATE_FILE_H
+#define NC1020_NC1020_STATE_FILE_H
+
+#include <stddef.h>
+#include "nc1020_states.h"
+#include "nc1020_lz.h"
+
+#define STATE_FILE_VERSION 1
+
+// what the encoded states may take at most.
+#define STATE_FILE_BOUND (LZ_BOUND(sizeof(nc1020_states_t)) + 256u)
+
+// encodes the states into buffer, which holds STATE_FILE_BOUND bytes, returns the size.
+size_t encode_states(const nc1020_states_t *states, uint8_t *buffer);
+
+/**
+ * Decodes a state file of any version over states.
+ * @return false if it isn't one or is damaged, states may be partly written then.
+ */
+bool decode_states(const uint8_t *data, size_t size, nc1020_states_t *states);
+
+#endif //NC1020_NC1020_STATE_FILE_H
@@ -2,12 +2,14 @@ package org.liberty.android.nc1020emu
 
 import org.liberty.android.nc1020emu.NC1020JNI.runTimeSlice
 import org.liberty.android.nc1020emu.NC1020JNI.copyLcdBufferEx
+import org.liberty.android.nc1020emu.NC1020JNI.isSleeping
 import org.liberty.android.nc1020emu.NC1020JNI.save
 import org.liberty.android.nc1020emu.NC1020JNI.setKey
 import org.liberty.android.nc1020emu.NC1020JNI.reset
 import org.liberty.android.nc1020emu.NC1020JNI.load
 import org.liberty.android.nc1020emu.NC1020JNI.initialize
 import org.liberty.android.nc1020emu.NC1020JNI.cycles
+import org.liberty.android.nc1020emu.NC1020JNI.setRunAhead
 import android.view.SurfaceHolder
 import android.view.Choreographer.FrameCallback
 import android.graphics.Bitmap
@@ -58,13 +60,18 @@ class MainFragment : Fragment(), SurfaceHolder.Callback, FrameCallback {
         var interval = 0L
         while (isRunning) {
             val startTime = System.currentTimeMillis()
+            val sleptBefore = isSleeping()
             runTimeSlice(interval.toInt(), speedUp)
-            copyLcdBufferEx(lcdBufferEx)
+            // A halted cpu doesn't touch the lcd, and there is nothing to speed up
+            val sleeping = sleptBefore && isSleeping()
+            if (!sleeping) {
+                copyLcdBufferEx(lcdBufferEx)
+            }
             val elapsed = System.currentTimeMillis() - startTime
             if (elapsed < FRAME_INTERVAL) {
                 try {
                     // If speedUp, don't sleep, run as much frames as system can
-                    Thread.sleep(if (speedUp) 0 else FRAME_INTERVAL - elapsed)
+                    Thread.sleep(if (speedUp && !sleeping) 0 else FRAME_INTERVAL - elapsed)
                 } catch (e: InterruptedException) {
                     e.printStackTrace()
                 }
@@ -169,13 +176,15 @@ class MainFragment : Fragment(), SurfaceHolder.Callback, FrameCallback {
         val romPath = "$fileDir/$ROM_FILE_NAME"
         val norPath = "$fileDir/$NOR_FILE_NAME"
         val statePath = "$fileDir/$STATE_FILE_NAME"
-        initialize(romPath, norPath, statePath)
+        check(initialize(romPath, norPath, statePath)) { "cannot load $romPath" }
         load()
     }
 
     private fun startEmulation() {
         Choreographer.getInstance().postFrameCallback(this)
         isRunning = true
+        val runAheadMs = if (runAheadSetting) RUN_AHEAD_MS else 0
+        executorService.submit { setRunAhead(runAheadMs) }
         executorService.submit(runnable)
     }
 
@@ -187,6 +196,9 @@ class MainFragment : Fragment(), SurfaceHolder.Callback, FrameCallback {
     private val saveStatesSetting: Boolean
         get() = preferences.getBoolean(SAVE_STATES_KEY, true)
 
+    private val runAheadSetting: Boolean
+        get() = preferences.getBoolean(RUN_AHEAD_KEY, false)
+
     private fun showFactoryResetDialog() {
         AlertDialog.Builder(requireContext())
                 .setTitle(R.string.factory_reset)
@@ -282,5 +294,8 @@ class MainFragment : Fragment(), SurfaceHolder.Callback, FrameCallback {
         private const val NOR_FILE_NAME = "nc1020.fls"
         private const val STATE_FILE_NAME = "nc1020.sts"
         private const val SAVE_STATES_KEY = "save_states"
+        private const val RUN_AHEAD_KEY = "run_ahead"
+        // A frame ahead shows a key as soon as the firmware scans it
+        private const val RUN_AHEAD_MS = FRAME_INTERVAL
     }
 }
\ No newline at end of file
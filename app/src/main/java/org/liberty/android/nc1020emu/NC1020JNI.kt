@@ -1,13 +1,18 @@
 package org.liberty.android.nc1020emu
 
 object NC1020JNI {
-    @JvmStatic external fun initialize(romFilePath: String?, norFilePath: String?, stateFilePath: String?)
+    @JvmStatic external fun initialize(romFilePath: String?, norFilePath: String?, stateFilePath: String?): Boolean
     @JvmStatic external fun reset()
     @JvmStatic external fun load()
     @JvmStatic external fun save()
+    @JvmStatic external fun setRewind(intervalMs: Int, budget: Int)
+    @JvmStatic external fun rewind(point: Int): Boolean
+    @JvmStatic val rewindPoints: Int external get
+    @JvmStatic external fun setRunAhead(runAheadMs: Int)
     @JvmStatic external fun setKey(keyId: Int, downOrUp: Boolean)
     @JvmStatic external fun runTimeSlice(timeSlice: Int, speedUp: Boolean)
     @JvmStatic external fun copyLcdBufferEx(buffer: ByteArray?): Boolean
+    @JvmStatic external fun isSleeping(): Boolean
     @JvmStatic val cycles: Long external get
 
     init {